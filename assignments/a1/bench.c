@@ -0,0 +1,446 @@
+// bench.c
+//
+// Times sort_entries on 10^3 up to 10^8 random readings (or up to argv[1])
+// against the original selection sort (repeated find_max_index, only where it
+// finishes quickly) and the C library's qsort, then ingest_text against a
+// scanf("%d %f") loop like get_entries on up to 10^7 lines, and the streaming
+// top-K against sorting everything, and sort_entries on int+float pairs
+// against sort_packed on 32-bit records, and the per-room table against
+// grouping sorted pairs, and the SIMD validate_entries / find_max_index
+// against their one-at-a-time loops. Not part of the a1 program; build with
+//   gcc -O2 -Wall bench.c readings.c ingest.c topk.c packed.c rooms.c -o bench
+// (add -march=native for the AVX2 kernels) and run as ./bench [max_readings]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "readings.h"
+
+typedef struct {
+    int id;
+    float reading;
+} Pair;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The original sort_entries: copy both arrays, then pick the maximum of the
+// copy for every output slot and mark it used with -1.0
+static void selection_sort(int ids[], float readings[], int size) {
+    int *temp_ids = malloc(size * sizeof *temp_ids);
+    float *temp_readings = malloc(size * sizeof *temp_readings);
+    for (int i = 0; i < size; i++) {
+        temp_ids[i] = ids[i];
+        temp_readings[i] = readings[i];
+    }
+    for (int i = 0; i < size; i++) {
+        int max_idx = find_max_index(temp_readings, size);
+        ids[i] = temp_ids[max_idx];
+        readings[i] = temp_readings[max_idx];
+        temp_readings[max_idx] = -1.0f;
+    }
+    free(temp_ids);
+    free(temp_readings);
+}
+
+// Highest reading first, then input order (ids are input positions)
+static int pair_cmp(const void *a, const void *b) {
+    const Pair *x = a, *y = b;
+    if (x->reading != y->reading) {
+        return x->reading < y->reading ? 1 : -1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Readings with two decimals in EMF_MIN..EMF_MAX, as the EMF reader gives
+// them, so most values repeat; the id is the input position
+static void fill(int ids[], float readings[], int size) {
+    for (int i = 0; i < size; i++) {
+        ids[i] = i;
+        readings[i] = (rand() % 501) / 100.0f;
+    }
+}
+
+// Sorted highest first, ties in input order, and every pair still together
+static int sorted_ok(const int ids[], const float readings[], const float input[], int size) {
+    for (int i = 0; i < size; i++) {
+        if (ids[i] < 0 || ids[i] >= size || input[ids[i]] != readings[i]) return 0;
+        if (i > 0 && (readings[i - 1] < readings[i] ||
+                      (readings[i - 1] == readings[i] && ids[i - 1] >= ids[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Lines as an EMF logger writes them, with one in 20 out of range
+static char* make_lines(long n, size_t *len) {
+    char *text = malloc((size_t)n * 24 + 1);
+    if (!text) return NULL;
+    size_t pos = 0;
+    for (long i = 0; i < n; i++) {
+        int id = ROOM_MIN + rand() % (ROOM_MAX - ROOM_MIN + 1);
+        int centi = rand() % 20 == 0 ? 501 + rand() % 100 : rand() % 501;
+        pos += (size_t)sprintf(text + pos, "%d %d.%02d\n", id, centi / 100, centi % 100);
+    }
+    *len = pos;
+    return text;
+}
+
+// Records/sec of ingest_text and of scanf over the same lines
+static void bench_ingest(long n) {
+    size_t len;
+    char *text = make_lines(n, &len);
+    if (!text) {
+        printf("%-10ld | out of memory\n", n);
+        return;
+    }
+
+    EmfData data = {0};
+    double start = now_sec();
+    int result = ingest_text(text, len, &data);
+    double parsed = now_sec() - start;
+
+    // The get_entries loop without prompts, reading the same bytes
+    FILE *in = fmemopen(text, len, "r");
+    long scanned = 0, valid = 0;
+    int id;
+    float reading;
+    start = now_sec();
+    while (in && fscanf(in, "%d %f", &id, &reading) == 2) {
+        scanned++;
+        valid += invalid_room(id) == C_OK && invalid_reading(reading) == C_OK;
+    }
+    double scanf_time = now_sec() - start;
+    if (in) {
+        fclose(in);
+    }
+
+    int ok = result == C_OK && scanned == n && data.size == valid && data.size + data.bad_emf == n;
+    printf("%-10ld | %-16.2f | %-16.2f | %s\n", n, scanned / scanf_time / 1e6, n / parsed / 1e6,
+           ok ? "ok" : "FAILED");
+    emf_data_free(&data);
+    free(text);
+}
+
+// The K highest of n readings: sort them all and take the first K, or keep
+// only K in topk's heap (also by room, over 80,000 rooms)
+static void bench_topk(int n, int k) {
+    int *ids = malloc(n * sizeof *ids);
+    float *readings = malloc(n * sizeof *readings);
+    int *top_ids = malloc(k * sizeof *top_ids);
+    float *top_readings = malloc(k * sizeof *top_readings);
+    if (!ids || !readings || !top_ids || !top_readings) {
+        printf("%-10d | out of memory\n", n);
+        free(ids);
+        free(readings);
+        free(top_ids);
+        free(top_readings);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        ids[i] = ROOM_MIN + rand() % (ROOM_MAX - ROOM_MIN + 1);
+        readings[i] = (rand() % 501) / 100.0f;
+    }
+
+    double times[2];
+    int ok = 1;
+    for (int by_room = 0; by_room < 2; by_room++) {
+        TopK top;
+        topk_init(&top, k, by_room);
+        double start = now_sec();
+        for (int i = 0; i < n; i++) {
+            topk_add(&top, ids[i], readings[i]);
+        }
+        int got = topk_result(&top, top_ids, top_readings);
+        times[by_room] = now_sec() - start;
+        ok &= got == (k < n ? k : n);
+        topk_free(&top);
+    }
+
+    // Sorting moves the pairs, so this goes last and is compared with the
+    // plain top-K still in top_ids/top_readings from a fresh run
+    TopK top;
+    topk_init(&top, k, 0);
+    for (int i = 0; i < n; i++) {
+        topk_add(&top, ids[i], readings[i]);
+    }
+    topk_result(&top, top_ids, top_readings);
+    topk_free(&top);
+    double start = now_sec();
+    sort_entries(ids, readings, n);
+    double sorted = now_sec() - start;
+    for (int i = 0; i < k && i < n; i++) {
+        ok &= ids[i] == top_ids[i] && readings[i] == top_readings[i];
+    }
+
+    printf("%-10d | %-8d | %-14.1f | %-14.1f | %-14.1f | %s\n", n, k, sorted * 1e9 / n, times[0] * 1e9 / n,
+           times[1] * 1e9 / n, ok ? "ok" : "FAILED");
+    free(ids);
+    free(readings);
+    free(top_ids);
+    free(top_readings);
+}
+
+// The same readings sorted as int+float pairs (8 bytes each) and as packed
+// records (4 bytes each); the packed order must unpack to the pairs' order
+static void bench_packed(int n) {
+    int *ids = malloc(n * sizeof *ids);
+    float *readings = malloc(n * sizeof *readings);
+    uint32_t *records = malloc(n * sizeof *records);
+    if (!ids || !readings || !records) {
+        printf("%-10d | out of memory\n", n);
+        free(ids);
+        free(readings);
+        free(records);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        ids[i] = ROOM_MIN + rand() % (ROOM_MAX - ROOM_MIN + 1);
+        readings[i] = (rand() % 501) / 100.0f;
+        pack_record(ids[i], readings[i], &records[i]);
+    }
+
+    double start = now_sec();
+    sort_entries(ids, readings, n);
+    double pairs = now_sec() - start;
+    start = now_sec();
+    int ok = sort_packed(records, n) == C_OK;
+    double packed = now_sec() - start;
+    for (int i = 0; i < n && ok; i++) {
+        ok = record_id(records[i]) == ids[i] && record_reading(records[i]) == readings[i];
+    }
+
+    printf("%-10d | %-16.1f | %-16.1f | %-8zu | %-8zu | %s\n", n, pairs * 1e9 / n, packed * 1e9 / n,
+           sizeof *ids + sizeof *readings, sizeof *records, ok ? "ok" : "FAILED");
+    free(ids);
+    free(readings);
+    free(records);
+}
+
+static int room_cmp(const void *a, const void *b) {
+    const Pair *x = a, *y = b;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Per-room count/min/max/sum of n readings over all 80,000 rooms: the
+// direct-indexed table, against sorting the pairs by room and summing each
+// run, which must agree on every room
+static void bench_rooms(int n) {
+    Pair *pairs = malloc(n * sizeof *pairs);
+    RoomTable table;
+    if (!pairs || rooms_init(&table) != C_OK) {
+        printf("%-10d | out of memory\n", n);
+        free(pairs);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        pairs[i] = (Pair){ ROOM_MIN + rand() % ROOM_COUNT, (rand() % 501) / 100.0f };
+    }
+
+    double start = now_sec();
+    for (int i = 0; i < n; i++) {
+        rooms_add(&table, pairs[i].id, pairs[i].reading);
+    }
+    double direct = now_sec() - start;
+
+    start = now_sec();
+    qsort(pairs, n, sizeof *pairs, room_cmp);
+    int ok = 1, rooms = 0;
+    for (int i = 0; i < n;) {
+        RoomStats run = { 0, pairs[i].reading, pairs[i].reading, 0.0 };
+        int id = pairs[i].id;
+        for (; i < n && pairs[i].id == id; i++) {
+            run.count++;
+            run.sum += pairs[i].reading;
+            run.min = pairs[i].reading < run.min ? pairs[i].reading : run.min;
+            run.max = pairs[i].reading > run.max ? pairs[i].reading : run.max;
+        }
+        rooms++;
+        const RoomStats *room = &table.rooms[id - ROOM_MIN];
+        ok &= room->count == run.count && room->min == run.min && room->max == run.max;
+    }
+    double grouped = now_sec() - start;
+    ok &= rooms == table.active;
+
+    printf("%-10d | %-16.1f | %-16.1f | %-8d | %s\n", n, grouped * 1e9 / n, direct * 1e9 / n, table.active,
+           ok ? "ok" : "FAILED");
+    free(pairs);
+    rooms_free(&table);
+}
+
+// The one-at-a-time validate_entries and find_max_index, to time and check
+// the SIMD versions against
+static int scalar_validate(int ids[], float readings[], int size, long *bad_room, long *bad_emf) {
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        if (invalid_room(ids[i]) != C_OK) {
+            (*bad_room)++;
+        } else if (invalid_reading(readings[i]) != C_OK) {
+            (*bad_emf)++;
+        } else {
+            ids[kept] = ids[i];
+            readings[kept] = readings[i];
+            kept++;
+        }
+    }
+    return kept;
+}
+
+static int scalar_max_index(const float readings[], int size) {
+    int max_idx = 0;
+    for (int i = 1; i < size; i++) {
+        if (readings[i] > readings[max_idx]) {
+            max_idx = i;
+        }
+    }
+    return max_idx;
+}
+
+// Validate n pairs with one in 20 out of range (as make_lines writes them),
+// then find the highest of n two-decimal readings (many ties at 5.00)
+static void bench_kernels(int n) {
+    int *ids = malloc(n * sizeof *ids), *ids2 = malloc(n * sizeof *ids2);
+    float *readings = malloc(n * sizeof *readings), *readings2 = malloc(n * sizeof *readings2);
+    if (!ids || !ids2 || !readings || !readings2) {
+        printf("%-10d | out of memory\n", n);
+        free(ids);
+        free(ids2);
+        free(readings);
+        free(readings2);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        int bad = rand() % 20 == 0;
+        ids[i] = ids2[i] = bad && rand() % 2 ? ROOM_MAX + 1 : ROOM_MIN + rand() % ROOM_COUNT;
+        readings[i] = readings2[i] = bad ? 5.5f : (rand() % 501) / 100.0f;
+    }
+
+    long bad_room = 0, bad_emf = 0, bad_room2 = 0, bad_emf2 = 0;
+    double start = now_sec();
+    int kept2 = scalar_validate(ids2, readings2, n, &bad_room2, &bad_emf2);
+    double scalar_check = now_sec() - start;
+    start = now_sec();
+    int kept = validate_entries(ids, readings, n, &bad_room, &bad_emf);
+    double simd_check = now_sec() - start;
+    int ok = kept == kept2 && bad_room == bad_room2 && bad_emf == bad_emf2;
+    for (int i = 0; i < kept && ok; i++) {
+        ok = ids[i] == ids2[i] && readings[i] == readings2[i];
+    }
+
+    start = now_sec();
+    int max2 = scalar_max_index(readings, kept);
+    double scalar_max = now_sec() - start;
+    start = now_sec();
+    int max = find_max_index(readings, kept);
+    double simd_max = now_sec() - start;
+    ok &= max == max2;
+
+    printf("%-10d | %-14.2f | %-14.2f | %-14.2f | %-14.2f | %s\n", n, scalar_check * 1e9 / n,
+           simd_check * 1e9 / n, scalar_max * 1e9 / kept, simd_max * 1e9 / kept, ok ? "ok" : "FAILED");
+    free(ids);
+    free(ids2);
+    free(readings);
+    free(readings2);
+}
+
+int main(int argc, char *argv[]) {
+    long max_size = argc > 1 ? atol(argv[1]) : 100000000L;
+    srand(101);
+
+    printf("%-10s | %-16s | %-16s | %-16s | %s\n", "readings", "selection ns/op", "qsort ns/op", "sort ns/op",
+           "check");
+    printf("-----------|------------------|------------------|------------------|------\n");
+    for (long n = 1000; n <= max_size; n *= 10) {
+        int size = (int)n;
+        int *ids = malloc(n * sizeof *ids);
+        float *readings = malloc(n * sizeof *readings);
+        float *input = malloc(n * sizeof *input);
+        Pair *pairs = malloc(n * sizeof *pairs);
+        if (!ids || !readings || !input || !pairs) {
+            printf("%-10ld | out of memory\n", n);
+            free(ids);
+            free(readings);
+            free(input);
+            free(pairs);
+            break;
+        }
+        fill(ids, readings, size);
+        for (int i = 0; i < size; i++) {
+            input[i] = readings[i];
+        }
+
+        char selection[32] = "-";
+        if (n <= 100000) {
+            double start = now_sec();
+            selection_sort(ids, readings, size);
+            snprintf(selection, sizeof selection, "%.1f", (now_sec() - start) * 1e9 / n);
+            for (int i = 0; i < size; i++) { // back to the input order
+                ids[i] = i;
+                readings[i] = input[i];
+            }
+        }
+
+        for (int i = 0; i < size; i++) {
+            pairs[i] = (Pair){ i, input[i] };
+        }
+        double start = now_sec();
+        qsort(pairs, n, sizeof *pairs, pair_cmp);
+        double library = now_sec() - start;
+
+        start = now_sec();
+        int result = sort_entries(ids, readings, size);
+        double sorted = now_sec() - start;
+
+        int ok = result == C_OK && sorted_ok(ids, readings, input, size);
+        for (int i = 0; i < size && ok; i++) {
+            ok = pairs[i].id == ids[i];
+        }
+        printf("%-10ld | %-16s | %-16.1f | %-16.1f | %s\n", n, selection, library * 1e9 / n, sorted * 1e9 / n,
+               ok ? "ok" : "FAILED");
+
+        free(ids);
+        free(readings);
+        free(input);
+        free(pairs);
+    }
+
+    printf("\n%-10s | %-16s | %-16s | %s\n", "lines", "scanf M rec/s", "ingest M rec/s", "check");
+    printf("-----------|------------------|------------------|------\n");
+    for (long n = 100000; n <= max_size && n <= 10000000; n *= 10) {
+        bench_ingest(n);
+    }
+
+    printf("\n%-10s | %-8s | %-14s | %-14s | %-14s | %s\n", "readings", "K", "sort ns/op", "top-K ns/op",
+           "by room ns/op", "check");
+    printf("-----------|----------|----------------|----------------|----------------|------\n");
+    for (long n = 1000000; n <= max_size && n <= 10000000; n *= 10) {
+        bench_topk((int)n, 10);
+        bench_topk((int)n, 1000);
+    }
+
+    printf("\n%-10s | %-16s | %-16s | %-8s | %-8s | %s\n", "readings", "pairs ns/op", "packed ns/op",
+           "B/pair", "B/record", "check");
+    printf("-----------|------------------|------------------|----------|----------|------\n");
+    for (long n = 1000; n <= max_size && n <= 100000000; n *= 10) {
+        bench_packed((int)n);
+    }
+
+    printf("\n%-10s | %-16s | %-16s | %-8s | %s\n", "readings", "group ns/op", "table ns/op", "rooms", "check");
+    printf("-----------|------------------|------------------|----------|------\n");
+    for (long n = 10000; n <= max_size && n <= 10000000; n *= 10) {
+        bench_rooms((int)n);
+    }
+
+    printf("\n%-10s | %-14s | %-14s | %-14s | %-14s | %s\n", "readings", "check ns/op", "SIMD check", "max ns/op",
+           "SIMD max", "check");
+    printf("-----------|----------------|----------------|----------------|----------------|------\n");
+    for (long n = 10000; n <= max_size && n <= 100000000; n *= 10) {
+        bench_kernels((int)n);
+    }
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "readings.h"
+
+// Non-interactive ingestion: "id reading" lines from a file or stdin go
+// straight into growable synchronized arrays. A regular file is memory-mapped
+// and parsed where it lies; a pipe is read in INGEST_CHUNK blocks, with a
+// line cut by the block end carried over to the next one. Numbers are parsed
+// from the bytes in place (no scanf, no copying into strings), and each
+// parsed block is validated in bulk with validate_entries, so bad records
+// only add to a count.
+
+#define INGEST_CHUNK (1 << 20) // bytes per read() from a pipe
+#define TOKEN_MAX 64           // longest reading handed to strtof
+
+// Grow both arrays together so there is room for `extra` more pairs
+static int data_reserve(EmfData *data, int extra) {
+    if (data->size + extra <= data->capacity) {
+        return C_OK;
+    }
+    int capacity = data->capacity ? data->capacity : 1024;
+    while (capacity < data->size + extra) {
+        if (capacity > INT_MAX / 2) {
+            return C_ERR_NO_MEMORY;
+        }
+        capacity *= 2;
+    }
+    int *ids = realloc(data->ids, (size_t)capacity * sizeof *ids);
+    if (!ids) {
+        return C_ERR_NO_MEMORY;
+    }
+    data->ids = ids;
+    float *readings = realloc(data->readings, (size_t)capacity * sizeof *readings);
+    if (!readings) {
+        return C_ERR_NO_MEMORY;
+    }
+    data->readings = readings;
+    data->capacity = capacity;
+    return C_OK;
+}
+
+static int is_separator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+// Room id: optional sign and digits. Values past the int range are clamped,
+// which invalid_room then rejects like any other out-of-range id.
+static const char* parse_id(const char *p, const char *end, int *id) {
+    int negative = p < end && *p == '-';
+    if (negative || (p < end && *p == '+')) {
+        p++;
+    }
+    const char *digits = p;
+    long long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (value <= INT_MAX) {
+            value = value * 10 + (*p - '0');
+        }
+        p++;
+    }
+    if (p == digits) {
+        return NULL;
+    }
+    value = negative ? -value : value;
+    *id = value > INT_MAX ? INT_MAX : (value < INT_MIN ? INT_MIN : (int)value);
+    return p;
+}
+
+// Reading: digits with an optional decimal point. When the digits fit in a
+// float exactly (at most 2^24) and there are at most 10 decimals, one float
+// division gives the correctly rounded value, the same float scanf("%f")
+// gives. Anything else (more digits, an exponent, "nan") goes to strtof on a
+// copy of the token.
+static const char* parse_reading(const char *p, const char *end, float *reading) {
+    static const float POW10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    const char *start = p;
+    int negative = p < end && *p == '-';
+    if (negative || (p < end && *p == '+')) {
+        p++;
+    }
+    unsigned long mantissa = 0;
+    int digits = 0, decimals = 0, fast = 1;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+        fast &= mantissa <= (1ul << 24);
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++, decimals++) {
+            mantissa = mantissa * 10 + (*p - '0');
+            fast &= mantissa <= (1ul << 24);
+        }
+    }
+    if (digits > 0 && fast && decimals <= 10 && (p == end || is_separator(*p) || *p == '\n')) {
+        float value = (float)mantissa / POW10[decimals];
+        *reading = negative ? -value : value;
+        return p;
+    }
+
+    // Slow path: the whole token through strtof
+    const char *token_end = start;
+    while (token_end < end && !is_separator(*token_end) && *token_end != '\n') {
+        token_end++;
+    }
+    char token[TOKEN_MAX];
+    size_t len = (size_t)(token_end - start);
+    if (len == 0 || len >= TOKEN_MAX) {
+        return NULL;
+    }
+    memcpy(token, start, len);
+    token[len] = '\0';
+    char *parsed;
+    *reading = strtof(token, &parsed);
+    return parsed == token + len ? token_end : NULL;
+}
+
+// Parse the complete lines of [p, end) into `data`. Blank lines are skipped,
+// lines that are not exactly "id reading" are counted as malformed, and a
+// "-1 -1" line (the interactive quit code) ends the input. Returns 1 if it
+// did, 0 otherwise, or C_ERR_NO_MEMORY.
+static int parse_lines(const char *p, const char *end, EmfData *data) {
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) {
+            line_end = end;
+        }
+        const char *q = p;
+        while (q < line_end && is_separator(*q)) {
+            q++;
+        }
+        if (q == line_end) {
+            p = line_end + 1;
+            continue;
+        }
+
+        int id;
+        float reading;
+        q = parse_id(q, line_end, &id);
+        const char *gap = q;
+        while (q && q < line_end && is_separator(*q)) {
+            q++;
+        }
+        q = q && q > gap ? parse_reading(q, line_end, &reading) : NULL;
+        while (q && q < line_end && is_separator(*q)) {
+            q++;
+        }
+
+        if (q != line_end) {
+            data->malformed++;
+        } else if (id == -1 && reading > -2.0f && reading <= -1.0f) {
+            // (int)reading == -1 as get_entries tests it, without casting
+            // floats such as nan or 1e30 that do not fit in an int
+            return 1;
+        } else {
+            if (data_reserve(data, 1) != C_OK) {
+                return C_ERR_NO_MEMORY;
+            }
+            data->ids[data->size] = id;
+            data->readings[data->size] = reading;
+            data->size++;
+        }
+        p = line_end + 1;
+    }
+    return 0;
+}
+
+// Parse, then validate and compact what this call added, and hand it to the
+// sink if there is one
+static int ingest_block(const char *text, size_t len, EmfData *data) {
+    int first = data->size;
+    int result = parse_lines(text, text + len, data);
+    data->size = first + validate_entries(data->ids + first, data->readings + first, data->size - first,
+                                          &data->bad_room, &data->bad_emf);
+    if (data->sink) {
+        data->sink(data->sink_ctx, data->ids + first, data->readings + first, data->size - first);
+        data->size = first;
+    }
+    return result;
+}
+
+// Parse a whole text of "id reading" lines into `data`, appending to what it
+// holds (or passing it to data->sink), in blocks of about INGEST_CHUNK bytes
+// cut at line ends. Returns C_OK or C_ERR_NO_MEMORY.
+int ingest_text(const char *text, size_t len, EmfData *data) {
+    const char *end = text + len;
+    int result = 0;
+    while (text < end && result == 0) {
+        const char *cut = (size_t)(end - text) > INGEST_CHUNK ? text + INGEST_CHUNK : end;
+        while (cut < end && cut[-1] != '\n') {
+            cut++;
+        }
+        result = ingest_block(text, (size_t)(cut - text), data);
+        text = cut;
+    }
+    return result < 0 ? result : C_OK;
+}
+
+// A pipe (or anything that cannot be mapped): read blocks and parse the
+// complete lines of each, carrying the cut-off last line over
+static int ingest_stream(int fd, EmfData *data) {
+    size_t capacity = INGEST_CHUNK, kept = 0;
+    char *buffer = malloc(capacity);
+    if (!buffer) {
+        return C_ERR_NO_MEMORY;
+    }
+    int result = 0;
+    for (;;) {
+        if (kept == capacity) { // one line longer than the buffer
+            char *grown = realloc(buffer, capacity * 2);
+            if (!grown) {
+                result = C_ERR_NO_MEMORY;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t got = read(fd, buffer + kept, capacity - kept);
+        if (got < 0) {
+            result = C_ERR_INVALID_FILE;
+            break;
+        }
+        if (got == 0) {
+            result = ingest_block(buffer, kept, data); // last line without '\n'
+            break;
+        }
+        size_t filled = kept + (size_t)got;
+        size_t complete = filled;
+        while (complete > 0 && buffer[complete - 1] != '\n') {
+            complete--;
+        }
+        result = ingest_block(buffer, complete, data);
+        if (result != 0) {
+            break;
+        }
+        kept = filled - complete;
+        memmove(buffer, buffer + complete, kept);
+    }
+    free(buffer);
+    return result < 0 ? result : C_OK;
+}
+
+// Read every "id reading" line of a file ("-" for stdin) into `data`,
+// appending to what it holds (or passing it to data->sink). Pairs failing invalid_room / invalid_reading
+// are counted in data->bad_room / data->bad_emf, unparseable lines in
+// data->malformed, and none of them printed. Returns C_OK,
+// C_ERR_INVALID_FILE (cannot open or read) or C_ERR_NO_MEMORY.
+int ingest_file(const char *path, EmfData *data) {
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        return C_ERR_INVALID_FILE;
+    }
+    struct stat st;
+    int result;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *text = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            result = ingest_stream(fd, data);
+        } else {
+            madvise(text, (size_t)st.st_size, MADV_SEQUENTIAL);
+            result = ingest_text(text, (size_t)st.st_size, data);
+            munmap(text, (size_t)st.st_size);
+        }
+    } else {
+        result = ingest_stream(fd, data);
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return result;
+}
+
+// Free the arrays of an EmfData and zero it
+void emf_data_free(EmfData *data) {
+    free(data->ids);
+    free(data->readings);
+    memset(data, 0, sizeof *data);
+}
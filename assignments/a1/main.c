@@ -1,47 +1,212 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-// best practice (instead of copy-pasting everything)
-// #include<readings.h>
-
-// These are defined values.
-// They do not reserve memory like a variable.
-// Instead, the first phase of building - "pre-processing"
-// Will essentially find-and-replace with what is written to the right.
-// You should define some yourself to avoid "magic numbers",
-// unchanging numbers that might need explanation or appear multiple times.
-// It's a bit like commenting the value.
-#define MAX_ENTRIES 16
-#define C_OK 0
-#define C_ERR_EMPTY_ARRAY -1
-#define C_ERR_INVALID_EMF -2
-#define C_ERR_INVALID_ROOM -3
-#define C_EXIT_CODE -1.0
-
-// defining our min and max ranges for convenience
-#define ROOM_MAX 13379999
-#define ROOM_MIN 13300000
-#define EMF_MIN 0.00
-#define EMF_MAX 5.00
-
-// These are "forward declarations".
-// It tells the rest of the code to expect to find a function
-// that works like this somewhere once we compile and link our code.
-// We will NOT put the body of the function here, to keep things clean.
-// Instead, we will leave this forward declaration untouched,
-// and define the functions in another file: `readings.c`.
-// These are like promises; "When I link other files, you'll find them"
-int get_entries(int ids[], float readings[]);
-int print_entries(int ids[], float readings[], int size);
-int sort_entries(int ids[], float readings[], int size);
-int find_max_index(float readings[], int size);
-int invalid_room(int id);
-int invalid_reading(float reading);
-
-// compiling using "gcc -Wall main.c readings.c -o a1" allows us to have both
+// best practice (instead of copy-pasting everything): the defined values and
+// forward declarations are in readings.h, shared with readings.c
+#include "readings.h"
+
+// compiling using "gcc -Wall main.c readings.c ingest.c topk.c packed.c rooms.c -o a1" allows us to have all
 // files interact with each other seamlessly which makes it possible for the
 // main file to read the implementation details for readings.c
 
-int main(void) {
+// Command-line options for the non-interactive modes
+typedef struct {
+    const char *ingest_path; // --ingest FILE: text lines, or `-` for stdin
+    const char *load_path;   // --load FILE: a dump written with --dump
+    const char *dump_path;   // --dump FILE: write the sorted packed records
+    int top_k;               // --top K
+    int by_room;             // --by-room
+    int packed;              // --packed (implied by --dump and --load)
+    int rooms;               // --rooms
+} Options;
+
+static void print_error(int result) {
+    printf("Error: %s\n", result == C_ERR_NO_MEMORY ? "out of memory" : "cannot read the input");
+}
+
+static void print_summary(const EmfData *data, long valid, const struct timespec *start,
+                          const struct timespec *end) {
+    double seconds = (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+    long records = valid + data->bad_room + data->bad_emf + data->malformed;
+    printf("Ingested %ld records in %.3f s (%.0f records/sec): %ld valid, %ld invalid room ID, "
+           "%ld invalid EMF value, %ld malformed\n",
+           records, seconds, seconds > 0 ? records / seconds : 0.0, valid, data->bad_room, data->bad_emf,
+           data->malformed);
+}
+
+// Sort packed records, write them to --dump if asked, and print them
+static int finish_packed(const Options *opts, PackedData *packed) {
+    int result = sort_packed(packed->records, packed->size);
+    if (result == C_ERR_NO_MEMORY) {
+        print_error(result);
+        return 1;
+    }
+    if (opts->dump_path && packed_write(opts->dump_path, packed->records, packed->size) != C_OK) {
+        printf("Error: cannot write %s\n", opts->dump_path);
+        return 1;
+    }
+    print_packed(packed->records, packed->size);
+    return 0;
+}
+
+// Non-interactive mode: `./a1 --ingest FILE` (or `-` for stdin) loads every
+// "id reading" line of FILE, reports how many were rejected and how fast they
+// were read, then prints them sorted. With `--top K` only the K highest
+// readings are kept as they stream past (`--by-room`: the K rooms with the
+// highest readings, each once), which prints the first K rows of the same
+// table in O(K) memory. With `--packed` readings are kept as 32-bit packed
+// records and counting sorted, at half the memory.
+static int run_ingest(const Options *opts) {
+    EmfData data = {0};
+    TopK top;
+    PackedData packed = {0};
+    if (opts->top_k > 0) {
+        topk_init(&top, opts->top_k, opts->by_room);
+        data.sink = topk_add_block;
+        data.sink_ctx = &top;
+    } else if (opts->packed) {
+        data.sink = packed_add_block;
+        data.sink_ctx = &packed;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = ingest_file(opts->ingest_path, &data);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result == C_OK && opts->top_k > 0) {
+        result = top.error;
+    } else if (result == C_OK && opts->packed) {
+        result = packed.error;
+    }
+    if (result != C_OK) {
+        print_error(result);
+        if (opts->top_k > 0) {
+            topk_free(&top);
+        }
+        packed_free(&packed);
+        emf_data_free(&data);
+        return 1;
+    }
+
+    long valid = opts->top_k > 0 ? top.seen : (opts->packed ? packed.size : data.size);
+    print_summary(&data, valid, &start, &end);
+
+    if (opts->packed) {
+        int status = finish_packed(opts, &packed);
+        packed_free(&packed);
+        emf_data_free(&data);
+        return status;
+    }
+    if (opts->top_k > 0) {
+        // The kept readings replace the (empty) arrays for printing
+        emf_data_free(&data);
+        data.ids = malloc((top.size ? top.size : 1) * sizeof *data.ids);
+        data.readings = malloc((top.size ? top.size : 1) * sizeof *data.readings);
+        data.size = data.ids && data.readings ? topk_result(&top, data.ids, data.readings) : C_ERR_NO_MEMORY;
+        topk_free(&top);
+        result = data.size < 0 ? data.size : C_OK;
+    } else {
+        result = sort_entries(data.ids, data.readings, data.size);
+    }
+    if (result == C_ERR_NO_MEMORY) {
+        print_error(result);
+        emf_data_free(&data);
+        return 1;
+    }
+    print_entries(data.ids, data.readings, data.size);
+    emf_data_free(&data);
+    return 0;
+}
+
+// `./a1 --ingest FILE --rooms`: count, lowest, highest and mean reading of
+// every room, kept in a table indexed by room ID as the file streams past
+// instead of storing the readings. With `--top K`, the K rooms with the most
+// readings, most first.
+static int run_rooms(const Options *opts) {
+    RoomTable table;
+    if (rooms_init(&table) != C_OK) {
+        print_error(C_ERR_NO_MEMORY);
+        return 1;
+    }
+    EmfData data = {0};
+    data.sink = rooms_add_block;
+    data.sink_ctx = &table;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = ingest_file(opts->ingest_path, &data);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result == C_OK) {
+        print_summary(&data, table.readings, &start, &end);
+        result = opts->top_k > 0 ? print_busiest_rooms(&table, opts->top_k) : print_rooms(&table);
+    }
+    if (result != C_OK) {
+        print_error(result);
+    }
+    emf_data_free(&data);
+    rooms_free(&table);
+    return result == C_OK ? 0 : 1;
+}
+
+// `./a1 --load FILE`: print a dump written with --dump (and, with --dump,
+// write it out again)
+static int run_load(const Options *opts) {
+    PackedData packed = {0};
+    int result = packed_read(opts->load_path, &packed);
+    if (result != C_OK) {
+        print_error(result);
+        packed_free(&packed);
+        return 1;
+    }
+    int status = finish_packed(opts, &packed);
+    packed_free(&packed);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    Options opts = {0};
+    int usable = 1;
+    for (int i = 1; i < argc && usable; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--ingest") == 0) {
+            opts.ingest_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--load") == 0) {
+            opts.load_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--dump") == 0) {
+            opts.dump_path = argv[++i];
+            opts.packed = 1;
+        } else if (i + 1 < argc && strcmp(argv[i], "--top") == 0 && atoi(argv[i + 1]) > 0) {
+            opts.top_k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--by-room") == 0) {
+            opts.by_room = 1;
+        } else if (strcmp(argv[i], "--packed") == 0) {
+            opts.packed = 1;
+        } else if (strcmp(argv[i], "--rooms") == 0) {
+            opts.rooms = 1;
+        } else {
+            usable = 0;
+        }
+    }
+    // One input, --by-room only with --top, top-K keeps no packed records to
+    // dump, and the room table keeps neither readings nor records
+    usable &= !(opts.ingest_path && opts.load_path) && !(opts.by_room && opts.top_k <= 0) &&
+              !(opts.top_k > 0 && opts.packed) && !(opts.load_path && opts.top_k > 0) &&
+              !(opts.rooms && (!opts.ingest_path || opts.packed || opts.by_room));
+    if (usable && opts.rooms) {
+        return run_rooms(&opts);
+    }
+    if (usable && opts.ingest_path) {
+        return run_ingest(&opts);
+    }
+    if (usable && opts.load_path) {
+        return run_load(&opts);
+    }
+    if (argc != 1) {
+        printf("Usage: %s [--ingest FILE [--top K [--by-room]] [--packed] [--dump OUT]] [--load DUMP [--dump OUT]]\n"
+               "       %s --ingest FILE --rooms [--top K]\n",
+               argv[0], argv[0]);
+        return 1;
+    }
+
     // Define variables and call the functions from readings.c here
     int room_ids[MAX_ENTRIES];
     float emf_readings[MAX_ENTRIES];
@@ -0,0 +1,191 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "readings.h"
+
+// Packed readings: one 32-bit record per reading instead of an int plus a
+// float. Room IDs span ROOM_MIN..ROOM_MAX (80,000 values, 17 bits as an
+// offset) and readings 0.00..5.00 in hundredths (501 values, 9 bits):
+//
+//   bits 31..26  zero
+//   bits 25..17  PACK_CENTI_MAX - reading in hundredths
+//   bits 16..0   room id - ROOM_MIN
+//
+// The reading is stored inverted, so comparing records as unsigned integers
+// orders them highest reading first, then by room: a dump can be merged or
+// searched with plain integer compares. sort_packed sorts on the reading
+// field alone with a stable counting sort (501 buckets), which keeps equal
+// readings in input order exactly like sort_entries.
+//
+// A reading is stored as the hundredths print_entries shows, so readings
+// typed with more decimals are rounded, as they are when printed.
+
+#define PACK_MAGIC "EMF1" // first 4 bytes of a dump, then the record count
+
+// Reading in hundredths, rounded like printf("%.2f") rounds it: the float
+// times 100 is exact in a double, and a tie goes to the even neighbour
+static int reading_centi(float reading) {
+    double scaled = (double)reading * 100.0;
+    int centi = (int)scaled;
+    double rest = scaled - centi;
+    return centi + (rest > 0.5 || (rest == 0.5 && (centi & 1)));
+}
+
+// Pack one valid pair. Returns C_OK, C_ERR_INVALID_ROOM or C_ERR_INVALID_EMF.
+int pack_record(int id, float reading, uint32_t *record) {
+    if (invalid_room(id) != C_OK) {
+        return C_ERR_INVALID_ROOM;
+    }
+    if (invalid_reading(reading) != C_OK) {
+        return C_ERR_INVALID_EMF;
+    }
+    uint32_t centi = (uint32_t)reading_centi(reading);
+    *record = ((PACK_CENTI_MAX - centi) << PACK_ROOM_BITS) | (uint32_t)(id - ROOM_MIN);
+    return C_OK;
+}
+
+int record_id(uint32_t record) {
+    return ROOM_MIN + (int)(record & ((1u << PACK_ROOM_BITS) - 1));
+}
+
+float record_reading(uint32_t record) {
+    return (PACK_CENTI_MAX - (int)(record >> PACK_ROOM_BITS)) / 100.0f;
+}
+
+// Append to the growable record array
+static int packed_reserve(PackedData *data, int extra) {
+    if (data->size + extra <= data->capacity) {
+        return C_OK;
+    }
+    int capacity = data->capacity ? data->capacity : 1024;
+    while (capacity < data->size + extra) {
+        if (capacity > INT_MAX / 2) {
+            return C_ERR_NO_MEMORY;
+        }
+        capacity *= 2;
+    }
+    uint32_t *records = realloc(data->records, (size_t)capacity * sizeof *records);
+    if (!records) {
+        return C_ERR_NO_MEMORY;
+    }
+    data->records = records;
+    data->capacity = capacity;
+    return C_OK;
+}
+
+// Pack a block of valid pairs onto the end of a PackedData (an ingest sink,
+// see EmfData), so a file is read at 4 bytes per reading
+void packed_add_block(void *ctx, const int ids[], const float readings[], int size) {
+    PackedData *data = ctx;
+    if (data->error != C_OK || (data->error = packed_reserve(data, size)) != C_OK) {
+        return;
+    }
+    for (int i = 0; i < size; i++) {
+        if (pack_record(ids[i], readings[i], &data->records[data->size]) == C_OK) {
+            data->size++;
+        }
+    }
+}
+
+// Stable counting sort on the reading field: highest reading first, equal
+// readings in input order (the order sort_entries gives). O(n + 501) with one
+// scratch copy. Returns C_OK, C_ERR_EMPTY_ARRAY or C_ERR_NO_MEMORY.
+int sort_packed(uint32_t records[], int size) {
+    if (size <= 0) {
+        return C_ERR_EMPTY_ARRAY;
+    }
+    uint32_t *scratch = malloc((size_t)size * sizeof *scratch);
+    if (!scratch) {
+        return C_ERR_NO_MEMORY;
+    }
+    size_t starts[PACK_CENTI_MAX + 2] = {0};
+    for (int i = 0; i < size; i++) {
+        starts[(records[i] >> PACK_ROOM_BITS) + 1]++;
+    }
+    for (int c = 1; c <= PACK_CENTI_MAX + 1; c++) {
+        starts[c] += starts[c - 1];
+    }
+    for (int i = 0; i < size; i++) {
+        scratch[starts[records[i] >> PACK_ROOM_BITS]++] = records[i];
+    }
+    memcpy(records, scratch, (size_t)size * sizeof *records);
+    free(scratch);
+    return C_OK;
+}
+
+// The print_entries table for packed records
+int print_packed(const uint32_t records[], int size) {
+    if (size <= 0) {
+        return C_OK; // Nothing to print
+    }
+
+    printf("\nRoom ID    EMF\n");
+    printf("---------- -----\n");
+    for (int i = 0; i < size; i++) {
+        printf("%-10d %.2f\n", record_id(records[i]), record_reading(records[i]));
+    }
+    printf("---------- -----\n");
+    printf("Total Entries: %d\n", size);
+    return C_OK;
+}
+
+// Write a binary dump: PACK_MAGIC, a 32-bit record count, then the records,
+// all in host byte order. Returns C_OK or C_ERR_INVALID_FILE.
+int packed_write(const char *path, const uint32_t records[], int size) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        return C_ERR_INVALID_FILE;
+    }
+    uint32_t count = (uint32_t)size;
+    int ok = fwrite(PACK_MAGIC, 1, 4, out) == 4 && fwrite(&count, sizeof count, 1, out) == 1 &&
+             fwrite(records, sizeof *records, (size_t)size, out) == (size_t)size;
+    ok &= fclose(out) == 0;
+    return ok ? C_OK : C_ERR_INVALID_FILE;
+}
+
+// Read a dump written by packed_write into `data` (zero-initialised or
+// freed). The record count must match the file size exactly, so nothing is
+// allocated for records that are not there. Returns C_OK, C_ERR_INVALID_FILE
+// (missing, not a dump, cut short or with bytes after the records) or
+// C_ERR_NO_MEMORY.
+int packed_read(const char *path, PackedData *data) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        return C_ERR_INVALID_FILE;
+    }
+    struct stat st;
+    char magic[4];
+    uint32_t count;
+    int result = C_OK;
+    if (fstat(fileno(in), &st) != 0 || fread(magic, 1, 4, in) != 4 || memcmp(magic, PACK_MAGIC, 4) != 0 ||
+        fread(&count, sizeof count, 1, in) != 1 || count > INT_MAX ||
+        (uint64_t)st.st_size != 4 + sizeof count + (uint64_t)count * sizeof *data->records) {
+        result = C_ERR_INVALID_FILE;
+    } else if (packed_reserve(data, (int)count) != C_OK) {
+        result = C_ERR_NO_MEMORY;
+    } else if (fread(data->records + data->size, sizeof *data->records, count, in) != count) {
+        result = C_ERR_INVALID_FILE;
+    } else {
+        // Every record must unpack to a valid room and reading
+        for (uint32_t i = 0; i < count && result == C_OK; i++) {
+            uint32_t record = data->records[data->size + i];
+            if ((record >> PACK_ROOM_BITS) > PACK_CENTI_MAX ||
+                (record & ((1u << PACK_ROOM_BITS) - 1)) > (uint32_t)(ROOM_MAX - ROOM_MIN)) {
+                result = C_ERR_INVALID_FILE;
+            }
+        }
+        if (result == C_OK) {
+            data->size += (int)count;
+        }
+    }
+    fclose(in);
+    return result;
+}
+
+void packed_free(PackedData *data) {
+    free(data->records);
+    memset(data, 0, sizeof *data);
+}
@@ -1,34 +1,24 @@
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-// Read `main.c` for information about these forward declarations.
-// Do NOT define the functionality here, but instead, define them below.
-#define MAX_ENTRIES 16
-#define C_OK 0
-#define C_ERR_EMPTY_ARRAY -1
-#define C_ERR_INVALID_EMF -2
-#define C_ERR_INVALID_ROOM -3
-#define C_EXIT_CODE -1.0
-
-// defining our min and max ranges for convenience
-#define ROOM_MAX 13379999
-#define ROOM_MIN 13300000
-#define EMF_MIN 0.00
-#define EMF_MAX 5.00
+// The defined values and forward declarations are in readings.h; define the
+// functions below.
+#include "readings.h"
 
-// key topic to understand is => "synchronized arrays"
+// Batch kernels (validate_entries, find_max_index) use SIMD where the
+// compiler targets it: SSE2 is always there on x86-64, AVX2 with -mavx2 or
+// -march=native. Other targets use the scalar loops alone.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EMF_SIMD 8 // lanes per vector
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define EMF_SIMD 4
+#endif
 
-// Do *not* place your function implementations right here; these are
-// forward declarations, and are intended to tell the rest of the code
-// that these functions will be found. It means we do not have to worry
-// about the order that our functions are written in.
-// You can use these "prototypes" or "signatures", and copy-paste them to
-// write your functions below, similar to the broken "sort_entries" function.
-int get_entries(int ids[], float readings[]);
-int print_entries(int ids[], float readings[], int size);
-int sort_entries(int ids[], float readings[], int size);
-int find_max_index(float readings[], int size);
-int invalid_room(int id);
-int invalid_reading(float reading);
+// key topic to understand is => "synchronized arrays"
 
 // function implementation below, as instructed
 int get_entries(int ids[], float readings[]) {
@@ -86,12 +76,58 @@ int print_entries(int ids[], float readings[], int size) {
     return C_OK;
 }
 
+// Index of the highest reading; the first one if it appears more than once
+// (and index 0 if readings[0] is NaN, which nothing compares above).
+// Each SIMD lane keeps the first maximum of the readings it sees, and the
+// lanes are then combined lowest index first among equal maxima, so the
+// result is the same as the one-at-a-time loop's.
 int find_max_index(float readings[], int size) {
     if (size <= 0) {
         return C_ERR_EMPTY_ARRAY;
     }
     int max_idx = 0;
-    for (int i = 1; i < size; i++) {
+    int i = 1;
+#ifdef EMF_SIMD
+    float lane_max[EMF_SIMD];
+    int lane_idx[EMF_SIMD];
+#if defined(__AVX2__)
+    __m256 best = _mm256_set1_ps(readings[0]);
+    __m256i best_idx = _mm256_setzero_si256();
+    __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (i = 0; i + EMF_SIMD <= size; i += EMF_SIMD) {
+        __m256 r = _mm256_loadu_ps(readings + i);
+        __m256 higher = _mm256_cmp_ps(r, best, _CMP_GT_OQ);
+        best = _mm256_blendv_ps(best, r, higher);
+        best_idx = _mm256_castps_si256(
+            _mm256_blendv_ps(_mm256_castsi256_ps(best_idx), _mm256_castsi256_ps(idx), higher));
+        idx = _mm256_add_epi32(idx, _mm256_set1_epi32(EMF_SIMD));
+    }
+    _mm256_storeu_ps(lane_max, best);
+    _mm256_storeu_si256((__m256i *)lane_idx, best_idx);
+#else
+    __m128 best = _mm_set1_ps(readings[0]);
+    __m128i best_idx = _mm_setzero_si128();
+    __m128i idx = _mm_setr_epi32(0, 1, 2, 3);
+    for (i = 0; i + EMF_SIMD <= size; i += EMF_SIMD) {
+        __m128 r = _mm_loadu_ps(readings + i);
+        __m128 higher = _mm_cmpgt_ps(r, best);
+        best = _mm_or_ps(_mm_and_ps(higher, r), _mm_andnot_ps(higher, best));
+        __m128i take = _mm_castps_si128(higher);
+        best_idx = _mm_or_si128(_mm_and_si128(take, idx), _mm_andnot_si128(take, best_idx));
+        idx = _mm_add_epi32(idx, _mm_set1_epi32(EMF_SIMD));
+    }
+    _mm_storeu_ps(lane_max, best);
+    _mm_storeu_si128((__m128i *)lane_idx, best_idx);
+#endif
+    // Every lane started at readings[0], so its maximum is a real reading
+    for (int lane = 0; lane < EMF_SIMD; lane++) {
+        if (lane_max[lane] > readings[max_idx] ||
+            (lane_max[lane] == readings[max_idx] && lane_idx[lane] < max_idx)) {
+            max_idx = lane_idx[lane];
+        }
+    }
+#endif
+    for (; i < size; i++) {
         if (readings[i] > readings[max_idx]) {
             max_idx = i;
         }
@@ -99,34 +135,106 @@ int find_max_index(float readings[], int size) {
     return max_idx;
 }
 
-int sort_entries(int ids[], float readings[], int size) {
-    if (size <= 0) {
-        return C_ERR_EMPTY_ARRAY;
-    }
+// Sort key of a reading: valid readings are never negative, and the bits of
+// a non-negative float order like the floats themselves, so inverting them
+// gives an unsigned key that sorts highest reading first. Adding 0.0f turns
+// -0.0 (which passes the range check) into 0.0.
+static uint32_t emf_key(float reading) {
+    uint32_t bits;
+    reading += 0.0f;
+    memcpy(&bits, &reading, sizeof bits);
+    return ~bits;
+}
 
-    int temp_ids[MAX_ENTRIES];
-    float temp_readings[MAX_ENTRIES];
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES 3 // 33 bits cover the 32-bit key
 
-    // 1. Creatie deep copies
-    for (int i = 0; i < size; i++) {
-        temp_ids[i] = ids[i];
-        temp_readings[i] = readings[i];
+// Stable LSD radix sort of the pairs on emf_key, one 11-bit digit per pass,
+// moving pairs between the caller's arrays and one scratch copy. All digit
+// counts come from a single read, and a pass where every key has the same
+// digit (the top bits of readings in 0.00 to 5.00 mostly do) is skipped.
+static int radix_sort_entries(int ids[], float readings[], int size) {
+    int *scratch_ids = malloc((size_t)size * sizeof *scratch_ids);
+    float *scratch_readings = malloc((size_t)size * sizeof *scratch_readings);
+    size_t(*counts)[RADIX_SIZE] = calloc(RADIX_PASSES, sizeof *counts);
+    if (!scratch_ids || !scratch_readings || !counts) {
+        free(scratch_ids);
+        free(scratch_readings);
+        free(counts);
+        return C_ERR_NO_MEMORY;
     }
 
-    // Loopp over each position and find the max from the copies
     for (int i = 0; i < size; i++) {
-        int max_idx = find_max_index(temp_readings, size);
+        uint32_t key = emf_key(readings[i]);
+        for (int p = 0; p < RADIX_PASSES; p++) {
+            counts[p][(key >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
 
-        // case where find_max_index might return error
-        if (max_idx < 0)
-            return C_ERR_EMPTY_ARRAY;
+    int *from_ids = ids, *to_ids = scratch_ids;
+    float *from_readings = readings, *to_readings = scratch_readings;
+    for (int p = 0; p < RADIX_PASSES; p++) {
+        int shift = p * RADIX_BITS;
+        if (counts[p][(emf_key(readings[0]) >> shift) & (RADIX_SIZE - 1)] == (size_t)size) {
+            continue; // every key has this digit: the pass would change nothing
+        }
+        // Counts to starting positions
+        size_t next = 0;
+        for (int d = 0; d < RADIX_SIZE; d++) {
+            size_t count = counts[p][d];
+            counts[p][d] = next;
+            next += count;
+        }
+        for (int i = 0; i < size; i++) {
+            size_t pos = counts[p][(emf_key(from_readings[i]) >> shift) & (RADIX_SIZE - 1)]++;
+            to_ids[pos] = from_ids[i];
+            to_readings[pos] = from_readings[i];
+        }
+        int *swap_ids = from_ids;
+        from_ids = to_ids;
+        to_ids = swap_ids;
+        float *swap_readings = from_readings;
+        from_readings = to_readings;
+        to_readings = swap_readings;
+    }
 
-        // Place found max value into the original array at current position
-        ids[i] = temp_ids[max_idx];
-        readings[i] = temp_readings[max_idx];
+    // An odd number of passes leaves the result in the scratch copy
+    if (from_ids != ids) {
+        memcpy(ids, from_ids, (size_t)size * sizeof *ids);
+        memcpy(readings, from_readings, (size_t)size * sizeof *readings);
+    }
+    free(scratch_ids);
+    free(scratch_readings);
+    free(counts);
+    return C_OK;
+}
 
-        // Mark the used value in the copy with a sentinel value
-        temp_readings[max_idx] = -1.0f;
+// Sorts the synchronized arrays by reading, highest first, moving each id
+// with its reading. Equal readings keep their input order, as they did with
+// the original repeated find_max_index. Small inputs (everything the
+// interactive entry can hold) use an in-place insertion sort; larger ones the
+// O(n) radix sort above.
+int sort_entries(int ids[], float readings[], int size) {
+    if (size <= 0) {
+        return C_ERR_EMPTY_ARRAY;
+    }
+    if (size > SORT_SMALL) {
+        return radix_sort_entries(ids, readings, size);
+    }
+
+    for (int i = 1; i < size; i++) {
+        int id = ids[i];
+        float reading = readings[i];
+        int j = i;
+        // Shift lower readings right; stop at an equal one to stay stable
+        while (j > 0 && readings[j - 1] < reading) {
+            ids[j] = ids[j - 1];
+            readings[j] = readings[j - 1];
+            j--;
+        }
+        ids[j] = id;
+        readings[j] = reading;
     }
     return C_OK;
 }
@@ -141,4 +249,92 @@ int invalid_room(int id) {
 int invalid_reading(float reading) {
     return ((reading >= EMF_MIN) && (reading <= EMF_MAX)) ? C_OK
                                                           : C_ERR_INVALID_EMF;
-}
\ No newline at end of file
+}
+
+// validate_entries one pair at a time, from pair i on, with `kept` pairs
+// already kept
+static int validate_scalar(int ids[], float readings[], int i, int size, int kept, long *bad_room,
+                           long *bad_emf) {
+    for (; i < size; i++) {
+        if (invalid_room(ids[i]) != C_OK) {
+            (*bad_room)++;
+        } else if (invalid_reading(readings[i]) != C_OK) {
+            (*bad_emf)++;
+        } else {
+            ids[kept] = ids[i];
+            readings[kept] = readings[i];
+            kept++;
+        }
+    }
+    return kept;
+}
+
+#ifdef EMF_SIMD
+#define EMF_BLOCK 8 // pairs range-checked per step
+
+// Range-check 8 pairs at once: bit j of the result is set if ids[j] fails
+// invalid_room, bit j of *emf_ok if readings[j] passes invalid_reading (the
+// ordered compares fail for NaN, as the scalar ones do)
+static unsigned block_masks(const int ids[], const float readings[], unsigned *emf_ok) {
+#if defined(__AVX2__)
+    __m256i id = _mm256_loadu_si256((const __m256i *)ids);
+    __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(ROOM_MIN), id),
+                                  _mm256_cmpgt_epi32(id, _mm256_set1_epi32(ROOM_MAX)));
+    __m256 r = _mm256_loadu_ps(readings);
+    __m256 ok = _mm256_and_ps(_mm256_cmp_ps(r, _mm256_set1_ps((float)EMF_MIN), _CMP_GE_OQ),
+                              _mm256_cmp_ps(r, _mm256_set1_ps((float)EMF_MAX), _CMP_LE_OQ));
+    *emf_ok = (unsigned)_mm256_movemask_ps(ok);
+    return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(bad));
+#else
+    unsigned room_bad = 0;
+    *emf_ok = 0;
+    for (int half = 0; half < 2; half++) {
+        __m128i id = _mm_loadu_si128((const __m128i *)(ids + 4 * half));
+        __m128i bad = _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(ROOM_MIN), id),
+                                   _mm_cmpgt_epi32(id, _mm_set1_epi32(ROOM_MAX)));
+        __m128 r = _mm_loadu_ps(readings + 4 * half);
+        __m128 ok = _mm_and_ps(_mm_cmpge_ps(r, _mm_set1_ps((float)EMF_MIN)),
+                               _mm_cmple_ps(r, _mm_set1_ps((float)EMF_MAX)));
+        *emf_ok |= (unsigned)_mm_movemask_ps(ok) << (4 * half);
+        room_bad |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(bad)) << (4 * half);
+    }
+    return room_bad;
+#endif
+}
+#endif
+
+// Bulk version of the two checks above, for readings loaded from a file:
+// keeps the pairs that pass both, in order, at the front of the arrays and
+// adds the others to the counts instead of printing each one. A bad room is
+// counted even if the reading is bad too, as get_entries reports it.
+// Returns the number of pairs kept.
+int validate_entries(int ids[], float readings[], int size, long *bad_room, long *bad_emf) {
+    int kept = 0, i = 0;
+#ifdef EMF_SIMD
+    for (; i + EMF_BLOCK <= size; i += EMF_BLOCK) {
+        unsigned emf_ok;
+        unsigned room_bad = block_masks(ids + i, readings + i, &emf_ok);
+        unsigned valid = ~room_bad & emf_ok & 0xFFu;
+        *bad_room += __builtin_popcount(room_bad);
+        *bad_emf += __builtin_popcount(~room_bad & ~emf_ok & 0xFFu);
+        if (valid == 0xFFu) {
+            // All kept: move the block down whole (memmove, as the ranges can
+            // overlap), or leave it if nothing has been dropped yet
+            if (kept != i) {
+                memmove(ids + kept, ids + i, EMF_BLOCK * sizeof *ids);
+                memmove(readings + kept, readings + i, EMF_BLOCK * sizeof *readings);
+            }
+            kept += EMF_BLOCK;
+            continue;
+        }
+        // Copy every pair forward and advance past the valid ones (kept <= i,
+        // so nothing is overwritten before it is read)
+        for (int j = 0; j < EMF_BLOCK; j++) {
+            ids[kept] = ids[i + j];
+            readings[kept] = readings[i + j];
+            kept += (valid >> j) & 1;
+        }
+    }
+#endif
+    return validate_scalar(ids, readings, i, size, kept, bad_room, bad_emf);
+}
@@ -0,0 +1,144 @@
+#ifndef READINGS_H
+#define READINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared by main.c, readings.c and bench.c, so the defined values and the
+// forward declarations live in one place instead of being copy-pasted.
+
+// These are defined values.
+// They do not reserve memory like a variable.
+// Instead, the first phase of building - "pre-processing"
+// Will essentially find-and-replace with what is written to the right.
+#define MAX_ENTRIES 16
+#define C_OK 0
+#define C_ERR_EMPTY_ARRAY -1
+#define C_ERR_INVALID_EMF -2
+#define C_ERR_INVALID_ROOM -3
+#define C_ERR_NO_MEMORY -4
+#define C_ERR_INVALID_FILE -5
+#define C_EXIT_CODE -1.0
+
+// defining our min and max ranges for convenience
+#define ROOM_MAX 13379999
+#define ROOM_MIN 13300000
+#define EMF_MIN 0.00
+#define EMF_MAX 5.00
+
+// Inputs up to this size are sorted in place by insertion; larger ones by a
+// radix sort with one scratch copy of the pairs
+#define SORT_SMALL 64
+
+// Readings loaded in bulk (ingest.c): synchronized arrays that grow as
+// needed, plus how many records were turned away and why. Zero-initialise
+// before the first ingest_file / ingest_text.
+typedef struct {
+    int *ids;
+    float *readings;
+    int size;      // valid pairs held
+    int capacity;  // pairs the arrays have room for
+    long bad_room;  // rejected by invalid_room
+    long bad_emf;   // rejected by invalid_reading
+    long malformed; // lines that were not "id reading"
+    // Optional: called with each block of valid pairs as it is read, which
+    // are then dropped instead of kept, so memory stays one block
+    void (*sink)(void *ctx, const int ids[], const float readings[], int size);
+    void *sink_ctx;
+} EmfData;
+
+// Streaming top-K (topk.c): the K best readings of a stream, or with
+// by_room the K rooms with the best readings, in O(K) memory
+typedef struct {
+    int id;
+    float reading;
+    long seq; // position among the readings offered, for ties
+} TopEntry;
+
+typedef struct {
+    int id;
+    int pos; // heap index, or -1 for a free slot
+} RoomSlot;
+
+typedef struct {
+    TopEntry *heap; // worst kept reading at the root
+    int size;
+    int capacity;
+    int k;
+    int by_room;
+    RoomSlot *map;  // by_room: room id -> heap index
+    int map_mask;
+    long seen;      // readings offered so far
+    int error;      // first topk_add failure in topk_add_block, or C_OK
+} TopK;
+
+// Packed records (packed.c): one uint32_t per reading, holding the room as
+// an offset from ROOM_MIN in the low PACK_ROOM_BITS and the reading in
+// hundredths, inverted, above it. As unsigned integers they sort highest
+// reading first, then by room.
+#define PACK_ROOM_BITS 17   // 80,000 room IDs
+#define PACK_CENTI_MAX 500  // EMF_MAX in hundredths (9 bits)
+
+typedef struct {
+    uint32_t *records;
+    int size;
+    int capacity;
+    int error; // first failure in packed_add_block, or C_OK
+} PackedData;
+
+// Per-room aggregates (rooms.c): one entry per valid room ID, at index
+// id - ROOM_MIN
+#define ROOM_COUNT (ROOM_MAX - ROOM_MIN + 1) // 80,000 rooms
+
+typedef struct {
+    long count; // readings of this room; 0 if never seen
+    float min;
+    float max;
+    double sum;
+} RoomStats;
+
+typedef struct {
+    RoomStats *rooms; // ROOM_COUNT entries
+    int active;       // rooms with at least one reading
+    long readings;    // readings added
+} RoomTable;
+
+// These are "forward declarations".
+// It tells the rest of the code to expect to find a function
+// that works like this somewhere once we compile and link our code.
+int get_entries(int ids[], float readings[]);
+int print_entries(int ids[], float readings[], int size);
+int sort_entries(int ids[], float readings[], int size);
+int find_max_index(float readings[], int size);
+int invalid_room(int id);
+int invalid_reading(float reading);
+int validate_entries(int ids[], float readings[], int size, long *bad_room, long *bad_emf);
+
+int ingest_file(const char *path, EmfData *data);
+int ingest_text(const char *text, size_t len, EmfData *data);
+void emf_data_free(EmfData *data);
+
+int topk_init(TopK *top, int k, int by_room);
+int topk_add(TopK *top, int id, float reading);
+void topk_add_block(void *top, const int ids[], const float readings[], int size);
+int topk_result(const TopK *top, int ids[], float readings[]);
+void topk_free(TopK *top);
+
+int pack_record(int id, float reading, uint32_t *record);
+int record_id(uint32_t record);
+float record_reading(uint32_t record);
+void packed_add_block(void *ctx, const int ids[], const float readings[], int size);
+int sort_packed(uint32_t records[], int size);
+int print_packed(const uint32_t records[], int size);
+int packed_write(const char *path, const uint32_t records[], int size);
+int packed_read(const char *path, PackedData *data);
+void packed_free(PackedData *data);
+
+int rooms_init(RoomTable *table);
+void rooms_add(RoomTable *table, int id, float reading);
+void rooms_add_block(void *table, const int ids[], const float readings[], int size);
+int print_rooms(const RoomTable *table);
+int print_busiest_rooms(const RoomTable *table, int k);
+void rooms_free(RoomTable *table);
+
+#endif
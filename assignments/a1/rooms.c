@@ -0,0 +1,129 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "readings.h"
+
+// Per-room aggregates: valid room IDs are the dense range ROOM_MIN..ROOM_MAX,
+// so a room's statistics sit at index id - ROOM_MIN of one ROOM_COUNT-entry
+// table (about 2 MB) and each reading updates them in O(1), with no hashing,
+// no sorting and no copy of the readings. Reports walk the table in room
+// order; the "most active" ranking sorts only the rooms that were seen.
+
+// Start an empty table. Returns C_OK or C_ERR_NO_MEMORY.
+int rooms_init(RoomTable *table) {
+    memset(table, 0, sizeof *table);
+    table->rooms = malloc(ROOM_COUNT * sizeof *table->rooms);
+    if (!table->rooms) {
+        return C_ERR_NO_MEMORY;
+    }
+    for (int i = 0; i < ROOM_COUNT; i++) {
+        // Any reading replaces these, so rooms_add needs no first-time case
+        table->rooms[i] = (RoomStats){ 0, FLT_MAX, -FLT_MAX, 0.0 };
+    }
+    return C_OK;
+}
+
+// Add one reading of a valid room (see invalid_room / invalid_reading)
+void rooms_add(RoomTable *table, int id, float reading) {
+    RoomStats *room = &table->rooms[id - ROOM_MIN];
+    table->active += room->count == 0;
+    table->readings++;
+    room->count++;
+    room->sum += reading;
+    if (reading < room->min) {
+        room->min = reading;
+    }
+    if (reading > room->max) {
+        room->max = reading;
+    }
+}
+
+// Add a block of valid readings (an ingest sink, see EmfData)
+void rooms_add_block(void *table, const int ids[], const float readings[], int size) {
+    for (int i = 0; i < size; i++) {
+        rooms_add(table, ids[i], readings[i]);
+    }
+}
+
+static void print_room_header(void) {
+    printf("\nRoom ID    Readings   Min   Max   Mean\n");
+    printf("---------- ---------- ----- ----- -----\n");
+}
+
+static void print_room(const RoomTable *table, int offset) {
+    const RoomStats *room = &table->rooms[offset];
+    printf("%-10d %-10ld %-5.2f %-5.2f %.2f\n", ROOM_MIN + offset, room->count, room->min, room->max,
+           room->sum / room->count);
+}
+
+static void print_room_footer(int rooms, long readings) {
+    printf("---------- ---------- ----- ----- -----\n");
+    printf("Total Rooms: %d (%ld readings)\n", rooms, readings);
+}
+
+// Every room with at least one reading, in room ID order
+int print_rooms(const RoomTable *table) {
+    if (table->active == 0) {
+        return C_OK; // Nothing to print
+    }
+
+    print_room_header();
+    for (int offset = 0; offset < ROOM_COUNT; offset++) {
+        if (table->rooms[offset].count > 0) {
+            print_room(table, offset);
+        }
+    }
+    print_room_footer(table->active, table->readings);
+    return C_OK;
+}
+
+typedef struct {
+    long count;
+    int offset;
+} ActiveRoom;
+
+// Most readings first, then the lower room ID
+static int active_order(const void *a, const void *b) {
+    const ActiveRoom *x = a, *y = b;
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return x->offset - y->offset;
+}
+
+// The k rooms with the most readings (all of them if k < 1), most active
+// first, ties by room ID. Returns C_OK or C_ERR_NO_MEMORY.
+int print_busiest_rooms(const RoomTable *table, int k) {
+    if (table->active == 0) {
+        return C_OK; // Nothing to print
+    }
+    ActiveRoom *active = malloc((size_t)table->active * sizeof *active);
+    if (!active) {
+        return C_ERR_NO_MEMORY;
+    }
+    int n = 0;
+    for (int offset = 0; offset < ROOM_COUNT; offset++) {
+        if (table->rooms[offset].count > 0) {
+            active[n++] = (ActiveRoom){ table->rooms[offset].count, offset };
+        }
+    }
+    qsort(active, (size_t)n, sizeof *active, active_order);
+
+    int shown = k > 0 && k < n ? k : n;
+    long readings = 0;
+    print_room_header();
+    for (int i = 0; i < shown; i++) {
+        print_room(table, active[i].offset);
+        readings += active[i].count;
+    }
+    print_room_footer(shown, readings);
+    free(active);
+    return C_OK;
+}
+
+void rooms_free(RoomTable *table) {
+    free(table->rooms);
+    memset(table, 0, sizeof *table);
+}
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "readings.h"
+
+// Streaming top-K: the K best readings seen so far sit in a min-heap with
+// the worst of them at the root, so a new reading is compared with the root
+// once and, if better, replaces it with one O(log K) sift. "Better" is the
+// order sort_entries gives: higher reading first, then earlier input, so the
+// result is exactly the first K rows of the sorted table.
+//
+// By room, each room is in the heap at most once with its highest reading
+// (first time seen at that value). A map from room id to heap slot finds a
+// room's entry so a higher reading can raise it in place; the map is an
+// open-addressing hash table sized to the heap, so memory stays O(K). A room
+// that was pushed out of the heap can only come back with a reading better
+// than the K it lost to, so nothing it had before can be missing.
+
+#define TOPK_FIRST 1024 // heap capacity allocated first; grows by doubling up to K
+#define TOPK_EMPTY -1   // free room map slot
+
+// a comes first in the sorted table
+static int topk_better(const TopEntry *a, const TopEntry *b) {
+    return a->reading > b->reading || (a->reading == b->reading && a->seq < b->seq);
+}
+
+static unsigned int room_hash(int id) {
+    return (unsigned int)id * 2654435761u;
+}
+
+// Slot of `id` in the room map, or the empty slot where it would go
+static int room_slot(const TopK *top, int id) {
+    int slot = (int)(room_hash(id) & (unsigned int)top->map_mask);
+    while (top->map[slot].pos != TOPK_EMPTY && top->map[slot].id != id) {
+        slot = (slot + 1) & top->map_mask;
+    }
+    return slot;
+}
+
+// Delete a map slot, moving later entries of its probe run back so every
+// entry stays reachable from its home slot
+static void room_unmap(TopK *top, int slot) {
+    int hole = slot;
+    for (int next = (slot + 1) & top->map_mask; top->map[next].pos != TOPK_EMPTY;
+         next = (next + 1) & top->map_mask) {
+        int home = (int)(room_hash(top->map[next].id) & (unsigned int)top->map_mask);
+        // Move it if its home is not in (hole, next] going round the table
+        if (((next - home) & top->map_mask) >= ((next - hole) & top->map_mask)) {
+            top->map[hole] = top->map[next];
+            hole = next;
+        }
+    }
+    top->map[hole].pos = TOPK_EMPTY;
+}
+
+// Put entry e at heap position i, keeping the room map pointing at it
+static void heap_place(TopK *top, int i, TopEntry e) {
+    top->heap[i] = e;
+    if (top->by_room) {
+        int slot = room_slot(top, e.id);
+        top->map[slot].id = e.id;
+        top->map[slot].pos = i;
+    }
+}
+
+static void sift_up(TopK *top, int i) {
+    TopEntry e = top->heap[i];
+    while (i > 0 && topk_better(&top->heap[(i - 1) / 2], &e)) {
+        heap_place(top, i, top->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heap_place(top, i, e);
+}
+
+static void sift_down(TopK *top, int i) {
+    TopEntry e = top->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= top->size) {
+            break;
+        }
+        if (child + 1 < top->size && topk_better(&top->heap[child], &top->heap[child + 1])) {
+            child++;
+        }
+        if (!topk_better(&e, &top->heap[child])) {
+            break;
+        }
+        heap_place(top, i, top->heap[child]);
+        i = child;
+    }
+    heap_place(top, i, e);
+}
+
+// Double the heap (up to K) and, by room, rebuild the map at twice its size
+static int topk_grow(TopK *top) {
+    int capacity = top->capacity ? top->capacity * 2 : TOPK_FIRST;
+    if (capacity > top->k) {
+        capacity = top->k;
+    }
+    TopEntry *heap = realloc(top->heap, (size_t)capacity * sizeof *heap);
+    if (!heap) {
+        return C_ERR_NO_MEMORY;
+    }
+    top->heap = heap;
+    if (!top->by_room) {
+        top->capacity = capacity;
+        return C_OK;
+    }
+
+    int map_size = 16;
+    while (map_size < 2 * capacity) {
+        map_size *= 2;
+    }
+    RoomSlot *map = malloc((size_t)map_size * sizeof *map);
+    if (!map) {
+        return C_ERR_NO_MEMORY;
+    }
+    free(top->map);
+    top->map = map;
+    top->map_mask = map_size - 1;
+    top->capacity = capacity; // only now: the map must keep at least half its slots free
+    for (int i = 0; i < map_size; i++) {
+        map[i].pos = TOPK_EMPTY;
+    }
+    for (int i = 0; i < top->size; i++) {
+        heap_place(top, i, top->heap[i]);
+    }
+    return C_OK;
+}
+
+// Start an empty top-K of the k best readings; with by_room set, of the k
+// rooms with the best readings, each once with its best one.
+// Returns C_OK or C_ERR_EMPTY_ARRAY (k < 1).
+int topk_init(TopK *top, int k, int by_room) {
+    memset(top, 0, sizeof *top);
+    if (k < 1) {
+        return C_ERR_EMPTY_ARRAY;
+    }
+    top->k = k;
+    top->by_room = by_room;
+    return C_OK;
+}
+
+// Offer one valid reading, in input order. O(log K), O(1) when it is not
+// among the K best. Returns C_OK or C_ERR_NO_MEMORY.
+int topk_add(TopK *top, int id, float reading) {
+    TopEntry e = { id, reading, top->seen++ };
+    if (top->size == top->k && reading < top->heap[0].reading) {
+        // Worse than every kept reading, and (by room) lower than the room's
+        // own if it is kept: nothing to do, without a map lookup
+        return C_OK;
+    }
+    if (top->by_room) {
+        if (top->capacity == 0 && topk_grow(top) != C_OK) {
+            return C_ERR_NO_MEMORY;
+        }
+        int slot = room_slot(top, id);
+        if (top->map[slot].pos != TOPK_EMPTY) {
+            // Already in: only a higher reading changes it, and it can only move
+            // away from the root
+            int i = top->map[slot].pos;
+            if (reading > top->heap[i].reading) {
+                top->heap[i] = e;
+                sift_down(top, i);
+            }
+            return C_OK;
+        }
+    }
+
+    if (top->size < top->k) {
+        if (top->size == top->capacity && topk_grow(top) != C_OK) {
+            return C_ERR_NO_MEMORY;
+        }
+        top->size++;
+        top->heap[top->size - 1] = e;
+        sift_up(top, top->size - 1);
+    } else if (topk_better(&e, &top->heap[0])) {
+        if (top->by_room) {
+            room_unmap(top, room_slot(top, top->heap[0].id));
+        }
+        top->heap[0] = e;
+        sift_down(top, 0);
+    }
+    return C_OK;
+}
+
+// Offer a block of valid readings (an ingest sink, see EmfData)
+void topk_add_block(void *top, const int ids[], const float readings[], int size) {
+    TopK *t = top;
+    for (int i = 0; i < size && t->error == C_OK; i++) {
+        t->error = topk_add(t, ids[i], readings[i]);
+    }
+}
+
+static int entry_order(const void *a, const void *b) {
+    return topk_better(b, a) - topk_better(a, b);
+}
+
+// Write the kept readings into ids[]/readings[] (room for K pairs) in
+// sort_entries order, leaving the heap as it is so more can be added.
+// Returns how many there are (at most K), or C_ERR_NO_MEMORY.
+int topk_result(const TopK *top, int ids[], float readings[]) {
+    TopEntry *sorted = malloc((size_t)(top->size ? top->size : 1) * sizeof *sorted);
+    if (!sorted) {
+        return C_ERR_NO_MEMORY;
+    }
+    memcpy(sorted, top->heap, (size_t)top->size * sizeof *sorted);
+    qsort(sorted, (size_t)top->size, sizeof *sorted, entry_order);
+    for (int i = 0; i < top->size; i++) {
+        ids[i] = sorted[i].id;
+        readings[i] = sorted[i].reading;
+    }
+    free(sorted);
+    return top->size;
+}
+
+void topk_free(TopK *top) {
+    free(top->heap);
+    free(top->map);
+    memset(top, 0, sizeof *top);
+}
@@ -0,0 +1,286 @@
+// batch.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "defs.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Line and field reader for --batch input. A regular file is memory-mapped;
+   anything else (a pipe, /dev/stdin) is read into one buffer. Lines and
+   fields are handed out as slices of that memory, never copied, and the
+   number parsers work on the slices directly. */
+
+#define BATCH_READ_CHUNK  (1 << 20)
+#define BATCH_NUM_MAX     64        /* longest number token strtof is given */
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Read a non-mappable file to the end into a malloc'd buffer.
+static int batch_read_all(BatchInput *in, int fd) {
+    char *buf = NULL;
+    size_t size = 0, capacity = 0;
+    for (;;) {
+        if (size == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : BATCH_READ_CHUNK;
+            char *grown = realloc(buf, new_capacity);
+            if (!grown) {
+                free(buf);
+                return C_ERR_NO_MEMORY;
+            }
+            buf = grown;
+            capacity = new_capacity;
+        }
+        ssize_t got = read(fd, buf + size, capacity - size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            free(buf);
+            return C_ERR_IO;
+        }
+        if (got == 0) break;
+        size += got;
+    }
+    in->data = buf;
+    in->size = size;
+    in->mapped = 0;
+    return C_ERR_OK;
+}
+
+/* ---- batch_open ------------------------------------------------------------
+   Purpose: Make a whole file available to batch_next_line.
+   Params:
+     - in (out): reader, released with batch_close
+     - path (in): file to read
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NOT_FOUND, C_ERR_IO, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int batch_open(BatchInput *in, const char *path) {
+    if (!in || !path) return C_ERR_NULL_PTR;
+    memset(in, 0, sizeof *in);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? C_ERR_NOT_FOUND : C_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return C_ERR_IO;
+    }
+
+    int result = C_ERR_OK;
+    if (S_ISREG(st.st_mode)) {
+        if (st.st_size > 0) {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                result = batch_read_all(in, fd);
+            } else {
+                posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+                in->data = map;
+                in->size = st.st_size;
+                in->mapped = 1;
+            }
+        }
+    } else {
+        result = batch_read_all(in, fd);
+    }
+    close(fd);
+    return result;
+}
+
+/* ---- batch_next_line -------------------------------------------------------
+   Purpose: Hand out the next line, without its line ending.
+   Params:
+     - in (in/out): reader; in->line becomes the line's number (from 1)
+     - line (out): the line's bytes (not NUL-terminated)
+   Returns: 1 if there was a line, 0 at the end of the input
+----------------------------------------------------------------------------- */
+int batch_next_line(BatchInput *in, BatchField *line) {
+    if (in->pos >= in->size) return 0;
+
+    const char *start = in->data + in->pos;
+    const char *nl = memchr(start, '\n', in->size - in->pos);
+    size_t len = nl ? (size_t)(nl - start) : in->size - in->pos;
+    in->pos += len + (nl != NULL);
+    in->line++;
+
+    if (len > 0 && start[len - 1] == '\r') len--;
+    line->s = start;
+    line->len = len;
+    return 1;
+}
+
+/* ---- batch_split -----------------------------------------------------------
+   Purpose: Take the next `sep`-separated field off the front of `rest`.
+   Params:
+     - rest (in/out): what is left of the line; shrinks past the separator
+     - sep (in): separator character
+     - field (out): the field, surrounding blanks removed
+   Returns: 1 if there was a field, 0 if `rest` was already used up
+----------------------------------------------------------------------------- */
+int batch_split(BatchField *rest, char sep, BatchField *field) {
+    if (!rest->s) return 0;
+
+    const char *end = memchr(rest->s, sep, rest->len);
+    size_t len = end ? (size_t)(end - rest->s) : rest->len;
+    *field = batch_trim((BatchField){ rest->s, len });
+    if (end) {
+        rest->s = end + 1;
+        rest->len -= len + 1;
+    } else {
+        rest->s = NULL; // the last field is gone; "a," still gives a second, empty one
+        rest->len = 0;
+    }
+    return 1;
+}
+
+// A slice without leading and trailing blanks.
+BatchField batch_trim(BatchField f) {
+    while (f.len > 0 && is_blank(f.s[0])) {
+        f.s++;
+        f.len--;
+    }
+    while (f.len > 0 && is_blank(f.s[f.len - 1])) {
+        f.len--;
+    }
+    return f;
+}
+
+/* ---- batch_leading_int -----------------------------------------------------
+   Purpose: Parse the decimal int (optional sign) at the start of a field,
+            after any blanks, the way scanf("%d") reads a menu answer.
+   Params:
+     - f (in/out): field; on success it starts right after the number
+     - out (out): value
+   Returns: C_ERR_OK, C_ERR_INVALID (no digits, overflow)
+----------------------------------------------------------------------------- */
+int batch_leading_int(BatchField *f, int *out) {
+    size_t i = 0;
+    while (i < f->len && is_blank(f->s[i])) i++;
+    int negative = 0;
+    if (i < f->len && (f->s[i] == '-' || f->s[i] == '+')) {
+        negative = f->s[i] == '-';
+        i++;
+    }
+    size_t digits = i;
+
+    // Accumulate as a negative number so INT_MIN fits
+    long long v = 0;
+    for (; i < f->len; ++i) {
+        unsigned d = (unsigned char)f->s[i] - '0';
+        if (d > 9) break;
+        v = v * 10 - d;
+        if (v < (long long)INT_MIN) return C_ERR_INVALID;
+    }
+    if (i == digits) return C_ERR_INVALID;
+    if (!negative) {
+        if (v < -(long long)INT_MAX) return C_ERR_INVALID;
+        v = -v;
+    }
+    *out = (int)v;
+    f->s += i;
+    f->len -= i;
+    return C_ERR_OK;
+}
+
+/* ---- batch_int -------------------------------------------------------------
+   Purpose: Parse a whole field as a decimal int (optional sign, surrounding
+            blanks allowed).
+   Params:
+     - f (in): field
+     - out (out): value
+   Returns: C_ERR_OK, C_ERR_INVALID (not a number, trailing junk, overflow)
+----------------------------------------------------------------------------- */
+int batch_int(BatchField f, int *out) {
+    int v;
+    if (batch_leading_int(&f, &v) != C_ERR_OK || batch_trim(f).len != 0) return C_ERR_INVALID;
+    *out = v;
+    return C_ERR_OK;
+}
+
+/* ---- batch_float -----------------------------------------------------------
+   Purpose: Parse a whole field as a float, rounding exactly as scanf("%f")
+            does for the same text.
+   Params:
+     - f (in): field
+     - out (out): value
+   Returns: C_ERR_OK, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int batch_float(BatchField f, float *out) {
+    f = batch_trim(f);
+    if (f.len == 0 || f.len >= BATCH_NUM_MAX) return C_ERR_INVALID;
+
+    // strtof needs a terminated string; copy just this token
+    char buf[BATCH_NUM_MAX];
+    memcpy(buf, f.s, f.len);
+    buf[f.len] = '\0';
+    char *end;
+    float v = strtof(buf, &end);
+    if (end != buf + f.len) return C_ERR_INVALID;
+    *out = v;
+    return C_ERR_OK;
+}
+
+/* ---- batch_leading_float ---------------------------------------------------
+   Purpose: Parse the float at the start of a field and ignore the rest, the
+            way scanf("%f") reads a menu answer (and with the same rounding).
+   Params:
+     - f (in): field
+     - out (out): value
+   Returns: C_ERR_OK, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int batch_leading_float(BatchField f, float *out) {
+    f = batch_trim(f);
+    if (f.len == 0) return C_ERR_INVALID;
+
+    // strtof needs a terminated string; a number is never longer than this
+    char buf[BATCH_NUM_MAX];
+    size_t len = f.len < BATCH_NUM_MAX ? f.len : BATCH_NUM_MAX - 1;
+    memcpy(buf, f.s, len);
+    buf[len] = '\0';
+    char *end;
+    float v = strtof(buf, &end);
+    if (end == buf) return C_ERR_INVALID;
+    *out = v;
+    return C_ERR_OK;
+}
+
+/* ---- batch_motion ----------------------------------------------------------
+   Purpose: Parse three blank-separated 0/1 motion flags, e.g. "1 0 1".
+   Params:
+     - f (in): field
+     - motion (out): {left, forward, right}
+   Returns: C_ERR_OK, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int batch_motion(BatchField f, unsigned char motion[3]) {
+    f = batch_trim(f);
+    size_t i = 0;
+    for (int k = 0; k < 3; ++k) {
+        while (i < f.len && is_blank(f.s[i])) i++;
+        if (i == f.len || (f.s[i] != '0' && f.s[i] != '1')) return C_ERR_INVALID;
+        motion[k] = f.s[i++] - '0';
+        if (i < f.len && !is_blank(f.s[i])) return C_ERR_INVALID;
+    }
+    return i == f.len ? C_ERR_OK : C_ERR_INVALID;
+}
+
+/* ---- batch_close -----------------------------------------------------------
+   Purpose: Release the input. The slices handed out become invalid.
+   Params:
+     - in (in/out): reader (reset)
+----------------------------------------------------------------------------- */
+void batch_close(BatchInput *in) {
+    if (!in) return;
+    if (in->mapped) {
+        munmap((void *)in->data, in->size);
+    } else {
+        free((void *)in->data);
+    }
+    memset(in, 0, sizeof *in);
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# batch_test.sh [FILE]
+#
+# Runs a menu input file (inputs.txt by default) through the menu and
+# through --batch, each into a new store, then exports both stores and checks
+# they hold the same rooms and entries. The file must end with the exit
+# choice 0, or the menu run waits for more input. Set A2 to test another
+# binary than ./a2.
+
+A2=${A2:-./a2}
+input=${1:-inputs.txt}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+"$A2" --store "$dir/menu" < "$input" > "$dir/menu.out"
+# Mistakes in the file are reported in both runs; batch mode also exits with 1
+"$A2" --store "$dir/batch" --batch "$input" > "$dir/batch.out"
+
+for run in menu batch; do
+    "$A2" --store "$dir/$run" --export "$dir/$run.csv" | sed -n "s|^Store '$dir/$run': \([^(]*\) (.*|\1|p" > "$dir/$run.state"
+    cat "$dir/$run.csv" >> "$dir/$run.state"
+done
+
+if [ ! -s "$dir/menu.state" ]; then
+    echo "FAIL: could not read back the stores"
+    exit 1
+fi
+if ! cmp -s "$dir/menu.state" "$dir/batch.state"; then
+    echo "FAIL: '$input' gives a different state through --batch than through the menu"
+    diff "$dir/menu.state" "$dir/batch.state" | head -20
+    exit 1
+fi
+echo "PASS: $(head -n 1 "$dir/menu.state")"
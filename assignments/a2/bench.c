@@ -0,0 +1,743 @@
+// bench.c
+//
+// Insert (one at a time and bulk), order index, memory, aggregation, range
+// query, time scan, restart and lookup benchmarks for the
+// log manager. Not part of the a2 program; build with
+//   gcc -O2 -Wall bench.c manager.c btree.c intern.c columns.c query.c persist.c report.c retain.c motion.c rollup.c index.c -o bench
+
+#include "defs.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_ROOMS 16
+
+/* ---- legacy model -----------------------------------------------------------
+   The original array-of-entries insert: find the slot linearly, shift the tail
+   of the entries array and, for every moved entry, search its room's pointer
+   list to patch the pointer. Kept here only as the baseline to compare with.
+----------------------------------------------------------------------------- */
+typedef struct LegacyRoom LegacyRoom;
+
+typedef struct {
+    Reading     data;
+    LegacyRoom *room;
+    int         timestamp;
+} LegacyEntry;
+
+struct LegacyRoom {
+    char          name[MAX_STR];
+    LegacyEntry **entries;
+    int           size;
+};
+
+static int legacy_cmp(const LegacyEntry *a, const LegacyEntry *b) {
+    int room_cmp = strcmp(a->room->name, b->room->name);
+    if (room_cmp != 0) return room_cmp;
+    if (a->data.type != b->data.type) return a->data.type < b->data.type ? -1 : 1;
+    if (a->timestamp != b->timestamp) return a->timestamp < b->timestamp ? -1 : 1;
+    return 0;
+}
+
+static void legacy_insert(LegacyEntry *entries, int *size, LegacyRoom *room,
+                          int type, ReadingValue value, int timestamp) {
+    LegacyEntry new_entry = { .data = { type, value }, .room = room, .timestamp = timestamp };
+
+    int insert_pos = 0;
+    while (insert_pos < *size && legacy_cmp(&new_entry, &entries[insert_pos]) > 0) {
+        insert_pos++;
+    }
+    for (int i = *size; i > insert_pos; --i) {
+        entries[i] = entries[i-1];
+        LegacyRoom *moved = entries[i].room;
+        for (int j = 0; j < moved->size; ++j) {
+            if (moved->entries[j] == &entries[i-1]) {
+                moved->entries[j] = &entries[i];
+                break;
+            }
+        }
+    }
+    entries[insert_pos] = new_entry;
+    (*size)++;
+
+    int pos = 0;
+    while (pos < room->size && legacy_cmp(&entries[insert_pos], room->entries[pos]) > 0) {
+        pos++;
+    }
+    for (int i = room->size; i > pos; --i) {
+        room->entries[i] = room->entries[i-1];
+    }
+    room->entries[pos] = &entries[insert_pos];
+    room->size++;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_legacy(int n, const int *rooms, const int *stamps) {
+    LegacyEntry *entries = malloc(n * sizeof *entries);
+    LegacyRoom lrooms[BENCH_ROOMS];
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(lrooms[r].name, MAX_STR, "Room %02d", r);
+        lrooms[r].entries = malloc(n * sizeof *lrooms[r].entries);
+        lrooms[r].size = 0;
+    }
+
+    ReadingValue value = { .decibels = 40 };
+    int size = 0;
+    double start = now_sec();
+    for (int i = 0; i < n; ++i) {
+        legacy_insert(entries, &size, &lrooms[rooms[i]], TYPE_DB, value, stamps[i]);
+    }
+    double elapsed = now_sec() - start;
+
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        free(lrooms[r].entries);
+    }
+    free(entries);
+    return elapsed;
+}
+
+static double bench_create(int n, const int *rooms, const int *stamps) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    char name[MAX_STR];
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(&rc, name);
+    }
+
+    ReadingValue value = { .decibels = 40 };
+    double start = now_sec();
+    for (int i = 0; i < n; ++i) {
+        entries_create(&ec, rc.rooms[rooms[i]], TYPE_DB, value, stamps[i]);
+    }
+    double elapsed = now_sec() - start;
+
+    entries_free(&ec);
+    rooms_free(&rc);
+    return elapsed;
+}
+
+static double bench_bulk(int n, const int *rooms, const int *stamps) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    char name[MAX_STR];
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(&rc, name);
+    }
+
+    EntryInput *batch = malloc(n * sizeof *batch);
+    for (int i = 0; i < n; ++i) {
+        batch[i].room = rc.rooms[rooms[i]];
+        batch[i].type = TYPE_DB;
+        batch[i].value.decibels = 40;
+        batch[i].timestamp = stamps[i];
+    }
+
+    double start = now_sec();
+    entries_bulk_create(&ec, &rc, batch, n);
+    double elapsed = now_sec() - start;
+
+    free(batch);
+    entries_free(&ec);
+    rooms_free(&rc);
+    return elapsed;
+}
+
+// Insert `n` keys into a sorted array of key/handle pairs (binary search, then
+// shift the tail: the order array EntryCollection used before the B+-tree)
+// and into a BTree.
+static void bench_index(const char *label, const uint64_t *keys, int n) {
+    // The array insert is quadratic; past 100000 keys it runs for minutes
+    int array_n = n <= 100000 ? n : 0;
+    KeyedHandle *array = malloc(n * sizeof *array);
+    double start = now_sec();
+    for (int i = 0; i < array_n; ++i) {
+        int lo = 0, hi = i;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (array[mid].key < keys[i]) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        memmove(&array[lo + 1], &array[lo], (i - lo) * sizeof *array);
+        array[lo].key = keys[i];
+        array[lo].handle = i;
+    }
+    double array_time = now_sec() - start;
+
+    BTree tree = { .size = 0 };
+    start = now_sec();
+    for (int i = 0; i < n; ++i) {
+        btree_insert(&tree, keys[i], i);
+    }
+    double tree_time = now_sec() - start;
+
+    // Both must hold the same handles in the same order
+    BTreeIter it;
+    KeyedHandle kh;
+    int pos = 0;
+    btree_first(&tree, &it);
+    while (pos < array_n && btree_next(&it, &kh) && kh.handle == array[pos].handle) {
+        pos++;
+    }
+    char array_ns[32] = "-";
+    if (array_n) {
+        snprintf(array_ns, sizeof array_ns, "%.1f", array_time * 1e9 / n);
+    }
+    printf("%-8d | %-14s | %-14s | %-14.1f\n", n, label, array_ns, tree_time * 1e9 / n);
+    if (pos != array_n || tree.size != n) {
+        printf("B+-tree order differs from the array\n");
+    }
+
+    btree_free(&tree);
+    free(array);
+}
+
+// Add BENCH_ROOMS rooms ("Room 00", ...) and bulk-load n random entries into
+// ec: a random room and type, a value of that type, and a timestamp in
+// [0, t_range), or any non-negative int when t_range is 0.
+static void bench_load(RoomCollection *rc, EntryCollection *ec, int n, int t_range) {
+    char name[MAX_STR];
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(rc, name);
+    }
+
+    EntryInput *batch = malloc(n * sizeof *batch);
+    for (int i = 0; i < n; ++i) {
+        batch[i].room = rc->rooms[rand() % BENCH_ROOMS];
+        batch[i].type = TYPE_TEMP + rand() % 3;
+        switch (batch[i].type) {
+            case TYPE_TEMP:
+                batch[i].value.temperature = (rand() % 4000) / 100.0f - 10.0f;
+                break;
+            case TYPE_DB:
+                batch[i].value.decibels = rand() % 120;
+                break;
+            default:
+                for (int z = 0; z < 3; ++z) {
+                    batch[i].value.motion[z] = rand() % 8 == 0; // movement is rare
+                }
+        }
+        batch[i].timestamp = t_range > 0 ? rand() % t_range : rand();
+    }
+    entries_bulk_create(ec, rc, batch, n);
+    free(batch);
+}
+
+// Per-room temperature min/max/mean: walking the entries vs the column store.
+// The LogEntry layout before it was packed: stored key, type as an int, and
+// a full Room pointer (32 bytes with padding)
+typedef struct {
+    uint64_t key;
+    Reading  data;
+    Room    *room;
+    int      timestamp;
+} UnpackedEntry;
+
+static void memory_row(const char *label, size_t entry_bytes, const MemoryUsage *mu, size_t slab, int n) {
+    size_t total = slab + mu->order + mu->room_lists + mu->columns;
+    printf("%-14s | %-7zu | %-7.1f | %-7.1f | %-7.1f | %-7.1f | %.1f\n", label, entry_bytes,
+           (double)slab / n, (double)mu->order / n, (double)mu->room_lists / n,
+           (double)mu->columns / n, (double)total / n);
+}
+
+// Bytes per entry held by each structure after `n` entries, one at a time or
+// in bulk, with the packed entry and as it would be with the unpacked one.
+static void bench_memory(int n, int bulk) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    ColumnStore     cs = { 0 };
+    char name[MAX_STR];
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(&rc, name);
+    }
+    columns_attach(&cs, &ec);
+
+    EntryInput *batch = malloc(n * sizeof *batch);
+    for (int i = 0; i < n; ++i) {
+        batch[i].room = rc.rooms[rand() % BENCH_ROOMS];
+        batch[i].type = TYPE_TEMP + rand() % 3;
+        batch[i].value.decibels = rand() % 100;
+        batch[i].timestamp = rand();
+    }
+    if (bulk) {
+        entries_bulk_create(&ec, &rc, batch, n);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            entries_create(&ec, batch[i].room, batch[i].type, batch[i].value, batch[i].timestamp);
+        }
+    }
+    free(batch);
+
+    MemoryUsage mu;
+    entries_memory(&ec, &rc, &mu);
+    size_t per_chunk = sizeof *ec.chunks;
+    char label[32];
+    snprintf(label, sizeof label, "%d %s", n, bulk ? "bulk" : "create");
+    memory_row(label, sizeof(UnpackedEntry), &mu, ec.num_chunks * (SLAB_CHUNK * sizeof(UnpackedEntry) + per_chunk), n);
+    memory_row("  packed", sizeof(LogEntry), &mu, mu.slab, n);
+
+    entries_free(&ec);
+    columns_free(&cs);
+    rooms_free(&rc);
+}
+
+static void bench_aggregate(int n) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    ColumnStore     cs = { 0 };
+    columns_attach(&cs, &ec);
+
+    bench_load(&rc, &ec, n, 0);
+
+    ReadingStats rows[BENCH_ROOMS], cols[BENCH_ROOMS], all;
+    double start = now_sec();
+    memset(rows, 0, sizeof rows);
+    BTreeIter it;
+    btree_first(&ec.order, &it);
+    for (const LogEntry *e = entries_next(&ec, &it); e; e = entries_next(&ec, &it)) {
+        if (entry_type(e) != TYPE_TEMP) continue;
+        ReadingStats *st = &rows[entry_room(e)->id];
+        double x = e->value.temperature;
+        if (st->count == 0 || x < st->min) st->min = x;
+        if (st->count == 0 || x > st->max) st->max = x;
+        st->sum += x;
+        st->count++;
+    }
+    double row_time = now_sec() - start;
+
+    start = now_sec();
+    columns_stats_by_room(&cs, TYPE_TEMP, cols, BENCH_ROOMS);
+    double col_time = now_sec() - start;
+
+    start = now_sec();
+    columns_stats(&cs, TYPE_TEMP, -1, &all);
+    double all_time = now_sec() - start;
+
+    printf("%-8d | %-14.2f | %-14.2f | %-14.2f\n", n, row_time * 1e9 / n, col_time * 1e9 / n, all_time * 1e9 / n);
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        if (rows[r].count != cols[r].count || rows[r].min != cols[r].min || rows[r].max != cols[r].max) {
+            printf("column stats differ for room %d\n", r);
+        }
+    }
+
+    entries_free(&ec);
+    columns_free(&cs);
+    rooms_free(&rc);
+}
+
+// Mean temperature of one room over a random window: scanning every entry vs
+// query_range_stats vs query_range_sum on prefix sums.
+static void bench_query(int n, int queries) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+
+    bench_load(&rc, &ec, n, n);
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        room_build_prefix(rc.rooms[r]);
+    }
+
+    int *windows = malloc(3 * queries * sizeof *windows);
+    for (int q = 0; q < queries; ++q) {
+        windows[3 * q] = rand() % BENCH_ROOMS;
+        windows[3 * q + 1] = rand() % n;
+        windows[3 * q + 2] = windows[3 * q + 1] + n / 10; // about a tenth of the log
+    }
+
+    long scan_count = 0, range_count = 0, prefix_count = 0;
+    double start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        const Room *room = rc.rooms[windows[3 * q]];
+        BTreeIter it;
+        btree_first(&ec.order, &it);
+        for (const LogEntry *e = entries_next(&ec, &it); e; e = entries_next(&ec, &it)) {
+            scan_count += entry_room(e) == room && entry_type(e) == TYPE_TEMP &&
+                          e->timestamp >= windows[3 * q + 1] && e->timestamp <= windows[3 * q + 2];
+        }
+    }
+    double scan = now_sec() - start;
+
+    ReadingStats st;
+    start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        query_range_stats(rc.rooms[windows[3 * q]], TYPE_TEMP, windows[3 * q + 1], windows[3 * q + 2], &st);
+        range_count += st.count;
+    }
+    double range = now_sec() - start;
+
+    start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        query_range_sum(rc.rooms[windows[3 * q]], TYPE_TEMP, windows[3 * q + 1], windows[3 * q + 2], &st);
+        prefix_count += st.count;
+    }
+    double prefix = now_sec() - start;
+
+    printf("%-8d | %-14.1f | %-14.1f | %-14.1f\n", n, scan * 1e6 / queries, range * 1e6 / queries, prefix * 1e6 / queries);
+    if (range_count != scan_count || prefix_count != scan_count) {
+        printf("range query counts differ from the scan\n");
+    }
+
+    free(windows);
+    entries_free(&ec);
+    rooms_free(&rc);
+}
+
+// Mean temperature of one room over about a week of a month of readings:
+// query_range_stats over the entries vs rollup_range_stats over the
+// day/hour/minute buckets.
+static void bench_rollup(int n, int queries) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    RollupStore     rs = { 0 };
+    rollup_attach(&rs, &ec, &rc);
+
+    const int month = 30 * ROLLUP_DAY;
+    bench_load(&rc, &ec, n, month);
+
+    int *windows = malloc(3 * queries * sizeof *windows);
+    for (int q = 0; q < queries; ++q) {
+        windows[3 * q] = rand() % BENCH_ROOMS;
+        windows[3 * q + 1] = rand() % month;
+        windows[3 * q + 2] = windows[3 * q + 1] + 7 * ROLLUP_DAY + rand() % ROLLUP_DAY;
+    }
+
+    long range_count = 0, rollup_count = 0;
+    ReadingStats st;
+    double start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        query_range_stats(rc.rooms[windows[3 * q]], TYPE_TEMP, windows[3 * q + 1], windows[3 * q + 2], &st);
+        range_count += st.count;
+    }
+    double range = now_sec() - start;
+
+    start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        rollup_range_stats(&rs, rc.rooms[windows[3 * q]], TYPE_TEMP, windows[3 * q + 1], windows[3 * q + 2], &st);
+        rollup_count += st.count;
+    }
+    double rollup = now_sec() - start;
+
+    printf("%-8d | %-14.2f | %-14.2f | %.1f\n", n, range * 1e6 / queries, rollup * 1e6 / queries,
+           (double)rollup_bytes(&rs) / n);
+    if (rollup_count != range_count) {
+        printf("rollup counts differ from the range query\n");
+    }
+
+    free(windows);
+    entries_free(&ec);
+    rollup_free(&rs);
+    rooms_free(&rc);
+}
+
+// Sums the timestamps a time scan returns, so the three plans can be checked
+// against each other
+static long long scan_window(const EntryCollection *ec, int type, int t_from, int t_to, long *count) {
+    EntryScan scan;
+    long long sum = 0;
+    if (entries_scan_begin(&scan, ec, type, t_from, t_to) != C_ERR_OK) return 0;
+    for (const LogEntry *e = entries_scan_next(&scan); e; e = entries_scan_next(&scan)) {
+        sum += e->timestamp;
+        ++*count;
+    }
+    entries_scan_end(&scan);
+    return sum;
+}
+
+// Every DB reading in a 1% window across all rooms, in timestamp order: full
+// scan and sort vs the timestamp index vs the (type, timestamp) index.
+static void bench_time_scan(int n, int queries) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    SecondaryIndex  ix;
+    index_init(&ix, INDEX_TYPE_TIME | INDEX_TIME);
+    index_attach(&ix, &ec);
+
+    bench_load(&rc, &ec, n, n);
+
+    int *windows = malloc(queries * sizeof *windows);
+    for (int q = 0; q < queries; ++q) {
+        windows[q] = rand() % n;
+    }
+
+    long counts[3] = { 0, 0, 0 };
+    long long sums[3] = { 0, 0, 0 };
+    double times[3];
+    for (int plan = 0; plan < 3; ++plan) {
+        // Plan 0 turns the indexes off for the fallback scan; the time index
+        // serves a type filter only when there is no type index
+        int usable = ix.usable;
+        if (plan == 0) ix.usable = 0;
+        if (plan == 1) ix.usable &= ~INDEX_TYPE_TIME;
+        double start = now_sec();
+        for (int q = 0; q < queries; ++q) {
+            sums[plan] += scan_window(&ec, TYPE_DB, windows[q], windows[q] + n / 100, &counts[plan]);
+        }
+        times[plan] = now_sec() - start;
+        ix.usable = usable;
+    }
+
+    printf("%-8d | %-14.1f | %-14.1f | %-14.1f\n", n, times[0] * 1e6 / queries, times[1] * 1e6 / queries,
+           times[2] * 1e6 / queries);
+    if (counts[1] != counts[0] || counts[2] != counts[0] || sums[1] != sums[0] || sums[2] != sums[0]) {
+        printf("index scans differ from the full scan\n");
+    }
+
+    free(windows);
+    entries_free(&ec);
+    index_free(&ix);
+    rooms_free(&rc);
+}
+
+// "Which rooms saw forward motion in a window, and how often per zone":
+// scanning every entry vs the motion store's bitsets (counts, then any).
+static void bench_motion(int n, int queries) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    MotionStore     ms = { 0 };
+    motion_attach(&ms, &ec);
+
+    bench_load(&rc, &ec, n, n);
+
+    int *windows = malloc(2 * queries * sizeof *windows);
+    for (int q = 0; q < queries; ++q) {
+        windows[2 * q] = rand() % n;
+        windows[2 * q + 1] = windows[2 * q] + n / 10;
+    }
+
+    long scan_count = 0, bits_count = 0, scan_rooms = 0, any_rooms = 0;
+    double start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        int seen[BENCH_ROOMS] = { 0 };
+        BTreeIter it;
+        btree_first(&ec.order, &it);
+        for (const LogEntry *e = entries_next(&ec, &it); e; e = entries_next(&ec, &it)) {
+            if (entry_type(e) == TYPE_MOTION && e->value.motion[1] &&
+                e->timestamp >= windows[2 * q] && e->timestamp <= windows[2 * q + 1]) {
+                scan_count++;
+                seen[entry_room(e)->id] = 1;
+            }
+        }
+        for (int r = 0; r < BENCH_ROOMS; ++r) {
+            scan_rooms += seen[r];
+        }
+    }
+    double scan = now_sec() - start;
+
+    MotionCounts mc;
+    start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        for (int r = 0; r < BENCH_ROOMS; ++r) {
+            motion_window(&ms, rc.rooms[r], windows[2 * q], windows[2 * q + 1], &mc);
+            bits_count += mc.zones[1];
+        }
+    }
+    double count = now_sec() - start;
+
+    start = now_sec();
+    for (int q = 0; q < queries; ++q) {
+        for (int r = 0; r < BENCH_ROOMS; ++r) {
+            any_rooms += motion_any(&ms, rc.rooms[r], MOTION_FORWARD, windows[2 * q], windows[2 * q + 1]);
+        }
+    }
+    double any = now_sec() - start;
+
+    printf("%-8d | %-14.1f | %-14.1f | %-14.1f\n", n, scan * 1e6 / queries, count * 1e6 / queries, any * 1e6 / queries);
+    if (bits_count != scan_count || any_rooms != scan_rooms) {
+        printf("motion store answers differ from the scan\n");
+    }
+
+    free(windows);
+    entries_free(&ec);
+    motion_free(&ms);
+    rooms_free(&rc);
+}
+
+// Delete a store directory made by persist_open: its snapshot and log (and
+// the temp files an interrupted write_atomic leaves), then the directory.
+static void bench_remove_store(const char *dir) {
+    static const char *FILES[] = { "snapshot.bin", "snapshot.bin.tmp", "log.bin", "log.bin.tmp" };
+    char path[PERSIST_PATH_MAX + 32];
+    for (size_t i = 0; i < sizeof FILES / sizeof *FILES; ++i) {
+        snprintf(path, sizeof path, "%s/%s", dir, FILES[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+// Time persist_open on a store holding `n` entries, `tail` of them in the log
+// after the last snapshot. The store lives in `dir`, which is overwritten.
+static void bench_restart(const char *dir, int n, int tail) {
+    bench_remove_store(dir);
+
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    PersistStore    ps;
+    char name[MAX_STR];
+    persist_open(&ps, dir, &rc, &ec);
+    for (int r = 0; r < BENCH_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(&rc, name);
+        persist_log_room(&ps, name);
+    }
+    for (int i = 0; i < n; ++i) {
+        if (i == n - tail) {
+            persist_snapshot(&ps, &rc, &ec);
+        }
+        Room *room = rc.rooms[rand() % BENCH_ROOMS];
+        ReadingValue value = { .decibels = rand() % 120 };
+        int timestamp = rand();
+        entries_create(&ec, room, TYPE_DB, value, timestamp);
+        persist_log_entry(&ps, room, TYPE_DB, value, timestamp);
+    }
+    persist_close(&ps);
+    entries_free(&ec);
+    rooms_free(&rc);
+
+    double start = now_sec();
+    persist_open(&ps, dir, &rc, &ec);
+    double elapsed = now_sec() - start;
+    printf("%-8d | %-14d | %-14.1f | %d\n", n, tail, elapsed * 1e3, ec.size);
+
+    persist_close(&ps);
+    entries_free(&ec);
+    rooms_free(&rc);
+    bench_remove_store(dir);
+}
+
+// rooms_find over `num_rooms` rooms, against the original strcmp scan.
+static void bench_find(int num_rooms, int lookups) {
+    RoomCollection rc = { .size = 0 };
+    char (*names)[MAX_STR] = malloc(num_rooms * sizeof *names);
+    for (int r = 0; r < num_rooms; ++r) {
+        snprintf(names[r], MAX_STR, "Room %05d", r);
+        rooms_add(&rc, names[r]);
+    }
+
+    long found = 0;
+    double start = now_sec();
+    for (int i = 0; i < lookups; ++i) {
+        const char *name = names[rand() % num_rooms];
+        for (int r = 0; r < num_rooms; ++r) {
+            if (strcmp(names[r], name) == 0) {
+                found++;
+                break;
+            }
+        }
+    }
+    double scan = now_sec() - start;
+
+    start = now_sec();
+    for (int i = 0; i < lookups; ++i) {
+        found += rooms_find(&rc, names[rand() % num_rooms]) != NULL;
+    }
+    double hashed = now_sec() - start;
+
+    printf("%-8d | %-14.1f | %-14.1f\n", num_rooms, scan * 1e9 / lookups, hashed * 1e9 / lookups);
+    if (found != 2L * lookups) {
+        printf("rooms_find missed %ld lookups\n", 2L * lookups - found);
+    }
+    rooms_free(&rc);
+    free(names);
+}
+
+int main(void) {
+    const int sizes[] = { 1000, 2000, 4000, 8000, 128000, 1000000 };
+    const int num_sizes = sizeof sizes / sizeof sizes[0];
+
+    srand(2401);
+    printf("%-8s | %-14s | %-14s | %-14s\n", "n", "legacy ns/op", "create ns/op", "bulk ns/op");
+    printf("---------|----------------|----------------|---------------\n");
+    for (int s = 0; s < num_sizes; ++s) {
+        int n = sizes[s];
+        int *rooms = malloc(n * sizeof *rooms);
+        int *stamps = malloc(n * sizeof *stamps);
+        for (int i = 0; i < n; ++i) {
+            rooms[i] = rand() % BENCH_ROOMS;
+            stamps[i] = rand();
+        }
+
+        // The legacy insert is cubic and the one-at-a-time insert quadratic;
+        // only run them where they finish quickly
+        char legacy[32] = "-", create[32] = "-";
+        if (n <= 8000) {
+            snprintf(legacy, sizeof legacy, "%.1f", bench_legacy(n, rooms, stamps) * 1e9 / n);
+        }
+        if (n <= 128000) {
+            snprintf(create, sizeof create, "%.1f", bench_create(n, rooms, stamps) * 1e9 / n);
+        }
+        double bulk = bench_bulk(n, rooms, stamps) * 1e9 / n;
+        printf("%-8d | %-14s | %-14s | %-14.1f\n", n, legacy, create, bulk);
+
+        free(rooms);
+        free(stamps);
+    }
+
+    // Keys as entries_create makes them: 16 rooms x 3 types, timestamps either
+    // uniformly random or increasing with 1% of readings arriving late
+    printf("\n%-8s | %-14s | %-14s | %-14s\n", "n", "timestamps", "array ns/op", "btree ns/op");
+    printf("---------|----------------|----------------|---------------\n");
+    for (int n = 100000; n <= 1000000; n *= 10) {
+        uint64_t *keys = malloc(n * sizeof *keys);
+        for (int order = 0; order < 2; ++order) {
+            for (int i = 0; i < n; ++i) {
+                int stamp = order == 0 ? rand() : (rand() % 100 == 0 ? i - rand() % 1000 : i);
+                keys[i] = ((uint64_t)(1 + rand() % BENCH_ROOMS) << 34) |
+                          ((uint64_t)(TYPE_TEMP + rand() % 3) << 32) | ((uint32_t)stamp ^ 0x80000000u);
+            }
+            bench_index(order == 0 ? "random" : "mostly sorted", keys, n);
+        }
+        free(keys);
+    }
+
+    printf("\n%-14s | %-7s | %-7s | %-7s | %-7s | %-7s | %s\n", "bytes/entry", "entry", "slab", "order", "rooms", "columns", "total");
+    printf("---------------|---------|---------|---------|---------|---------|------\n");
+    bench_memory(128000, 0);
+    bench_memory(1000000, 1);
+
+    printf("\n%-8s | %-14s | %-14s | %-14s\n", "n", "rows ns/entry", "cols ns/entry", "all ns/entry");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_aggregate(1000000);
+
+    printf("\n%-8s | %-14s | %-14s | %-14s\n", "n", "scan us/query", "range us/query", "prefix us/query");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_query(100000, 200);
+    bench_query(1000000, 50);
+
+    printf("\n%-8s | %-14s | %-14s | %s\n", "n", "range us/query", "rollup us/query", "rollup bytes/entry");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_rollup(100000, 2000);
+    bench_rollup(1000000, 2000);
+
+    printf("\n%-8s | %-14s | %-14s | %-14s\n", "n", "scan us/query", "count us/query", "any us/query");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_motion(100000, 200);
+    bench_motion(1000000, 50);
+
+    printf("\n%-8s | %-14s | %-14s | %-14s\n", "n", "full us/query", "time us/query", "type us/query");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_time_scan(100000, 200);
+    bench_time_scan(1000000, 50);
+
+    printf("\n%-8s | %-14s | %-14s | %s\n", "n", "log tail", "open ms", "entries");
+    printf("---------|----------------|----------------|---------------\n");
+    bench_restart("/tmp/a2_bench_store", 100000, 100000);
+    bench_restart("/tmp/a2_bench_store", 100000, 1000);
+    bench_restart("/tmp/a2_bench_store", 100000, 0);
+
+    printf("\n%-8s | %-14s | %-14s\n", "rooms", "scan ns/find", "hash ns/find");
+    printf("---------|----------------|---------------\n");
+    for (int num_rooms = 16; num_rooms <= 16384; num_rooms *= 8) {
+        bench_find(num_rooms, 200000);
+    }
+    return 0;
+}
@@ -0,0 +1,395 @@
+// btree.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* B+-tree from packed entry keys to slab handles. Every node is one block of
+   BTREE_FANOUT keys, aligned to a cache line, so a lookup touches a handful
+   of lines per level instead of one per compare. Only leaves hold handles;
+   they are linked left to right, so an in-order walk never goes back up the
+   tree. Equal keys are allowed: inserts go before any equal key (lower
+   bound), which is where entries_create has always put them. */
+
+#define CACHE_LINE        64
+#define BTREE_MAX_HEIGHT  16   /* far more than 2^31 entries need */
+
+struct BTreeNode {
+    uint64_t keys[BTREE_FANOUT];  /* leaf: entry keys; internal: keys[i] = smallest key under children[i + 1] */
+    int      count;               /* leaf: number of keys; internal: number of children */
+    int      leaf;
+    union {
+        struct {
+            EntryHandle handles[BTREE_FANOUT];
+            BTreeNode  *next;     /* next leaf in key order, NULL for the last */
+        } l;
+        BTreeNode *children[BTREE_FANOUT];
+    } u;
+};
+
+static BTreeNode* btree_node_new(int leaf) {
+    size_t size = (sizeof(BTreeNode) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    BTreeNode *node = aligned_alloc(CACHE_LINE, size);
+    if (node) {
+        node->count = 0;
+        node->leaf = leaf;
+        node->u.l.next = NULL;
+    }
+    return node;
+}
+
+// First index in keys[0..n-1] whose key is not less than `key`.
+static int btree_lower_bound(const uint64_t *keys, int n, uint64_t key) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Nodes allocated up front for one insert, so running out of memory partway
+// through a chain of splits cannot leave the tree half updated.
+typedef struct {
+    BTreeNode *nodes[BTREE_MAX_HEIGHT + 1];
+    int        count;
+} BTreeSpare;
+
+static BTreeNode* btree_spare_take(BTreeSpare *spare, int leaf) {
+    BTreeNode *node = spare->nodes[--spare->count];
+    node->count = 0;
+    node->leaf = leaf;
+    node->u.l.next = NULL;
+    return node;
+}
+
+// Insert a pair at `pos` of a leaf. If the leaf is full, its upper half moves
+// to a new right sibling, returned in *split with its smallest key.
+static void btree_leaf_insert(BTreeNode *leaf, int pos, uint64_t key, EntryHandle handle,
+                              BTreeSpare *spare, BTreeNode **split, uint64_t *split_key) {
+    *split = NULL;
+    if (leaf->count == BTREE_FANOUT) {
+        BTreeNode *right = btree_spare_take(spare, 1);
+        int half = BTREE_FANOUT / 2;
+        right->count = BTREE_FANOUT - half;
+        memcpy(right->keys, &leaf->keys[half], right->count * sizeof *leaf->keys);
+        memcpy(right->u.l.handles, &leaf->u.l.handles[half], right->count * sizeof *leaf->u.l.handles);
+        leaf->count = half;
+        right->u.l.next = leaf->u.l.next;
+        leaf->u.l.next = right;
+        if (pos > half) {
+            leaf = right;
+            pos -= half;
+        }
+        *split = right;
+    }
+
+    memmove(&leaf->keys[pos + 1], &leaf->keys[pos], (leaf->count - pos) * sizeof *leaf->keys);
+    memmove(&leaf->u.l.handles[pos + 1], &leaf->u.l.handles[pos], (leaf->count - pos) * sizeof *leaf->u.l.handles);
+    leaf->keys[pos] = key;
+    leaf->u.l.handles[pos] = handle;
+    leaf->count++;
+    if (*split) {
+        *split_key = (*split)->keys[0];
+    }
+}
+
+// Add `child` (smallest key `child_key`) right after children[idx] of an
+// internal node, splitting the node like btree_leaf_insert if it is full.
+static void btree_internal_insert(BTreeNode *node, int idx, uint64_t child_key, BTreeNode *child,
+                                  BTreeSpare *spare, BTreeNode **split, uint64_t *split_key) {
+    *split = NULL;
+    if (node->count < BTREE_FANOUT) {
+        memmove(&node->keys[idx + 1], &node->keys[idx], (node->count - 1 - idx) * sizeof *node->keys);
+        memmove(&node->u.children[idx + 2], &node->u.children[idx + 1], (node->count - 1 - idx) * sizeof *node->u.children);
+        node->keys[idx] = child_key;
+        node->u.children[idx + 1] = child;
+        node->count++;
+        return;
+    }
+
+    uint64_t keys[BTREE_FANOUT];
+    BTreeNode *children[BTREE_FANOUT + 1];
+    memcpy(keys, node->keys, idx * sizeof *keys);
+    keys[idx] = child_key;
+    memcpy(&keys[idx + 1], &node->keys[idx], (BTREE_FANOUT - 1 - idx) * sizeof *keys);
+    memcpy(children, node->u.children, (idx + 1) * sizeof *children);
+    children[idx + 1] = child;
+    memcpy(&children[idx + 2], &node->u.children[idx + 1], (BTREE_FANOUT - 1 - idx) * sizeof *children);
+
+    // Left keeps `half` children; the key between the halves moves up
+    BTreeNode *right = btree_spare_take(spare, 0);
+    int half = (BTREE_FANOUT + 1) / 2;
+    node->count = half;
+    memcpy(node->keys, keys, (half - 1) * sizeof *keys);
+    memcpy(node->u.children, children, half * sizeof *children);
+    right->count = BTREE_FANOUT + 1 - half;
+    memcpy(right->keys, &keys[half], (right->count - 1) * sizeof *keys);
+    memcpy(right->u.children, &children[half], right->count * sizeof *children);
+    *split = right;
+    *split_key = keys[half - 1];
+}
+
+/* ---- btree_insert ----------------------------------------------------------
+   Purpose: Add a key/handle pair, before any pairs with an equal key.
+   Params:
+     - t (in/out): tree
+     - key (in): packed entry key
+     - handle (in): slab handle of the entry
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY (the tree is unchanged)
+----------------------------------------------------------------------------- */
+int btree_insert(BTree *t, uint64_t key, EntryHandle handle) {
+    if (!t) return C_ERR_NULL_PTR;
+    if (!t->root) {
+        t->root = btree_node_new(1);
+        if (!t->root) return C_ERR_NO_MEMORY;
+        t->height = 1;
+    }
+
+    // 1. Walk down, remembering the path and which child was taken
+    BTreeNode *path[BTREE_MAX_HEIGHT];
+    int slot[BTREE_MAX_HEIGHT];
+    BTreeNode *node = t->root;
+    for (int d = 0; d < t->height - 1; ++d) {
+        path[d] = node;
+        slot[d] = btree_lower_bound(node->keys, node->count - 1, key);
+        node = node->u.children[slot[d]];
+    }
+    path[t->height - 1] = node;
+
+    // 2. Every full node at the bottom of the path will split (and the root
+    //    gains a parent if they all are); allocate those nodes first
+    BTreeSpare spare = { .count = 0 };
+    int full = 0;
+    while (full < t->height && path[t->height - 1 - full]->count == BTREE_FANOUT) {
+        full++;
+    }
+    int needed = full + (full == t->height);
+    if (full == t->height && t->height == BTREE_MAX_HEIGHT) return C_ERR_NO_MEMORY;
+    while (spare.count < needed) {
+        BTreeNode *spare_node = btree_node_new(0);
+        if (!spare_node) {
+            while (spare.count > 0) free(spare.nodes[--spare.count]);
+            return C_ERR_NO_MEMORY;
+        }
+        spare.nodes[spare.count++] = spare_node;
+    }
+
+    // 3. Insert into the leaf and carry splits up the path
+    BTreeNode *split;
+    uint64_t split_key;
+    btree_leaf_insert(node, btree_lower_bound(node->keys, node->count, key), key, handle,
+                      &spare, &split, &split_key);
+    for (int d = t->height - 2; d >= 0 && split; --d) {
+        btree_internal_insert(path[d], slot[d], split_key, split, &spare, &split, &split_key);
+    }
+    if (split) {
+        BTreeNode *root = btree_spare_take(&spare, 0);
+        root->count = 2;
+        root->keys[0] = split_key;
+        root->u.children[0] = t->root;
+        root->u.children[1] = split;
+        t->root = root;
+        t->height++;
+    }
+    t->size++;
+    return C_ERR_OK;
+}
+
+static void btree_free_node(BTreeNode *node) {
+    if (!node->leaf) {
+        for (int i = 0; i < node->count; ++i) {
+            btree_free_node(node->u.children[i]);
+        }
+    }
+    free(node);
+}
+
+/* ---- btree_free ------------------------------------------------------------
+   Purpose: Release every node and reset the tree to empty.
+   Params:
+     - t (in/out): tree
+----------------------------------------------------------------------------- */
+void btree_free(BTree *t) {
+    if (!t) return;
+    if (t->root) {
+        btree_free_node(t->root);
+    }
+    memset(t, 0, sizeof *t);
+}
+
+static size_t btree_node_bytes(const BTreeNode *node) {
+    size_t bytes = sizeof *node;
+    if (!node->leaf) {
+        for (int i = 0; i < node->count; ++i) {
+            bytes += btree_node_bytes(node->u.children[i]);
+        }
+    }
+    return bytes;
+}
+
+/* ---- btree_bytes -----------------------------------------------------------
+   Purpose: Memory held by the tree's nodes.
+   Params:
+     - t (in): tree
+   Returns: bytes allocated for nodes
+----------------------------------------------------------------------------- */
+size_t btree_bytes(const BTree *t) {
+    return t && t->root ? btree_node_bytes(t->root) : 0;
+}
+
+/* ---- btree_build -----------------------------------------------------------
+   Purpose: Build a tree bottom-up from pairs already in key order, with every
+            node full except possibly the last on each level. O(n).
+   Params:
+     - t (out): tree to build (must be empty)
+     - items (in): pairs sorted by key
+     - n (in): number of pairs
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY (t is left empty)
+----------------------------------------------------------------------------- */
+int btree_build(BTree *t, const KeyedHandle *items, int n) {
+    if (!t || (!items && n > 0)) return C_ERR_NULL_PTR;
+    memset(t, 0, sizeof *t);
+    if (n == 0) return C_ERR_OK;
+
+    // Leaves, linked as they are made. `level` holds the current level's nodes
+    // and the smallest key under each, which becomes its parent's separator.
+    int count = (n + BTREE_FANOUT - 1) / BTREE_FANOUT;
+    BTreeNode **level = malloc(count * sizeof *level);
+    uint64_t *mins = malloc(count * sizeof *mins);
+    if (!level || !mins) {
+        free(level);
+        free(mins);
+        return C_ERR_NO_MEMORY;
+    }
+
+    BTreeNode *prev = NULL;
+    for (int i = 0; i < count; ++i) {
+        BTreeNode *leaf = btree_node_new(1);
+        if (!leaf) {
+            for (int j = 0; j < i; ++j) free(level[j]);
+            free(level);
+            free(mins);
+            return C_ERR_NO_MEMORY;
+        }
+        int first = i * BTREE_FANOUT;
+        leaf->count = n - first < BTREE_FANOUT ? n - first : BTREE_FANOUT;
+        for (int k = 0; k < leaf->count; ++k) {
+            leaf->keys[k] = items[first + k].key;
+            leaf->u.l.handles[k] = items[first + k].handle;
+        }
+        if (prev) prev->u.l.next = leaf;
+        prev = leaf;
+        level[i] = leaf;
+        mins[i] = leaf->keys[0];
+    }
+    int height = 1;
+
+    // Internal levels, each packing up to BTREE_FANOUT nodes of the one below
+    while (count > 1) {
+        int parents = (count + BTREE_FANOUT - 1) / BTREE_FANOUT;
+        for (int p = 0; p < parents; ++p) {
+            BTreeNode *node = btree_node_new(0);
+            if (!node) {
+                // Free the finished parents, then the lower levels through them
+                for (int j = 0; j < p; ++j) btree_free_node(level[j]);
+                for (int j = p * BTREE_FANOUT; j < count; ++j) btree_free_node(level[j]);
+                free(level);
+                free(mins);
+                return C_ERR_NO_MEMORY;
+            }
+            int first = p * BTREE_FANOUT;
+            node->count = count - first < BTREE_FANOUT ? count - first : BTREE_FANOUT;
+            for (int k = 0; k < node->count; ++k) {
+                node->u.children[k] = level[first + k];
+                if (k > 0) node->keys[k - 1] = mins[first + k];
+            }
+            uint64_t min = mins[first];
+            level[p] = node; // first..first+count-1 are never read again
+            mins[p] = min;
+        }
+        count = parents;
+        height++;
+    }
+
+    t->root = level[0];
+    t->height = height;
+    t->size = n;
+    free(level);
+    free(mins);
+    return C_ERR_OK;
+}
+
+// Recompute every key from the entry it points at, and the separators.
+// Returns the smallest key in the subtree.
+static uint64_t btree_rekey_node(BTreeNode *node, const EntryCollection *ec) {
+    if (node->leaf) {
+        for (int i = 0; i < node->count; ++i) {
+            node->keys[i] = entry_sort_key(entries_get(ec, node->u.l.handles[i]));
+        }
+        return node->keys[0];
+    }
+    uint64_t min = btree_rekey_node(node->u.children[0], ec);
+    for (int i = 1; i < node->count; ++i) {
+        node->keys[i - 1] = btree_rekey_node(node->u.children[i], ec);
+    }
+    return min;
+}
+
+/* ---- btree_rekey -----------------------------------------------------------
+   Purpose: Refresh the tree's keys after the rooms were re-ranked. The new
+            keys must order the entries the same way as the old ones (true
+            for a re-rank).
+   Params:
+     - t (in/out): tree
+     - ec (in): entry collection the handles belong to
+----------------------------------------------------------------------------- */
+void btree_rekey(BTree *t, const EntryCollection *ec) {
+    if (!t || !ec || !t->root) return;
+    btree_rekey_node(t->root, ec);
+}
+
+/* ---- btree_first / btree_seek / btree_next ---------------------------------
+   Purpose: Walk the pairs in key order, starting from the first pair or from
+            the first pair whose key is not less than `key`.
+   Params:
+     - t (in): tree
+     - key (in): lower bound to seek to
+     - it (out/in/out): iterator
+     - out (out): next pair
+   Returns: btree_next: 1 if a pair was stored in *out, 0 at the end
+----------------------------------------------------------------------------- */
+void btree_first(const BTree *t, BTreeIter *it) {
+    const BTreeNode *node = t ? t->root : NULL;
+    while (node && !node->leaf) {
+        node = node->u.children[0];
+    }
+    it->leaf = node;
+    it->pos = 0;
+}
+
+void btree_seek(const BTree *t, uint64_t key, BTreeIter *it) {
+    const BTreeNode *node = t ? t->root : NULL;
+    while (node && !node->leaf) {
+        node = node->u.children[btree_lower_bound(node->keys, node->count - 1, key)];
+    }
+    it->leaf = node;
+    it->pos = node ? btree_lower_bound(node->keys, node->count, key) : 0;
+}
+
+int btree_next(BTreeIter *it, KeyedHandle *out) {
+    while (it->leaf && it->pos >= it->leaf->count) {
+        it->leaf = it->leaf->u.l.next;
+        it->pos = 0;
+    }
+    if (!it->leaf) {
+        return 0;
+    }
+    out->key = it->leaf->keys[it->pos];
+    out->handle = it->leaf->u.l.handles[it->pos];
+    it->pos++;
+    return 1;
+}
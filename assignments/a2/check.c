@@ -0,0 +1,406 @@
+// check.c
+
+#include "defs.h"
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+/* Consistency checks in O(n), for running on live collections rather than
+   only on the loader's 16-entry copies. Each entry is identified by its slab
+   handle, found from its address by arithmetic on the chunk address ranges,
+   and a bitmap of visited handles shows an entry seen twice in O(1).
+   Sortedness is one entry_cmp per neighbouring pair.
+
+   A full run checks
+     - the room table: ids, list sizes, by_name in strictly increasing name
+       (and rank) order;
+     - CHECK_ORDER: the order tree holds every handle exactly once, its keys
+       are sorted and (while current) equal to entry_sort_key, every entry
+       points at a room of the collection, and entries are in entry_cmp order;
+     - CHECK_ROOMS: every room list slot is an entry of the slab that names
+       that room, lists are sorted, and each entry is in exactly one list.
+   An incremental run relies on the previous run and checks only entries
+   created since (each in the order tree under its key, and in its room's
+   list between its neighbours) and room lists rewritten since
+   (Room.dirty_from, set by bulk inserts), plus the room table and the
+   totals. A single insert only shifts the rest of its room's list, which
+   keeps that part in order, so the slots around the new entry are enough.
+   Both runs reset the rooms' dirty marks, so the caller needs the
+   collections to itself, as for any other update.
+
+   check_snapshot checks a pinned snapshot instead, without touching the
+   collections the merger is writing: entry_cmp order, valid rooms and
+   types. Its entries are slab entries, which only entries_free changes. */
+
+// A slab chunk's address, for mapping entry pointers back to handles
+typedef struct {
+    uintptr_t base;
+    int       chunk;
+} ChunkRange;
+
+typedef struct {
+    CheckState            *st;
+    const EntryCollection *ec;
+    const RoomCollection  *rc;
+    ChunkRange            *ranges;     /* by base address */
+    uint64_t              *seen;       /* visited bitmap, one bit per handle */
+    int                    marked;     /* bits set in it */
+} Checker;
+
+static void check_fail(Checker *c, const char *fmt, ...) {
+    if (c->st->errors++ == 0) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(c->st->first_error, CHECK_MSG_MAX, fmt, ap);
+        va_end(ap);
+    }
+}
+
+static int range_cmp(const void *a, const void *b) {
+    uintptr_t x = ((const ChunkRange *)a)->base, y = ((const ChunkRange *)b)->base;
+    return (x > y) - (x < y);
+}
+
+// Sorted chunk ranges and an empty bitmap of `bits` handles
+static int checker_init(Checker *c, CheckState *st, const EntryCollection *ec, const RoomCollection *rc, int bits) {
+    memset(c, 0, sizeof *c);
+    c->st = st;
+    c->ec = ec;
+    c->rc = rc;
+    c->ranges = malloc((ec->num_chunks ? ec->num_chunks : 1) * sizeof *c->ranges);
+    c->seen = calloc((size_t)bits / 64 + 1, sizeof *c->seen);
+    if (!c->ranges || !c->seen) {
+        free(c->ranges);
+        free(c->seen);
+        return C_ERR_NO_MEMORY;
+    }
+    for (int i = 0; i < ec->num_chunks; ++i) {
+        c->ranges[i] = (ChunkRange){ (uintptr_t)ec->chunks[i], i };
+    }
+    qsort(c->ranges, ec->num_chunks, sizeof *c->ranges, range_cmp);
+
+    st->checked = 0;
+    st->errors = 0;
+    st->first_error[0] = '\0';
+    return C_ERR_OK;
+}
+
+static void checker_free(Checker *c) {
+    free(c->ranges);
+    free(c->seen);
+}
+
+// Set bit i of the visited bitmap; returns whether it was set already
+static int check_visit(Checker *c, int i) {
+    uint64_t mask = (uint64_t)1 << (i % 64);
+    if (c->seen[i / 64] & mask) return 1;
+    c->seen[i / 64] |= mask;
+    c->marked++;
+    return 0;
+}
+
+// The handle of the entry at p: the last chunk starting at or below p, then
+// the offset into it. -1 if p is not an entry slot in use.
+static EntryHandle check_handle(const Checker *c, const LogEntry *p) {
+    uintptr_t addr = (uintptr_t)p;
+    int lo = 0, hi = c->ec->num_chunks;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (c->ranges[mid].base <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return -1;
+    uintptr_t offset = addr - c->ranges[lo - 1].base;
+    if (offset >= SLAB_CHUNK * sizeof(LogEntry) || offset % sizeof(LogEntry) != 0) return -1;
+    EntryHandle h = c->ranges[lo - 1].chunk * SLAB_CHUNK + (int)(offset / sizeof(LogEntry));
+    return h < c->ec->size ? h : -1;
+}
+
+// The entry's room is one of the collection's, and its type is valid
+static int check_entry(Checker *c, EntryHandle h, const LogEntry *e) {
+    const Room *room = entry_room(e);
+    if (!room || room->id < 0 || room->id >= c->rc->size || c->rc->rooms[room->id] != room) {
+        check_fail(c, "entry %d does not point at a room of the collection", h);
+        return 0;
+    }
+    if (entry_type(e) < TYPE_TEMP || entry_type(e) > TYPE_MOTION) {
+        check_fail(c, "entry %d has invalid type %d", h, entry_type(e));
+        return 0;
+    }
+    return 1;
+}
+
+// Room table, by_name order and the totals, O(rooms)
+static void check_room_table(Checker *c) {
+    const RoomCollection *rc = c->rc;
+    long total = 0;
+    for (int i = 0; i < rc->size; ++i) {
+        const Room *r = rc->rooms[i];
+        if (!r || r->id != i) {
+            check_fail(c, "room slot %d does not hold room %d", i, i);
+            return;
+        }
+        if (r->size < 0 || r->size > r->capacity || (r->size > 0 && !r->entries)) {
+            check_fail(c, "room '%s' has size %d, capacity %d", r->name, r->size, r->capacity);
+            return;
+        }
+        total += r->size;
+    }
+    for (int i = 1; i < rc->size; ++i) {
+        const Room *a = rc->rooms[rc->by_name[i - 1]], *b = rc->rooms[rc->by_name[i]];
+        if (strcmp(a->name, b->name) >= 0 || (a->rank && b->rank && a->rank >= b->rank)) {
+            check_fail(c, "rooms '%s' and '%s' are out of name order", a->name, b->name);
+        }
+    }
+    if (total != c->ec->size) {
+        check_fail(c, "room lists hold %ld entries, the collection %d", total, c->ec->size);
+    }
+    if (c->ec->order.size != c->ec->size) {
+        check_fail(c, "order tree holds %d entries, the collection %d", c->ec->order.size, c->ec->size);
+    }
+}
+
+static void check_order(Checker *c) {
+    const EntryCollection *ec = c->ec;
+    int keys_current = ec->key_epoch == c->rc->rank_epoch;
+    BTreeIter it;
+    KeyedHandle kh;
+    const LogEntry *prev = NULL;
+    uint64_t prev_key = 0;
+    int pos = 0;
+    btree_first(&ec->order, &it);
+    for (; btree_next(&it, &kh); ++pos) {
+        c->st->checked++;
+        if (kh.handle < 0 || kh.handle >= ec->size) {
+            check_fail(c, "order tree position %d has handle %d", pos, kh.handle);
+            continue;
+        }
+        if (check_visit(c, kh.handle)) {
+            check_fail(c, "entry %d is in the order tree twice", kh.handle);
+            continue;
+        }
+        const LogEntry *e = entries_get(ec, kh.handle);
+        if (!check_entry(c, kh.handle, e)) continue;
+        if (pos > 0 && kh.key < prev_key) {
+            check_fail(c, "order tree keys decrease at position %d", pos);
+        }
+        if (keys_current && kh.key != entry_sort_key(e)) {
+            check_fail(c, "entry %d is filed under a stale key", kh.handle);
+        }
+        if (prev && entry_cmp(prev, e) > 0) {
+            check_fail(c, "entries out of order at position %d", pos);
+        }
+        prev = e;
+        prev_key = kh.key;
+    }
+    if (pos != ec->size) {
+        check_fail(c, "order tree walk found %d entries, the collection has %d", pos, ec->size);
+    }
+}
+
+// Room list slots [from, r->size). Handles at or above `first_new` are
+// marked in the bitmap (at bit handle - first_new); older ones are only
+// checked for place and order.
+static void check_room_list(Checker *c, const Room *r, int from, int first_new) {
+    const LogEntry *prev = from > 0 ? r->entries[from - 1] : NULL;
+    for (int j = from; j < r->size; ++j) {
+        const LogEntry *e = r->entries[j];
+        c->st->checked++;
+        EntryHandle h = check_handle(c, e);
+        if (h < 0) {
+            check_fail(c, "room '%s' slot %d is not an entry of the collection", r->name, j);
+            prev = NULL;
+            continue;
+        }
+        if (entry_room(e) != r) {
+            check_fail(c, "entry %d is listed in room '%s' but belongs elsewhere", h, r->name);
+        } else if (h >= first_new && check_visit(c, h - first_new)) {
+            check_fail(c, "entry %d is listed twice", h);
+        }
+        if (prev && entry_cmp(prev, e) > 0) {
+            check_fail(c, "room '%s' is out of order at slot %d", r->name, j);
+        }
+        prev = e;
+    }
+}
+
+// A new entry outside any rewritten range: binary search its room's list
+// for it and check the neighbours, O(log n)
+static void check_in_room(Checker *c, EntryHandle h, const LogEntry *e) {
+    const Room *r = entry_room(e);
+    int lo = 0, hi = r->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (entry_cmp(r->entries[mid], e) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    while (lo < r->size && r->entries[lo] != e && entry_cmp(r->entries[lo], e) == 0) {
+        lo++;
+    }
+    if (lo == r->size || r->entries[lo] != e) {
+        check_fail(c, "entry %d is not in room '%s'", h, r->name);
+        return;
+    }
+    c->st->checked++;
+    check_visit(c, h - c->st->entries);
+    if ((lo > 0 && entry_cmp(r->entries[lo - 1], e) > 0) ||
+        (lo + 1 < r->size && entry_cmp(e, r->entries[lo + 1]) > 0)) {
+        check_fail(c, "room '%s' is out of order at slot %d", r->name, lo);
+    }
+}
+
+static void check_done(CheckState *st, const EntryCollection *ec, RoomCollection *rc) {
+    for (int i = 0; i < rc->size; ++i) {
+        rc->rooms[i]->dirty_from = INT_MAX;
+    }
+    st->has_run = 1;
+    st->entries = ec->size;
+    st->rank_epoch = rc->rank_epoch;
+    st->key_epoch = ec->key_epoch;
+}
+
+/* ---- check_full ------------------------------------------------------------
+   Purpose: Check the collections from scratch (see the top of check.c), in
+            O(n) plus a sort of the slab's chunk addresses.
+   Params:
+     - st (in/out): check state; st->errors, st->first_error and st->checked
+                    describe the run, and later incremental runs start here
+     - ec (in): entry collection
+     - rc (in/out): its rooms (dirty marks are reset)
+     - parts (in): CHECK_ORDER and/or CHECK_ROOMS
+   Returns: C_ERR_OK if consistent, C_ERR_INVALID if problems were found,
+            C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int check_full(CheckState *st, const EntryCollection *ec, RoomCollection *rc, int parts) {
+    if (!st || !ec || !rc) return C_ERR_NULL_PTR;
+    Checker c;
+    if (checker_init(&c, st, ec, rc, ec->size) != C_ERR_OK) return C_ERR_NO_MEMORY;
+
+    check_room_table(&c);
+    if (parts & CHECK_ORDER) {
+        check_order(&c);
+    }
+    if (parts & CHECK_ROOMS) {
+        memset(c.seen, 0, ((size_t)ec->size / 64 + 1) * sizeof *c.seen);
+        c.marked = 0;
+        for (int i = 0; i < rc->size; ++i) {
+            check_room_list(&c, rc->rooms[i], 0, 0);
+        }
+        // With the totals equal (room table check), no entry listed twice
+        // means every entry is listed exactly once
+    }
+    checker_free(&c);
+
+    // Only a run over both parts is a base for incremental runs
+    if (parts == (CHECK_ORDER | CHECK_ROOMS)) {
+        check_done(st, ec, rc);
+    }
+    return st->errors ? C_ERR_INVALID : C_ERR_OK;
+}
+
+/* ---- check_incremental -----------------------------------------------------
+   Purpose: Check what changed since the last run with this state: O(k log n)
+            for k new entries plus the rewritten room lists. Falls
+            back to check_full on the first run, after rooms were re-ranked,
+            or if the collection shrank.
+   Params:
+     - st (in/out): check state from earlier runs (or zero-initialised)
+     - ec (in): entry collection
+     - rc (in/out): its rooms (dirty marks are reset)
+   Returns: as check_full
+----------------------------------------------------------------------------- */
+int check_incremental(CheckState *st, const EntryCollection *ec, RoomCollection *rc) {
+    if (!st || !ec || !rc) return C_ERR_NULL_PTR;
+    if (!st->has_run || ec->size < st->entries || rc->rank_epoch != st->rank_epoch ||
+        ec->key_epoch != st->key_epoch || ec->key_epoch != rc->rank_epoch) {
+        return check_full(st, ec, rc, CHECK_ORDER | CHECK_ROOMS);
+    }
+
+    int first_new = st->entries;
+    int num_new = ec->size - first_new;
+    Checker c;
+    if (checker_init(&c, st, ec, rc, num_new) != C_ERR_OK) return C_ERR_NO_MEMORY;
+    check_room_table(&c);
+
+    // New entries: valid, and in the order tree under their key. Equal keys
+    // are next to each other, so the walk from the seek is short.
+    for (EntryHandle h = first_new; h < ec->size; ++h) {
+        const LogEntry *e = entries_get(ec, h);
+        c.st->checked++;
+        if (!check_entry(&c, h, e)) continue;
+        uint64_t key = entry_sort_key(e);
+        BTreeIter it;
+        KeyedHandle kh;
+        int found = 0;
+        btree_seek(&ec->order, key, &it);
+        while (!found && btree_next(&it, &kh) && kh.key == key) {
+            found = kh.handle == h;
+        }
+        if (!found) {
+            check_fail(&c, "entry %d is missing from the order tree", h);
+        }
+        if (entry_room(e)->dirty_from >= entry_room(e)->size) {
+            check_in_room(&c, h, e);
+        }
+    }
+
+    // Rewritten room lists, from the slot before the first change so the
+    // order check covers the seam
+    for (int i = 0; i < rc->size; ++i) {
+        const Room *r = rc->rooms[i];
+        if (r->dirty_from < r->size) {
+            check_room_list(&c, r, r->dirty_from, first_new);
+        }
+    }
+    if (c.marked != num_new) {
+        check_fail(&c, "%d new entries are not in their room's list", num_new - c.marked);
+    }
+    checker_free(&c);
+
+    check_done(st, ec, rc);
+    return st->errors ? C_ERR_INVALID : C_ERR_OK;
+}
+
+/* ---- check_snapshot --------------------------------------------------------
+   Purpose: Check a pinned snapshot (see ingest_snapshot) in O(n): every
+            entry points at a room of `rc` with a valid type, and entries
+            are in entry_cmp order. Safe while merges are running, since it
+            reads neither the order tree nor the room lists.
+   Params:
+     - st (in/out): check state; only st->errors, st->first_error and
+                    st->checked are set, incremental runs are unaffected
+     - snap (in): snapshot
+     - rc (in): the rooms (fixed while ingesting)
+   Returns: C_ERR_OK if consistent, C_ERR_INVALID if problems were found,
+            C_ERR_NULL_PTR
+----------------------------------------------------------------------------- */
+int check_snapshot(CheckState *st, const EntrySnapshot *snap, const RoomCollection *rc) {
+    if (!st || !snap || !rc) return C_ERR_NULL_PTR;
+    Checker c = { .st = st, .rc = rc };
+    st->checked = 0;
+    st->errors = 0;
+    st->first_error[0] = '\0';
+
+    const LogEntry *prev = NULL;
+    for (int i = 0; i < snap->size; ++i) {
+        const LogEntry *e = snap->entries[i];
+        st->checked++;
+        if (!e) {
+            check_fail(&c, "snapshot position %d is empty", i);
+        } else if (check_entry(&c, i, e)) {
+            if (prev && entry_cmp(prev, e) > 0) {
+                check_fail(&c, "snapshot out of order at position %d", i);
+            }
+            prev = e;
+            continue;
+        }
+        prev = NULL;
+    }
+    return st->errors ? C_ERR_INVALID : C_ERR_OK;
+}
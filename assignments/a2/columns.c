@@ -0,0 +1,273 @@
+// columns.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Column-oriented copy of the log: one set of parallel arrays per reading
+   type, in creation order. Scanning every temperature only touches the
+   temperature column, and the aggregation loops below run over contiguous
+   floats/ints that the compiler can keep in registers (and vectorize). */
+
+static size_t column_value_size(int type) {
+    return type == TYPE_MOTION ? sizeof(unsigned char) : sizeof(float);
+}
+
+/* ---- columns_reserve -------------------------------------------------------
+   Purpose: Make room for `extra` more readings of one type.
+   Params:
+     - cs (in/out): column store
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - extra (in): number of readings about to be appended
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int columns_reserve(ColumnStore *cs, int type, int extra) {
+    if (!cs) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    TypeColumn *col = &cs->columns[type - 1];
+    int needed = col->size + extra;
+    if (needed <= col->capacity) {
+        return C_ERR_OK;
+    }
+
+    int capacity = col->capacity ? col->capacity : SLAB_CHUNK;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    int *timestamps = realloc(col->timestamps, capacity * sizeof *timestamps);
+    if (!timestamps) return C_ERR_NO_MEMORY;
+    col->timestamps = timestamps;
+    int *room_ids = realloc(col->room_ids, capacity * sizeof *room_ids);
+    if (!room_ids) return C_ERR_NO_MEMORY;
+    col->room_ids = room_ids;
+    void *values = realloc(col->values.raw, capacity * column_value_size(type));
+    if (!values) return C_ERR_NO_MEMORY;
+    col->values.raw = values;
+    col->capacity = capacity;
+    return C_ERR_OK;
+}
+
+/* ---- columns_append --------------------------------------------------------
+   Purpose: Append one reading to the column for its type.
+   Params:
+     - cs (in/out): column store
+     - room_id (in): id of the owning room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - value (in): reading payload
+     - timestamp (in): reading timestamp
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int columns_append(ColumnStore *cs, int room_id, int type, ReadingValue value, int timestamp) {
+    int result = columns_reserve(cs, type, 1);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    TypeColumn *col = &cs->columns[type - 1];
+    int i = col->size++;
+    col->timestamps[i] = timestamp;
+    col->room_ids[i] = room_id;
+    switch (type) {
+        case TYPE_TEMP:
+            col->values.temperature[i] = value.temperature;
+            break;
+        case TYPE_DB:
+            col->values.decibels[i] = value.decibels;
+            break;
+        case TYPE_MOTION:
+            // One bit per zone instead of one byte per zone
+            col->values.motion[i] = (value.motion[0] ? MOTION_LEFT : 0) |
+                                    (value.motion[1] ? MOTION_FORWARD : 0) |
+                                    (value.motion[2] ? MOTION_RIGHT : 0);
+            break;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- columns_attach --------------------------------------------------------
+   Purpose: Fill a column store from the entries already in a collection and
+            attach it, so every later insert is appended to it as well.
+   Params:
+     - cs (in/out): column store (its previous contents are discarded)
+     - ec (in/out): entry collection to mirror
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int columns_attach(ColumnStore *cs, EntryCollection *ec) {
+    if (!cs || !ec) return C_ERR_NULL_PTR;
+
+    columns_free(cs);
+    // Slab (creation) order, which is the order later inserts append in
+    for (EntryHandle h = 0; h < ec->size; ++h) {
+        const LogEntry *e = entries_get(ec, h);
+        int result = columns_append(cs, entry_room(e)->id, entry_type(e), e->value, e->timestamp);
+        if (result != C_ERR_OK) {
+            return result;
+        }
+    }
+    ec->columns = cs;
+    return C_ERR_OK;
+}
+
+// Number of zones a packed motion reading saw movement in.
+static int motion_zone_count(unsigned char bits) {
+    return (bits & MOTION_LEFT ? 1 : 0) + (bits & MOTION_FORWARD ? 1 : 0) + (bits & MOTION_RIGHT ? 1 : 0);
+}
+
+// Value of reading i of a column as a number (motion: zones triggered).
+static double column_value(const TypeColumn *col, int type, int i) {
+    switch (type) {
+        case TYPE_TEMP:   return col->values.temperature[i];
+        case TYPE_DB:     return col->values.decibels[i];
+        default:          return motion_zone_count(col->values.motion[i]);
+    }
+}
+
+// min/max/sum over a whole float column. Four independent accumulators break
+// the dependency chain so the loop is not bound by add latency.
+static void stats_all_float(const float *v, int n, ReadingStats *out) {
+    float mn[4] = { v[0], v[0], v[0], v[0] };
+    float mx[4] = { v[0], v[0], v[0], v[0] };
+    double sum[4] = { 0, 0, 0, 0 };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            float x = v[i + k];
+            mn[k] = x < mn[k] ? x : mn[k];
+            mx[k] = x > mx[k] ? x : mx[k];
+            sum[k] += x;
+        }
+    }
+    for (; i < n; ++i) {
+        mn[0] = v[i] < mn[0] ? v[i] : mn[0];
+        mx[0] = v[i] > mx[0] ? v[i] : mx[0];
+        sum[0] += v[i];
+    }
+    for (int k = 1; k < 4; ++k) {
+        mn[0] = mn[k] < mn[0] ? mn[k] : mn[0];
+        mx[0] = mx[k] > mx[0] ? mx[k] : mx[0];
+    }
+    out->count = n;
+    out->min = mn[0];
+    out->max = mx[0];
+    out->sum = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+// Same for an int column; integer sums are exact, so one accumulator is fine.
+static void stats_all_int(const int *v, int n, ReadingStats *out) {
+    int mn = v[0], mx = v[0];
+    long long sum = 0;
+    for (int i = 0; i < n; ++i) {
+        mn = v[i] < mn ? v[i] : mn;
+        mx = v[i] > mx ? v[i] : mx;
+        sum += v[i];
+    }
+    out->count = n;
+    out->min = mn;
+    out->max = mx;
+    out->sum = (double)sum;
+}
+
+/* ---- columns_stats ---------------------------------------------------------
+   Purpose: count/min/max/sum of one type of reading, for one room or all.
+            Motion readings count as the number of zones that saw movement.
+   Params:
+     - cs (in): column store
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - room_id (in): room to summarise, or -1 for every room
+     - out (out): result; min/max/sum are 0 when count is 0
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int columns_stats(const ColumnStore *cs, int type, int room_id, ReadingStats *out) {
+    if (!cs || !out) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    const TypeColumn *col = &cs->columns[type - 1];
+    memset(out, 0, sizeof *out);
+    if (col->size == 0) {
+        return C_ERR_OK;
+    }
+
+    if (room_id < 0 && type == TYPE_TEMP) {
+        stats_all_float(col->values.temperature, col->size, out);
+        return C_ERR_OK;
+    }
+    if (room_id < 0 && type == TYPE_DB) {
+        stats_all_int(col->values.decibels, col->size, out);
+        return C_ERR_OK;
+    }
+
+    for (int i = 0; i < col->size; ++i) {
+        if (room_id >= 0 && col->room_ids[i] != room_id) {
+            continue;
+        }
+        double x = column_value(col, type, i);
+        if (out->count == 0 || x < out->min) out->min = x;
+        if (out->count == 0 || x > out->max) out->max = x;
+        out->sum += x;
+        out->count++;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- columns_stats_by_room -------------------------------------------------
+   Purpose: count/min/max/sum of one type of reading for every room, in a
+            single pass over that type's column.
+   Params:
+     - cs (in): column store
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - out (out): one result per room id; rooms with no readings get count 0
+     - num_rooms (in): length of out (room ids at or past it are skipped)
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int columns_stats_by_room(const ColumnStore *cs, int type, ReadingStats *out, int num_rooms) {
+    if (!cs || (!out && num_rooms > 0)) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    const TypeColumn *col = &cs->columns[type - 1];
+    memset(out, 0, num_rooms * sizeof *out);
+    for (int i = 0; i < col->size; ++i) {
+        int r = col->room_ids[i];
+        if (r < 0 || r >= num_rooms) {
+            continue;
+        }
+        double x = column_value(col, type, i);
+        ReadingStats *st = &out[r];
+        if (st->count == 0 || x < st->min) st->min = x;
+        if (st->count == 0 || x > st->max) st->max = x;
+        st->sum += x;
+        st->count++;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- columns_bytes ---------------------------------------------------------
+   Purpose: Memory held by the store's arrays (by capacity, not size).
+   Params:
+     - cs (in): column store
+   Returns: bytes allocated
+----------------------------------------------------------------------------- */
+size_t columns_bytes(const ColumnStore *cs) {
+    if (!cs) return 0;
+    size_t bytes = 0;
+    for (int type = TYPE_TEMP; type <= TYPE_MOTION; ++type) {
+        const TypeColumn *col = &cs->columns[type - 1];
+        bytes += (size_t)col->capacity * (sizeof *col->timestamps + sizeof *col->room_ids + column_value_size(type));
+    }
+    return bytes;
+}
+
+/* ---- columns_free ----------------------------------------------------------
+   Purpose: Release every column and reset the store to empty. An attached
+            store stays attached.
+   Params:
+     - cs (in/out): column store
+----------------------------------------------------------------------------- */
+void columns_free(ColumnStore *cs) {
+    if (!cs) return;
+    for (int t = 0; t < 3; ++t) {
+        free(cs->columns[t].timestamps);
+        free(cs->columns[t].room_ids);
+        free(cs->columns[t].values.raw);
+    }
+    memset(cs, 0, sizeof *cs);
+}
@@ -1,18 +1,29 @@
 #ifndef DEFS_H
 #define DEFS_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 #define MAX_ARR   16
 #define MAX_STR   32
 
+#define SLAB_CHUNK  256   /* LogEntry records per slab chunk; chunks never move once allocated */
+#define BTREE_FANOUT 32   /* keys per B+-tree node; a node is nine cache lines */
+
+/* Sort key layout (see entry_key): | room rank : 30 | type : 2 | timestamp ^ sign bit : 32 | */
+#define KEY_RANK_BITS  30
+#define KEY_RANK_LIMIT (1u << KEY_RANK_BITS)   /* ranks are 1 .. KEY_RANK_LIMIT - 1 */
+#define KEY_RANK_STEP  (1u << 16)              /* gap left after the last room in name order */
+
 #define C_ERR_OK          0
 #define C_ERR_NULL_PTR   -1
 #define C_ERR_FULL_ARRAY -2
 #define C_ERR_NOT_FOUND  -3
 #define C_ERR_DUPLICATE  -4
 #define C_ERR_INVALID    -5
+#define C_ERR_NO_MEMORY  -6
+#define C_ERR_IO         -7
 #define C_ERR_NOT_IMPLEMENTED -99 // No function should return this by the end of your assignment
 
 /* NOTE: Enumerated Data Types might be better for this, but we have not discussed these. */
@@ -20,6 +31,11 @@
 #define TYPE_DB      2
 #define TYPE_MOTION  3
 
+/* Motion zones packed one bit each (columnar and compact formats) */
+#define MOTION_LEFT     1
+#define MOTION_FORWARD  2
+#define MOTION_RIGHT    4
+
 typedef struct Room     Room;
 typedef struct LogEntry LogEntry;
 
@@ -34,30 +50,289 @@ typedef struct {
     ReadingValue value;
 } Reading;
 
-/* One log entry belongs to a room and has a timestamp */
+/* One log entry belongs to a room and has a timestamp. It is 16 bytes: the
+   type lives in the low two bits of the room pointer (rooms are at least
+   4-byte aligned), so read those two with entry_room/entry_type. The sort key
+   is not stored; entry_key rebuilds it from the room's current rank. */
 struct LogEntry {
-    Reading  data;
-    Room    *room;
-    int      timestamp;
+    uintptr_t    room_type;      /* Room * | type */
+    int          timestamp;
+    ReadingValue value;
 };
 
-/* One room has a name and a collection of pointers to its log entries */
+#define ENTRY_TYPE_MASK ((uintptr_t)3)
+
+static inline Room* entry_room(const LogEntry *e) {
+    return (Room *)(e->room_type & ~ENTRY_TYPE_MASK);
+}
+
+static inline int entry_type(const LogEntry *e) {
+    return (int)(e->room_type & ENTRY_TYPE_MASK);
+}
+
+static inline void entry_set(LogEntry *e, Room *room, int type, ReadingValue value, int timestamp) {
+    e->room_type = (uintptr_t)room | ((uintptr_t)type & ENTRY_TYPE_MASK);
+    e->timestamp = timestamp;
+    e->value = value;
+}
+
+/* One room has a name and a collection of pointers to its log entries.
+   The pointers go straight into the entry slab, which never moves an entry,
+   so inserting elsewhere in the log never has to patch them. */
 struct Room {
-    char      name[MAX_STR];
-    LogEntry* entries[MAX_ARR];
-    int       size;
+    const char *name;            /* canonical copy, owned by the collection's intern table */
+    int         id;              /* index in RoomCollection.rooms, same as the name's intern id */
+    uint32_t    rank;            /* position in name order, with gaps; the top bits of entry keys */
+    int         rank_epoch;      /* RoomCollection.rank_epoch when rank was last assigned */
+    LogEntry  **entries;         /* sorted with entry_cmp, grown on demand */
+    int         size;
+    int         capacity;
+    double     *prefix;          /* optional prefix sums of entries (see room_build_prefix) */
+    int         prefix_size;     /* size + 1 while prefix is current */
+    int         dirty_from;      /* entries[dirty_from..] rewritten since the last check (INT_MAX: none) */
 };
 
+_Static_assert(_Alignof(Room) > ENTRY_TYPE_MASK, "LogEntry needs the low bits of a Room pointer");
+
+/* Strings interned to small integer ids, with an open-addressing hash index.
+   A zero-initialised table is a valid empty one. */
+typedef struct {
+    char         **names;        /* id -> canonical copy */
+    unsigned int  *hashes;       /* id -> hash of names[id] */
+    int            size;         /* number of ids handed out */
+    int            capacity;     /* capacity of names/hashes */
+    int           *slots;        /* id + 1 per slot, 0 = empty */
+    int            num_slots;    /* power of two, at most half full */
+} InternTable;
+
+/* Rooms are allocated one at a time and never move, so entry_room() stays
+   valid as the collection grows. A zero-initialised collection is empty. */
 typedef struct {
-    Room rooms[MAX_ARR];
-    int  size;
+    Room        **rooms;         /* by room id */
+    int          *by_name;       /* room ids in name order */
+    int           size;
+    int           capacity;
+    int           rank_epoch;    /* bumped whenever every rank is reassigned */
+    InternTable   names;         /* room name -> room id */
 } RoomCollection;
 
+/* Index of a LogEntry in the slab. Handles are handed out in creation order
+   and stay valid for the lifetime of the collection. */
+typedef int EntryHandle;
+
+/* An entry's packed key together with its handle */
+typedef struct {
+    uint64_t    key;
+    EntryHandle handle;
+} KeyedHandle;
+
+/* B+-tree from packed keys to handles (btree.c), leaves linked in key order.
+   A zero-initialised tree is a valid empty one. */
+typedef struct BTreeNode BTreeNode;
+
+typedef struct {
+    BTreeNode *root;
+    int        height;           /* levels, 0 when empty; 1 when the root is a leaf */
+    int        size;             /* number of pairs */
+} BTree;
+
+/* Position in a BTree walk (btree_first/btree_seek, then btree_next) */
+typedef struct {
+    const BTreeNode *leaf;
+    int              pos;
+} BTreeIter;
+
+/* Readings of one type in column form: parallel arrays in creation order */
+typedef struct {
+    int   *timestamps;
+    int   *room_ids;
+    union {
+        void          *raw;
+        float         *temperature;  /* TYPE_TEMP */
+        int           *decibels;     /* TYPE_DB */
+        unsigned char *motion;       /* TYPE_MOTION, MOTION_* bits */
+    } values;
+    int    size;
+    int    capacity;
+} TypeColumn;
+
+/* One TypeColumn per reading type, indexed by TYPE_* - 1. A zero-initialised
+   store is a valid empty one. */
+typedef struct {
+    TypeColumn columns[3];
+} ColumnStore;
+
+/* Summary of a set of readings (mean = sum / count) */
+typedef struct {
+    int    count;
+    double min;
+    double max;
+    double sum;
+} ReadingStats;
+
+/* Motion readings by room (motion.c): the timestamps of a room's motion
+   readings in ascending order, and one bit column per zone where bit i is
+   set when reading i saw movement there, 64 readings to a word. A time
+   window is a run of bit positions, so any/all/count questions over it are
+   OR, AND and popcount over whole words. A zero-initialised store is a
+   valid empty one. */
+#define MOTION_ZONES  3          /* left, forward, right: zones[] and MotionCounts.zones[] order */
+
+typedef struct {
+    int       *timestamps;       /* ascending */
+    uint64_t  *zones[MOTION_ZONES];
+    int        size;
+    int        capacity;         /* a multiple of 64 */
+} MotionRow;
+
 typedef struct {
-    LogEntry entries[MAX_ARR];
-    int      size;
+    MotionRow *rows;             /* by room id */
+    int        num_rooms;        /* rooms that have rows */
+    long       size;             /* readings held */
+} MotionStore;
+
+/* Motion readings in a window, and how many of them saw movement */
+typedef struct {
+    int readings;
+    int zones[MOTION_ZONES];     /* in each zone */
+    int any_zone;                /* in at least one zone */
+    int all_zones;               /* in all three */
+} MotionCounts;
+
+/* Rollups (rollup.c): per room, TEMP and DB readings summarised by
+   minute, hour and day. Each series holds only the buckets that have
+   readings, sorted; bucket b covers timestamps [b * width, (b + 1) * width).
+   A zero-initialised store is a valid empty one. */
+#define ROLLUP_LEVELS        3
+#define ROLLUP_LEVEL_MINUTE  0
+#define ROLLUP_LEVEL_HOUR    1
+#define ROLLUP_LEVEL_DAY     2
+#define ROLLUP_MINUTE        60      /* bucket widths, in timestamp units (seconds) */
+#define ROLLUP_HOUR          3600
+#define ROLLUP_DAY           86400
+
+typedef struct {
+    int           bucket;        /* floor(timestamp / width) */
+    ReadingStats  stats;
+} RollupBucket;
+
+typedef struct {
+    RollupBucket *buckets;
+    int           size;
+    int           capacity;
+    int           stale;         /* could not grow; queries use the entry list instead */
+} RollupSeries;
+
+typedef struct {
+    RollupSeries *series;        /* by (room id * 2 + type - 1) * ROLLUP_LEVELS + level */
+    int           num_rooms;     /* rooms that have series */
+} RollupStore;
+
+/* Secondary indexes (index.c), declared at startup: entry handles sorted by
+   timestamp, per type (INDEX_TYPE_TIME) and/or over every type
+   (INDEX_TIME), ties in creation order. entries_scan_begin picks whichever
+   fits a query. A zero-initialised HandleIndex is a valid empty one. */
+#define INDEX_TYPE_TIME  1       /* (type, timestamp) */
+#define INDEX_TIME       2       /* (timestamp) */
+
+#define SCAN_FULL        0       /* plans, see entries_scan_begin */
+#define SCAN_TYPE_INDEX  1
+#define SCAN_TIME_INDEX  2
+
+typedef struct {
+    EntryHandle *handles;
+    int          size;
+    int          capacity;
+} HandleIndex;
+
+typedef struct {
+    int          kinds;          /* INDEX_* declared */
+    int          usable;         /* INDEX_* complete (one is dropped if it cannot grow) */
+    HandleIndex  by_type[3];     /* INDEX_TYPE_TIME, by TYPE_* - 1 */
+    HandleIndex  by_time;        /* INDEX_TIME */
+} SecondaryIndex;
+
+/* Retention (retain.c): instead of the whole log, the newest readings of
+   each room and type in a ring of fixed size, kept in timestamp order.
+   Attached to an entry collection, it takes every insert in place of the
+   slab, so memory stays fixed however long the program runs. */
+#define RETAIN_MAX_COUNT      (1 << 20)  /* largest ring */
+#define RETAIN_DEFAULT_COUNT  1024       /* ring size when only an age limit is given */
+
+typedef struct {
+    int           timestamp;
+    ReadingValue  value;
+} RetainSlot;
+
+typedef struct {
+    RetainSlot *slots;           /* max_count slots, allocated on first reading */
+    int         head;            /* slot of the oldest reading */
+    int         size;
+} RetainRing;
+
+typedef struct {
+    int          max_count;      /* readings kept per room and type */
+    int          max_age;        /* also drop readings older than the newest - max_age; 0 = no limit */
+    RetainRing  *rings;          /* by room id * 3 + type - 1 */
+    int          num_rooms;      /* rooms that have rings */
+    long         size;           /* readings held */
+    long         evicted;        /* readings dropped so far */
+} RetentionStore;
+
+/* Position in a walk over retained readings (retain_first, then retain_next) */
+typedef struct {
+    const Room *room;            /* only this room, or NULL for every room */
+    int         pos;             /* index in by_name */
+    int         type;
+    int         i;               /* reading within the ring, oldest first */
+} RetainIter;
+
+/* Entries live in a slab of fixed-size chunks (stable addresses); the sorted
+   view is a B+-tree of handles, so an insert anywhere in the order is
+   O(log n). A zero-initialised collection is a valid empty one. */
+typedef struct {
+    LogEntry   **chunks;         /* slab: chunks of SLAB_CHUNK entries */
+    int          num_chunks;
+    BTree        order;          /* handles in entry_cmp order */
+    int          size;
+    int          key_epoch;      /* rank epoch the order tree's keys were computed in */
+    ColumnStore *columns;        /* optional; every insert is appended to it when set */
+    MotionStore *motion;         /* optional; every motion reading is added to it when set */
+    RollupStore *rollups;        /* optional; every TEMP and DB reading is rolled up when set */
+    SecondaryIndex *index;       /* optional; every insert is indexed when set */
+    RetentionStore *retain;      /* optional; when set, inserts go to it instead of the slab */
 } EntryCollection;
 
+/* Bytes held for the entries, by structure (see entries_memory) */
+typedef struct {
+    size_t slab;                 /* LogEntry chunks */
+    size_t order;                /* B+-tree nodes */
+    size_t room_lists;           /* rooms' entry pointer arrays */
+    size_t columns;              /* attached column store, if any */
+    size_t motion;               /* attached motion store, if any */
+    size_t rollups;              /* attached rollup store, if any */
+    size_t index;                /* attached secondary indexes, if any */
+} MemoryUsage;
+
+/* A walk over the entries matching a type and time window, in timestamp
+   order (entries_scan_begin, entries_scan_next, entries_scan_end) */
+typedef struct {
+    const EntryCollection *ec;
+    int                plan;     /* SCAN_* */
+    int                type;     /* type still to filter on, 0 = none */
+    const EntryHandle *handles;  /* an index run, or the sorted matches of a full scan */
+    int                pos;
+    int                end;
+    EntryHandle       *owned;    /* the full scan's matches, freed by entries_scan_end */
+} EntryScan;
+
+/* One entry for entries_bulk_create: the same arguments entries_create takes */
+typedef struct {
+    Room         *room;
+    int           type;
+    ReadingValue  value;
+    int           timestamp;
+} EntryInput;
 
 int rooms_add(RoomCollection *rc, const char *room_name);
 int entries_create(EntryCollection *ec,
@@ -65,16 +340,248 @@ int entries_create(EntryCollection *ec,
                 int              type,
                 ReadingValue     value,
                 int              timestamp);
+int entries_bulk_create(EntryCollection *ec, RoomCollection *rc, const EntryInput *batch, size_t n);
 
 Room* rooms_find(RoomCollection *rc, const char *room_name);
 int room_print(const Room *r);
 int entry_print(const LogEntry *e);
 int entry_cmp(const LogEntry *a, const LogEntry *b);
+uint64_t entry_key(const Room *room, int type, int timestamp);
+uint64_t entry_sort_key(const LogEntry *e);
+
+void keyed_radix_sort(KeyedHandle *items, KeyedHandle *tmp, int n);
+LogEntry* entries_get(const EntryCollection *ec, EntryHandle h);
+LogEntry* entries_next(const EntryCollection *ec, BTreeIter *it);
+void entries_memory(const EntryCollection *ec, const RoomCollection *rc, MemoryUsage *out);
+void entries_free(EntryCollection *ec);
+void rooms_free(RoomCollection *rc);
+
+int columns_reserve(ColumnStore *cs, int type, int extra);
+int columns_append(ColumnStore *cs, int room_id, int type, ReadingValue value, int timestamp);
+int columns_attach(ColumnStore *cs, EntryCollection *ec);
+int columns_stats(const ColumnStore *cs, int type, int room_id, ReadingStats *out);
+int columns_stats_by_room(const ColumnStore *cs, int type, ReadingStats *out, int num_rooms);
+size_t columns_bytes(const ColumnStore *cs);
+void columns_free(ColumnStore *cs);
+
+int btree_insert(BTree *t, uint64_t key, EntryHandle handle);
+int btree_build(BTree *t, const KeyedHandle *items, int n);
+void btree_rekey(BTree *t, const EntryCollection *ec);
+void btree_first(const BTree *t, BTreeIter *it);
+void btree_seek(const BTree *t, uint64_t key, BTreeIter *it);
+int btree_next(BTreeIter *it, KeyedHandle *out);
+size_t btree_bytes(const BTree *t);
+void btree_free(BTree *t);
+
+int intern_lookup(const InternTable *t, const char *s);
+int intern_add(InternTable *t, const char *s);
+const char* intern_name(const InternTable *t, int id);
+void intern_free(InternTable *t);
+
+double reading_numeric(int type, ReadingValue value);
+int room_build_prefix(Room *r);
+int query_range_stats(const Room *r, int type, int t_from, int t_to, ReadingStats *out);
+int query_range_sum(const Room *r, int type, int t_from, int t_to, ReadingStats *out);
+
+int motion_reserve(MotionStore *ms, const Room *room, int extra);
+int motion_add(MotionStore *ms, const Room *room, ReadingValue value, int timestamp);
+void motion_rebuild_room(MotionStore *ms, const Room *room);
+int motion_attach(MotionStore *ms, EntryCollection *ec);
+int motion_window(const MotionStore *ms, const Room *room, int t_from, int t_to, MotionCounts *out);
+int motion_any(const MotionStore *ms, const Room *room, int zone_bits, int t_from, int t_to);
+int motion_all(const MotionStore *ms, const Room *room, int zone_bits, int t_from, int t_to);
+size_t motion_bytes(const MotionStore *ms);
+void motion_free(MotionStore *ms);
+
+int rollup_reserve(RollupStore *rs, const Room *room, int extra);
+int rollup_add(RollupStore *rs, const Room *room, int type, ReadingValue value, int timestamp);
+void rollup_rebuild_room(RollupStore *rs, const Room *room);
+int rollup_attach(RollupStore *rs, EntryCollection *ec, const RoomCollection *rc);
+int rollup_buckets(const RollupStore *rs, const Room *room, int type, int level, int t_from, int t_to,
+                   const RollupBucket **first, int *n);
+int rollup_range_stats(const RollupStore *rs, const Room *room, int type, int t_from, int t_to, ReadingStats *out);
+size_t rollup_bytes(const RollupStore *rs);
+void rollup_free(RollupStore *rs);
+
+int index_init(SecondaryIndex *ix, int kinds);
+int index_reserve(SecondaryIndex *ix, int type, int extra);
+void index_add(SecondaryIndex *ix, const EntryCollection *ec, EntryHandle h);
+int index_add_batch(SecondaryIndex *ix, const EntryCollection *ec, EntryHandle first, int n);
+int index_attach(SecondaryIndex *ix, EntryCollection *ec);
+int entries_scan_begin(EntryScan *scan, const EntryCollection *ec, int type, int t_from, int t_to);
+const LogEntry* entries_scan_next(EntryScan *scan);
+void entries_scan_end(EntryScan *scan);
+size_t index_bytes(const SecondaryIndex *ix);
+void index_free(SecondaryIndex *ix);
+
+int retain_init(RetentionStore *rs, int max_count, int max_age);
+int retain_attach(RetentionStore *rs, EntryCollection *ec);
+int retain_reserve(RetentionStore *rs, const Room *room, int type);
+int retain_add(RetentionStore *rs, const Room *room, int type, ReadingValue value, int timestamp);
+int retain_count(const RetentionStore *rs, const Room *room);
+void retain_first(RetainIter *it, const Room *room);
+int retain_next(const RetentionStore *rs, const RoomCollection *rc, RetainIter *it, LogEntry *out);
+int retain_range_stats(const RetentionStore *rs, const Room *room, int type, int t_from, int t_to, ReadingStats *out);
+size_t retain_bytes(const RetentionStore *rs);
+void retain_free(RetentionStore *rs);
+
+/* Concurrent ingestion (ingest.c): producers on any thread submit readings
+   to per-room lock-free queues; one merger thread applies them in batches.
+   Link with -pthread. */
+typedef struct Ingest Ingest;
+
+/* A read-only version of the sorted log, pinned with ingest_snapshot. Slab
+   entries never move or change once created, so a version is only their
+   order; merges after the pin go into newer versions and leave it alone. */
+typedef struct {
+    const LogEntry **entries;    /* entry_cmp order */
+    int              size;
+    long             merged;     /* readings the merger had applied when it was made */
+} EntrySnapshot;
+
+Ingest* ingest_start(RoomCollection *rc, EntryCollection *ec);
+int ingest_submit(Ingest *in, Room *room, int type, ReadingValue value, int timestamp);
+void ingest_read_begin(Ingest *in);
+void ingest_read_end(Ingest *in);
+const EntrySnapshot* ingest_snapshot(Ingest *in);
+void ingest_release(const EntrySnapshot *snap);
+int ingest_flush(Ingest *in);
+int ingest_stop(Ingest *in);
+
+/* On-disk store (persist.c): a snapshot plus an append-only log of what was
+   added since. Open it into empty collections, log each room and entry
+   after adding it, and snapshot now and then to keep the log short. */
+#define PERSIST_PATH_MAX        256
+#define PERSIST_SNAPSHOT_EVERY  1024   /* log records before main takes a new snapshot */
+
+typedef struct {
+    char     dir[PERSIST_PATH_MAX];
+    FILE    *log;                /* log.bin, open for appending */
+    uint32_t generation;         /* generation of the current snapshot, 0 before the first */
+    int      snapshot_entries;   /* entries loaded from / written to the snapshot */
+    int      log_records;        /* records in the log (replayed on open, then appended) */
+    long     dropped_bytes;      /* corrupt log tail cut off on open */
+} PersistStore;
+
+int persist_open(PersistStore *ps, const char *dir, RoomCollection *rc, EntryCollection *ec);
+int persist_log_room(PersistStore *ps, const char *name);
+int persist_log_entry(PersistStore *ps, const Room *room, int type, ReadingValue value, int timestamp);
+int persist_snapshot(PersistStore *ps, const RoomCollection *rc, const EntryCollection *ec);
+void persist_close(PersistStore *ps);
+
+/* Batch input (batch.c): a whole file, mapped or read into memory, handed
+   out line by line and field by field as slices into it. */
+typedef struct {
+    const char *s;               /* not NUL-terminated */
+    size_t      len;
+} BatchField;
+
+typedef struct {
+    const char *data;
+    size_t      size;
+    size_t      pos;             /* start of the next line */
+    int         line;            /* number of the line last returned, from 1 */
+    int         mapped;          /* data is an mmap, otherwise malloc'd */
+} BatchInput;
+
+int batch_open(BatchInput *in, const char *path);
+int batch_next_line(BatchInput *in, BatchField *line);
+int batch_split(BatchField *rest, char sep, BatchField *field);
+BatchField batch_trim(BatchField f);
+int batch_leading_int(BatchField *f, int *out);
+int batch_int(BatchField f, int *out);
+int batch_float(BatchField f, float *out);
+int batch_leading_float(BatchField f, float *out);
+int batch_motion(BatchField f, unsigned char motion[3]);
+void batch_close(BatchInput *in);
+
+/* Buffered report output (report.c): rows are formatted into a buffer that
+   goes out with one write() per REPORT_BUF_SIZE bytes. */
+#define REPORT_TEXT      0       /* the tables the menu prints */
+#define REPORT_CSV       1       /* room,type,timestamp,value */
+#define REPORT_BINARY    2       /* room table + fixed-size records, exact values */
+#define REPORT_BUF_SIZE  (1 << 16)
+#define REPORT_ROW_MAX   128     /* longest formatted row */
+
+typedef struct {
+    int    fd;
+    char  *buf;
+    size_t len;
+    int    error;                /* C_ERR_IO once a write failed */
+} ReportWriter;
+
+int report_open(ReportWriter *w, FILE *out);
+void report_write(ReportWriter *w, const void *data, size_t size);
+size_t report_entry_row(char *out, const LogEntry *e);
+void report_room(ReportWriter *w, const Room *r);
+int report_entries(ReportWriter *w, const EntryCollection *ec, const RoomCollection *rc, int format);
+int report_retained(ReportWriter *w, const RetentionStore *rs, const RoomCollection *rc, const Room *room);
+int report_scan(ReportWriter *w, EntryScan *scan, long *count);
+int report_snapshot(ReportWriter *w, const EntrySnapshot *snap, const Room *room);
+int report_close(ReportWriter *w);
+
+/* Consistency checker (check.c), O(n) over the collections. A
+   zero-initialised CheckState has not run yet; an incremental run checks
+   what changed since the previous run with the same state. */
+#define CHECK_ORDER      1       /* order tree: every entry once, in entry_cmp order */
+#define CHECK_ROOMS      2       /* room table and lists: every entry in its own room, once */
+#define CHECK_MSG_MAX    96
+
+typedef struct {
+    int  has_run;
+    int  entries;                /* ec->size after the last run */
+    int  rank_epoch;             /* rc->rank_epoch then */
+    int  key_epoch;              /* ec->key_epoch then */
+    int  checked;                /* last run: entries and list slots looked at */
+    int  errors;                 /* last run: problems found */
+    char first_error[CHECK_MSG_MAX];
+} CheckState;
+
+int check_full(CheckState *st, const EntryCollection *ec, RoomCollection *rc, int parts);
+int check_incremental(CheckState *st, const EntryCollection *ec, RoomCollection *rc);
+int check_snapshot(CheckState *st, const EntrySnapshot *snap, const RoomCollection *rc);
+
+/* Synthetic workloads for benchmarks (workload.c, link with -lm) */
+#define WORKLOAD_SORTED    0     /* timestamps increasing */
+#define WORKLOAD_REVERSED  1     /* timestamps decreasing */
+#define WORKLOAD_RANDOM    2     /* timestamps uniform over [0, entries) */
+#define WORKLOAD_BURSTY    3     /* runs of close readings from one room, then a gap */
+
+typedef struct {
+    int      num_rooms;
+    int      num_entries;
+    int      mix[3];             /* relative weights of TEMP, DB, MOTION */
+    int      order;              /* WORKLOAD_* */
+    double   zipf;               /* room popularity exponent, 0 = uniform */
+    uint64_t seed;
+} WorkloadSpec;
+
+typedef struct {
+    int          room;           /* index into Workload.names */
+    int          type;
+    ReadingValue value;
+    int          timestamp;
+} WorkloadEntry;
+
+typedef struct {
+    char          (*names)[MAX_STR];
+    int             num_rooms;
+    WorkloadEntry  *entries;
+    int             num_entries;
+} Workload;
+
+int workload_generate(const WorkloadSpec *spec, Workload *wl);
+int workload_write_csv(const Workload *wl, FILE *out);
+void workload_free(Workload *wl);
 
 
 /* =========================================
    Loader (provided as an object file)
    =========================================
+   loader.o was compiled against the original fixed-capacity layouts below, so
+   it can only read and write those. Use the sample_* wrappers with the real
+   collections; they copy to and from these layouts.
+
    load_sample: Override the contents of the collections with sample data.
     - rc (out): room collection
     - ec (out): entry collection
@@ -90,8 +597,38 @@ int entry_cmp(const LogEntry *a, const LogEntry *b);
     - verbose (in): if non-zero, print out errors as we find them
     - Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID (invalid means there is a problem with the room/entry linkage)
    ========================================= */
-int load_sample(RoomCollection *rc, EntryCollection *ec);
-int loader_test_order(const EntryCollection *ec, int verbose);
-int loader_test_rooms(const EntryCollection *ec, const RoomCollection *rc, int verbose);
+typedef struct LoaderRoom LoaderRoom;
+
+typedef struct {
+    Reading     data;
+    LoaderRoom *room;
+    int         timestamp;
+} LoaderEntry;
+
+struct LoaderRoom {
+    char         name[MAX_STR];
+    LoaderEntry* entries[MAX_ARR];
+    int          size;
+};
+
+typedef struct {
+    LoaderRoom rooms[MAX_ARR];
+    int        size;
+} LoaderRoomCollection;
+
+typedef struct {
+    LoaderEntry entries[MAX_ARR];
+    int         size;
+} LoaderEntryCollection;
+
+int load_sample(LoaderRoomCollection *rc, LoaderEntryCollection *ec);
+int loader_test_order(const LoaderEntryCollection *ec, int verbose);
+int loader_test_rooms(const LoaderEntryCollection *ec, const LoaderRoomCollection *rc, int verbose);
+
+/* sample_* (sample.c): the loader functions above, applied to the real collections.
+   sample_test_* return C_ERR_FULL_ARRAY when the data does not fit the loader layout. */
+int sample_load(RoomCollection *rc, EntryCollection *ec);
+int sample_test_order(const EntryCollection *ec, int verbose);
+int sample_test_rooms(const EntryCollection *ec, const RoomCollection *rc, int verbose);
 
 #endif /* DEFS_H */
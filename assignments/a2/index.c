@@ -0,0 +1,332 @@
+// index.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Secondary indexes: entry handles sorted by timestamp, either per type
+   (INDEX_TYPE_TIME) or over every type (INDEX_TIME), ties in creation
+   order. A handle is 4 bytes and the timestamp is read through it, so an
+   index costs 4 bytes per entry. Readings mostly arrive in time order,
+   which makes an insert an append; a late one is binary searched and
+   shifts the handles after it. A bulk insert sorts its own handles and
+   merges them in from the back of the grown array.
+   An index that cannot grow during a bulk insert is dropped (its kind
+   cleared from `usable`), and scans fall back to the entry log. */
+
+static int entry_timestamp(const EntryCollection *ec, EntryHandle h) {
+    return entries_get(ec, h)->timestamp;
+}
+
+// Radix sort key for a timestamp: sign bit flipped, in the high half (the
+// low half stays 0, so the sort skips those passes)
+static uint64_t time_key(int timestamp) {
+    return (uint64_t)((uint32_t)timestamp ^ 0x80000000u) << 32;
+}
+
+// First position in the index whose timestamp is greater than `timestamp`
+static int index_upper_bound(const HandleIndex *index, const EntryCollection *ec, long long timestamp) {
+    int lo = 0, hi = index->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (entry_timestamp(ec, index->handles[mid]) <= timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int handle_index_grow(HandleIndex *index, int needed) {
+    if (needed <= index->capacity) {
+        return C_ERR_OK;
+    }
+    int capacity = index->capacity ? index->capacity : SLAB_CHUNK;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    EntryHandle *handles = realloc(index->handles, (size_t)capacity * sizeof *handles);
+    if (!handles) return C_ERR_NO_MEMORY;
+    index->handles = handles;
+    index->capacity = capacity;
+    return C_ERR_OK;
+}
+
+// Insert one handle, newer than every handle in the index
+static void handle_index_insert(HandleIndex *index, const EntryCollection *ec, EntryHandle h) {
+    int timestamp = entry_timestamp(ec, h);
+    int pos = index->size;
+    if (pos > 0 && entry_timestamp(ec, index->handles[pos - 1]) > timestamp) {
+        pos = index_upper_bound(index, ec, timestamp);
+        memmove(index->handles + pos + 1, index->handles + pos, (size_t)(index->size - pos) * sizeof *index->handles);
+    }
+    index->handles[pos] = h;
+    index->size++;
+}
+
+// Merge m sorted new handles (all newer than the index's) into the index,
+// from the back, so no second array is needed
+static int handle_index_merge(HandleIndex *index, const EntryCollection *ec, const KeyedHandle *sorted, int m) {
+    if (handle_index_grow(index, index->size + m) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    int i = index->size - 1, j = m - 1, k = index->size + m - 1;
+    while (j >= 0) {
+        // On equal timestamps the older (existing) handle stays first
+        if (i >= 0 && time_key(entry_timestamp(ec, index->handles[i])) > sorted[j].key) {
+            index->handles[k--] = index->handles[i--];
+        } else {
+            index->handles[k--] = sorted[j--].handle;
+        }
+    }
+    index->size += m;
+    return C_ERR_OK;
+}
+
+/* ---- index_init ------------------------------------------------------------
+   Purpose: Declare which secondary indexes to keep.
+   Params:
+     - ix (out): indexes, released with index_free
+     - kinds (in): INDEX_TYPE_TIME, INDEX_TIME or both
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int index_init(SecondaryIndex *ix, int kinds) {
+    if (!ix) return C_ERR_NULL_PTR;
+    if (kinds == 0 || (kinds & ~(INDEX_TYPE_TIME | INDEX_TIME))) return C_ERR_INVALID;
+    memset(ix, 0, sizeof *ix);
+    ix->kinds = kinds;
+    ix->usable = kinds;
+    return C_ERR_OK;
+}
+
+/* ---- index_reserve ---------------------------------------------------------
+   Purpose: Make room for `extra` more entries of a type, so that index_add
+            for them cannot fail.
+   Params:
+     - ix (in/out): indexes
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - extra (in): entries about to be added
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int index_reserve(SecondaryIndex *ix, int type, int extra) {
+    if (!ix) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION || extra < 0) return C_ERR_INVALID;
+    if ((ix->usable & INDEX_TYPE_TIME) &&
+        handle_index_grow(&ix->by_type[type - 1], ix->by_type[type - 1].size + extra) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    if ((ix->usable & INDEX_TIME) && handle_index_grow(&ix->by_time, ix->by_time.size + extra) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- index_add -------------------------------------------------------------
+   Purpose: Add the newest entry of a collection to the indexes. O(1) when
+            it is also the latest timestamp, otherwise O(log n + k) for the
+            k handles after it.
+   Params:
+     - ix (in/out): indexes, reserved for the entry
+     - ec (in): entry collection holding it
+     - h (in): its handle
+----------------------------------------------------------------------------- */
+void index_add(SecondaryIndex *ix, const EntryCollection *ec, EntryHandle h) {
+    if (!ix || !ec) return;
+    if (ix->usable & INDEX_TYPE_TIME) {
+        handle_index_insert(&ix->by_type[entry_type(entries_get(ec, h)) - 1], ec, h);
+    }
+    if (ix->usable & INDEX_TIME) {
+        handle_index_insert(&ix->by_time, ec, h);
+    }
+}
+
+/* ---- index_add_batch -------------------------------------------------------
+   Purpose: Add the n newest entries of a collection (handles first ..
+            first + n - 1) with one sort and one merge per index. An index
+            that cannot grow is dropped rather than left incomplete.
+   Params:
+     - ix (in/out): indexes
+     - ec (in): entry collection holding them
+     - first (in): handle of the first new entry
+     - n (in): number of new entries
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY (an index was dropped)
+----------------------------------------------------------------------------- */
+int index_add_batch(SecondaryIndex *ix, const EntryCollection *ec, EntryHandle first, int n) {
+    if (!ix || !ec) return C_ERR_NULL_PTR;
+    if (n <= 0 || !ix->usable) return C_ERR_OK;
+
+    int result = C_ERR_OK;
+    KeyedHandle *sorted = malloc(2 * (size_t)n * sizeof *sorted);
+    if (!sorted) {
+        ix->usable = 0;
+        return C_ERR_NO_MEMORY;
+    }
+    // Handles go in ascending, and the sort is stable, so ties stay in creation order
+    for (int i = 0; i < n; ++i) {
+        sorted[i].key = time_key(entry_timestamp(ec, first + i));
+        sorted[i].handle = first + i;
+    }
+    keyed_radix_sort(sorted, sorted + n, n);
+
+    if ((ix->usable & INDEX_TIME) && handle_index_merge(&ix->by_time, ec, sorted, n) != C_ERR_OK) {
+        ix->usable &= ~INDEX_TIME;
+        result = C_ERR_NO_MEMORY;
+    }
+    if (ix->usable & INDEX_TYPE_TIME) {
+        for (int type = TYPE_TEMP; type <= TYPE_MOTION; ++type) {
+            // This type's handles, still sorted, packed into the scratch half
+            KeyedHandle *of_type = sorted + n;
+            int m = 0;
+            for (int i = 0; i < n; ++i) {
+                if (entry_type(entries_get(ec, sorted[i].handle)) == type) of_type[m++] = sorted[i];
+            }
+            if (m > 0 && handle_index_merge(&ix->by_type[type - 1], ec, of_type, m) != C_ERR_OK) {
+                ix->usable &= ~INDEX_TYPE_TIME;
+                result = C_ERR_NO_MEMORY;
+                break;
+            }
+        }
+    }
+    free(sorted);
+    return result;
+}
+
+/* ---- index_attach ----------------------------------------------------------
+   Purpose: Index the entries already in a collection and attach the
+            indexes, so every later insert is added to them as well.
+   Params:
+     - ix (in/out): indexes from index_init (any previous contents are discarded)
+     - ec (in/out): entry collection
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int index_attach(SecondaryIndex *ix, EntryCollection *ec) {
+    if (!ix || !ec) return C_ERR_NULL_PTR;
+
+    index_free(ix);
+    int result = index_add_batch(ix, ec, 0, ec->size);
+    if (result != C_ERR_OK) {
+        index_free(ix);
+        return result;
+    }
+    ec->index = ix;
+    return C_ERR_OK;
+}
+
+/* ---- entries_scan_begin / entries_scan_next / entries_scan_end --------------
+   Purpose: Walk the entries of one type (or every type) with a timestamp in
+            [t_from, t_to], in timestamp order (ties in creation order). The
+            plan is picked from the indexes the collection has:
+              - SCAN_TYPE_INDEX for one type with INDEX_TYPE_TIME, O(log n + k);
+              - SCAN_TIME_INDEX with INDEX_TIME, O(log n + k), skipping other
+                types when one is asked for;
+              - SCAN_FULL otherwise: every entry is looked at and the matches
+                are sorted, O(n + k).
+   Params:
+     - scan (out/in/out): scan state; scan->plan tells which plan was used
+     - ec (in): entry collection (not changed while the scan is open)
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION, or 0 for every type
+     - t_from, t_to (in): inclusive timestamp bounds
+   Returns: begin: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY;
+            next: the next entry, or NULL at the end
+----------------------------------------------------------------------------- */
+int entries_scan_begin(EntryScan *scan, const EntryCollection *ec, int type, int t_from, int t_to) {
+    if (!scan || !ec) return C_ERR_NULL_PTR;
+    if (type < 0 || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    memset(scan, 0, sizeof *scan);
+    scan->ec = ec;
+    const SecondaryIndex *ix = ec->index;
+    const HandleIndex *run = NULL;
+    if (ix && type != 0 && (ix->usable & INDEX_TYPE_TIME)) {
+        scan->plan = SCAN_TYPE_INDEX;
+        run = &ix->by_type[type - 1];
+    } else if (ix && (ix->usable & INDEX_TIME)) {
+        scan->plan = SCAN_TIME_INDEX;
+        scan->type = type;
+        run = &ix->by_time;
+    }
+    if (run) {
+        scan->handles = run->handles;
+        scan->pos = index_upper_bound(run, ec, (long long)t_from - 1);
+        scan->end = index_upper_bound(run, ec, t_to);
+        if (scan->end < scan->pos) scan->end = scan->pos;
+        return C_ERR_OK;
+    }
+
+    // No index fits: collect the matches and sort them by timestamp
+    scan->plan = SCAN_FULL;
+    int n = 0;
+    KeyedHandle *matches = malloc(2 * (size_t)(ec->size ? ec->size : 1) * sizeof *matches);
+    if (!matches) return C_ERR_NO_MEMORY;
+    for (EntryHandle h = 0; h < ec->size; ++h) {
+        const LogEntry *e = entries_get(ec, h);
+        if ((type == 0 || entry_type(e) == type) && e->timestamp >= t_from && e->timestamp <= t_to) {
+            matches[n].key = time_key(e->timestamp);
+            matches[n++].handle = h;
+        }
+    }
+    if (n > 0) {
+        keyed_radix_sort(matches, matches + n, n);
+    }
+    // Keep only the handles, compacted to the front of the same block
+    // (handles[i] never overwrites a pair not yet read)
+    EntryHandle *handles = (EntryHandle *)matches;
+    for (int i = 0; i < n; ++i) {
+        handles[i] = matches[i].handle;
+    }
+    scan->owned = handles;
+    scan->handles = handles;
+    scan->end = n;
+    return C_ERR_OK;
+}
+
+const LogEntry* entries_scan_next(EntryScan *scan) {
+    while (scan->pos < scan->end) {
+        const LogEntry *e = entries_get(scan->ec, scan->handles[scan->pos++]);
+        if (scan->type == 0 || entry_type(e) == scan->type) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+void entries_scan_end(EntryScan *scan) {
+    if (!scan) return;
+    free(scan->owned);
+    scan->owned = NULL;
+    scan->handles = NULL;
+    scan->pos = scan->end = 0;
+}
+
+/* ---- index_bytes -----------------------------------------------------------
+   Purpose: Memory held by the indexes (by capacity, not size).
+   Params:
+     - ix (in): indexes
+   Returns: bytes allocated
+----------------------------------------------------------------------------- */
+size_t index_bytes(const SecondaryIndex *ix) {
+    if (!ix) return 0;
+    size_t capacity = ix->by_time.capacity;
+    for (int t = 0; t < 3; ++t) {
+        capacity += ix->by_type[t].capacity;
+    }
+    return capacity * sizeof(EntryHandle);
+}
+
+/* ---- index_free ------------------------------------------------------------
+   Purpose: Release the indexes and reset them to empty, keeping the kinds
+            declared (and usable again). Attached indexes stay attached.
+   Params:
+     - ix (in/out): indexes
+----------------------------------------------------------------------------- */
+void index_free(SecondaryIndex *ix) {
+    if (!ix) return;
+    int kinds = ix->kinds;
+    free(ix->by_time.handles);
+    for (int t = 0; t < 3; ++t) {
+        free(ix->by_type[t].handles);
+    }
+    memset(ix, 0, sizeof *ix);
+    ix->kinds = kinds;
+    ix->usable = kinds;
+}
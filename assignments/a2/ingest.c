@@ -0,0 +1,402 @@
+// ingest.c
+
+#include "defs.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Thread-safe ingestion. Producers never touch the collections: each reading
+   goes onto its room's queue, a lock-free multi-producer / single-consumer
+   list (one atomic exchange per push). One merger thread drains every queue
+   and applies what it got as one batch under the write side of a rwlock, so
+   readers holding the read side always see whole batches, never a half-made
+   insert.
+
+   Queue algorithm: Dmitry Vyukov's intrusive MPSC queue. `head` is where
+   producers link new nodes; the consumer walks from `tail`. A stub node keeps
+   the list non-empty so push and pop never contend on the same pointer.
+
+   Snapshots: reports and checks that must not hold up merges read a version
+   instead of the live collections. A version is a refcounted array of entry
+   pointers in sorted order, built by the merger from the order tree (which
+   only it writes, so it needs no lock for that). Pinning one is a pointer
+   load and an increment under `version_lock`, which the merger only takes to
+   swap in a new version; the last release of a replaced version frees it.
+   Building is O(n), so the merger does it lazily: only after a reader has
+   pinned a version, and then once the log has grown by 1/INGEST_VERSION_LAG
+   since, or the merger is idle, or ingest_flush waits for it. Without
+   snapshot readers versions cost nothing. */
+
+#define INGEST_IDLE_NS   50000   /* merger sleep when every queue was empty */
+#define INGEST_BULK_MIN  16      /* batch sizes below size/this are inserted one by one */
+#define INGEST_MAX_BATCH 65536   /* readings drained per round, so readers get the lock back */
+#define INGEST_VERSION_LAG 8     /* a wanted version is rebuilt once the log grew by 1/this */
+#define CACHE_LINE       64
+
+typedef struct IngestNode IngestNode;
+
+struct IngestNode {
+    IngestNode *_Atomic next;
+    EntryInput          input;
+};
+
+// Each queue starts on its own cache line, so producers of different rooms
+// do not invalidate each other's `head`
+typedef struct {
+    _Alignas(CACHE_LINE) IngestNode *_Atomic head;  /* last node pushed (producers) */
+    IngestNode         *tail;    /* next node to pop (merger only) */
+    IngestNode          stub;
+} IngestQueue;
+
+// A published version: the EntrySnapshot readers see, then its references
+// (one per reader, plus one while it is the current version)
+typedef struct {
+    EntrySnapshot snap;
+    atomic_int    refs;
+} IngestVersion;
+
+struct Ingest {
+    RoomCollection   *rc;
+    EntryCollection  *ec;
+    IngestQueue      *queues;    /* one per room id */
+    int               num_queues;
+    pthread_rwlock_t  lock;      /* write: merger applying a batch; read: ingest_read_begin */
+    pthread_t         merger;
+    atomic_int        stop;
+    atomic_long       submitted;
+    atomic_long       merged;
+    int               error;     /* first merge failure, C_ERR_OK if none */
+    pthread_mutex_t   version_lock;  /* pinning vs swapping `current` */
+    IngestVersion    *current;   /* newest published version */
+    atomic_long       published; /* current->snap.merged */
+    atomic_int        wanted;    /* a reader pinned a version since the last build */
+    atomic_int        version_error; /* the last build ran out of memory */
+};
+
+static void queue_init(IngestQueue *q) {
+    atomic_store_explicit(&q->stub.next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&q->head, &q->stub, memory_order_relaxed);
+    q->tail = &q->stub;
+}
+
+static void queue_push(IngestQueue *q, IngestNode *node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    IngestNode *prev = atomic_exchange_explicit(&q->head, node, memory_order_acq_rel);
+    // Between the exchange and this store the list is briefly cut at `prev`;
+    // the consumer sees that as "nothing more yet" and comes back later
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+// Next node in push order, or NULL if the queue is empty (or a push is
+// halfway done).
+static IngestNode* queue_pop(IngestQueue *q) {
+    IngestNode *tail = q->tail;
+    IngestNode *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (tail == &q->stub) {
+        if (!next) return NULL;
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) {
+        return NULL;
+    }
+    // `tail` is the last node: put the stub behind it so it can be handed out
+    queue_push(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+// Apply a drained batch. Small batches against a large log go through
+// entries_create (O(log n) each); large ones through the bulk path, which
+// rebuilds the order tree. Both give the same result.
+static int ingest_apply(Ingest *in, const EntryInput *batch, int n) {
+    pthread_rwlock_wrlock(&in->lock);
+    int result = C_ERR_OK;
+    if (n * INGEST_BULK_MIN < in->ec->size) {
+        for (int i = 0; i < n && result == C_ERR_OK; ++i) {
+            result = entries_create(in->ec, batch[i].room, batch[i].type, batch[i].value, batch[i].timestamp);
+        }
+    } else {
+        result = entries_bulk_create(in->ec, in->rc, batch, n);
+    }
+    pthread_rwlock_unlock(&in->lock);
+    return result;
+}
+
+static void version_release(IngestVersion *v) {
+    if (v && atomic_fetch_sub_explicit(&v->refs, 1, memory_order_acq_rel) == 1) {
+        free(v);
+    }
+}
+
+// A version of the log as it is now, with the array in the same block.
+// Merger thread (or before it starts) only.
+static IngestVersion* version_build(const EntryCollection *ec, long merged) {
+    IngestVersion *v = malloc(sizeof *v + (size_t)ec->size * sizeof *v->snap.entries);
+    if (!v) return NULL;
+    v->snap.entries = (const LogEntry **)(v + 1);
+    v->snap.size = ec->size;
+    v->snap.merged = merged;
+    atomic_init(&v->refs, 1);
+    BTreeIter it;
+    int i = 0;
+    btree_first(&ec->order, &it);
+    for (const LogEntry *e = entries_next(ec, &it); e; e = entries_next(ec, &it)) {
+        v->snap.entries[i++] = e;
+    }
+    return v;
+}
+
+// Publish a new version if a reader wants one and it is due. The old one
+// goes when its last reader lets go.
+static void version_publish(Ingest *in, int idle) {
+    if (!atomic_load(&in->wanted)) return;
+    long merged = atomic_load(&in->merged);
+    long behind = merged - atomic_load(&in->published);
+    if (behind == 0 || (!idle && behind * INGEST_VERSION_LAG < in->ec->size)) return;
+
+    IngestVersion *v = version_build(in->ec, merged);
+    if (!v) {
+        atomic_store(&in->version_error, 1);
+        return;
+    }
+    atomic_store(&in->wanted, 0);
+    atomic_store(&in->version_error, 0);
+    pthread_mutex_lock(&in->version_lock);
+    IngestVersion *old = in->current;
+    in->current = v;
+    atomic_store(&in->published, merged);
+    pthread_mutex_unlock(&in->version_lock);
+    version_release(old);
+}
+
+static int batch_grow(EntryInput **batch, int *capacity) {
+    int new_capacity = *capacity ? *capacity * 2 : SLAB_CHUNK;
+    EntryInput *grown = realloc(*batch, new_capacity * sizeof *grown);
+    if (!grown) return 0;
+    *batch = grown;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static void* ingest_merger(void *arg) {
+    Ingest *in = arg;
+    EntryInput *batch = NULL;
+    int capacity = 0;
+
+    for (;;) {
+        // Read `stop` before draining, so nothing pushed before ingest_stop
+        // set it can be missed by the final pass
+        int stopping = atomic_load(&in->stop);
+        int n = 0;
+        for (int q = 0; q < in->num_queues; ++q) {
+            // Grow before popping, so running out of memory leaves the rest queued
+            while (n < INGEST_MAX_BATCH && (n < capacity || batch_grow(&batch, &capacity))) {
+                IngestNode *node = queue_pop(&in->queues[q]);
+                if (!node) break;
+                batch[n++] = node->input;
+                free(node);
+            }
+        }
+
+        if (n > 0) {
+            int result = ingest_apply(in, batch, n);
+            if (result != C_ERR_OK && in->error == C_ERR_OK) {
+                in->error = result;
+            }
+            atomic_fetch_add(&in->merged, n);
+            version_publish(in, 0);
+        } else if (stopping && atomic_load(&in->merged) == atomic_load(&in->submitted)) {
+            break;
+        } else {
+            version_publish(in, 1);
+            struct timespec idle = { 0, INGEST_IDLE_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    free(batch);
+    return NULL;
+}
+
+/* ---- ingest_start ----------------------------------------------------------
+   Purpose: Start accepting readings from any number of threads for the rooms
+            currently in `rc`. Until ingest_stop, the collections belong to
+            the merger: read them only between ingest_read_begin/end, and do
+            not add rooms.
+   Params:
+     - rc (in/out): room collection (fixed while ingesting)
+     - ec (in/out): entry collection readings are merged into
+   Returns: the ingest handle, or NULL on bad input or when out of memory
+----------------------------------------------------------------------------- */
+Ingest* ingest_start(RoomCollection *rc, EntryCollection *ec) {
+    if (!rc || !ec) return NULL;
+
+    Ingest *in = calloc(1, sizeof *in);
+    if (!in) return NULL;
+    in->rc = rc;
+    in->ec = ec;
+    in->num_queues = rc->size;
+    in->queues = aligned_alloc(CACHE_LINE, (rc->size ? rc->size : 1) * sizeof *in->queues);
+    in->current = version_build(ec, 0);
+    if (!in->queues || !in->current || pthread_rwlock_init(&in->lock, NULL) != 0) {
+        free(in->current);
+        free(in->queues);
+        free(in);
+        return NULL;
+    }
+    if (pthread_mutex_init(&in->version_lock, NULL) != 0) {
+        pthread_rwlock_destroy(&in->lock);
+        free(in->current);
+        free(in->queues);
+        free(in);
+        return NULL;
+    }
+    for (int q = 0; q < in->num_queues; ++q) {
+        queue_init(&in->queues[q]);
+    }
+    atomic_init(&in->stop, 0);
+    atomic_init(&in->submitted, 0);
+    atomic_init(&in->merged, 0);
+    atomic_init(&in->published, 0);
+    atomic_init(&in->wanted, 0);
+    atomic_init(&in->version_error, 0);
+    in->error = C_ERR_OK;
+
+    if (pthread_create(&in->merger, NULL, ingest_merger, in) != 0) {
+        pthread_mutex_destroy(&in->version_lock);
+        pthread_rwlock_destroy(&in->lock);
+        free(in->current);
+        free(in->queues);
+        free(in);
+        return NULL;
+    }
+    return in;
+}
+
+/* ---- ingest_submit ---------------------------------------------------------
+   Purpose: Queue one reading for the merger. Safe to call from any thread
+            and never blocks on other producers or on readers.
+   Params:
+     - in (in/out): ingest handle
+     - room, type, value, timestamp (in): the entries_create arguments
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID (bad type, or a room
+            added after ingest_start), C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int ingest_submit(Ingest *in, Room *room, int type, ReadingValue value, int timestamp) {
+    if (!in || !room) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+    if (room->id < 0 || room->id >= in->num_queues) return C_ERR_INVALID;
+
+    IngestNode *node = malloc(sizeof *node);
+    if (!node) return C_ERR_NO_MEMORY;
+    node->input.room = room;
+    node->input.type = type;
+    node->input.value = value;
+    node->input.timestamp = timestamp;
+    atomic_fetch_add(&in->submitted, 1);
+    queue_push(&in->queues[room->id], node);
+    return C_ERR_OK;
+}
+
+/* ---- ingest_read_begin / ingest_read_end -----------------------------------
+   Purpose: Bracket reads of the collections while ingesting. In between, no
+            batch is being applied, so the entries, the order tree and the
+            room lists agree with each other.
+   Params:
+     - in (in/out): ingest handle
+----------------------------------------------------------------------------- */
+void ingest_read_begin(Ingest *in) {
+    pthread_rwlock_rdlock(&in->lock);
+}
+
+void ingest_read_end(Ingest *in) {
+    pthread_rwlock_unlock(&in->lock);
+}
+
+/* ---- ingest_snapshot / ingest_release -------------------------------------
+   Purpose: Pin the newest published version of the sorted log, in O(1) and
+            without waiting for a merge; release it when done. Merges go on
+            meanwhile and never change a pinned version. A version is at
+            most 1/INGEST_VERSION_LAG of the log behind while merges are
+            running and current once the merger is idle; after ingest_flush
+            it holds everything flushed. Versions may outlive ingest_stop,
+            but not entries_free of the collection.
+   Params:
+     - in (in/out): ingest handle
+     - snap (in): a pinned version (NULL is ignored)
+   Returns: ingest_snapshot: the version, or NULL if `in` is NULL
+----------------------------------------------------------------------------- */
+const EntrySnapshot* ingest_snapshot(Ingest *in) {
+    if (!in) return NULL;
+    pthread_mutex_lock(&in->version_lock);
+    IngestVersion *v = in->current;
+    atomic_fetch_add_explicit(&v->refs, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&in->version_lock);
+    atomic_store(&in->wanted, 1);
+    return &v->snap;
+}
+
+void ingest_release(const EntrySnapshot *snap) {
+    // The snapshot is the first member of its version
+    version_release((IngestVersion *)snap);
+}
+
+/* ---- ingest_flush ----------------------------------------------------------
+   Purpose: Wait until every reading submitted before the call is merged, and
+            is in the version ingest_snapshot hands out.
+   Params:
+     - in (in): ingest handle
+   Returns: the first merge error so far, C_ERR_NO_MEMORY if the version
+            could not be built, or C_ERR_OK
+----------------------------------------------------------------------------- */
+int ingest_flush(Ingest *in) {
+    if (!in) return C_ERR_NULL_PTR;
+    long target = atomic_load(&in->submitted);
+    while (atomic_load(&in->merged) < target) {
+        struct timespec idle = { 0, INGEST_IDLE_NS };
+        nanosleep(&idle, NULL);
+    }
+    atomic_store(&in->wanted, 1);
+    while (atomic_load(&in->published) < target && !atomic_load(&in->version_error)) {
+        struct timespec idle = { 0, INGEST_IDLE_NS };
+        nanosleep(&idle, NULL);
+    }
+    pthread_rwlock_rdlock(&in->lock); // orders the read of `error` after the merge
+    int result = in->error;
+    pthread_rwlock_unlock(&in->lock);
+    if (result == C_ERR_OK && atomic_load(&in->version_error)) {
+        result = C_ERR_NO_MEMORY;
+    }
+    return result;
+}
+
+/* ---- ingest_stop -----------------------------------------------------------
+   Purpose: Merge everything submitted so far, stop the merger and free the
+            handle. Producers must have stopped submitting.
+   Params:
+     - in (in): ingest handle (freed)
+   Returns: the first merge error, or C_ERR_OK
+----------------------------------------------------------------------------- */
+int ingest_stop(Ingest *in) {
+    if (!in) return C_ERR_NULL_PTR;
+    atomic_store(&in->stop, 1);
+    pthread_join(in->merger, NULL);
+
+    int result = in->error;
+    version_release(in->current);
+    pthread_mutex_destroy(&in->version_lock);
+    pthread_rwlock_destroy(&in->lock);
+    free(in->queues);
+    free(in);
+    return result;
+}
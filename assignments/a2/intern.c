@@ -0,0 +1,139 @@
+// intern.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Interned strings: every distinct string gets one canonical copy and a small
+   integer id (0, 1, 2, ... in the order they were added). Lookups go through
+   an open-addressing hash index with linear probing; the slot array is a power
+   of two in size and kept at most half full, so probe runs stay short. */
+
+#define INTERN_MIN_SLOTS 32
+
+// 32-bit FNV-1a
+static unsigned int intern_hash(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Slot holding `s` (hash `h`), or the empty slot where it would go.
+static int intern_probe(const InternTable *t, const char *s, unsigned int h) {
+    int mask = t->num_slots - 1;
+    int i = (int)(h & (unsigned int)mask);
+    while (t->slots[i] != 0) {
+        int id = t->slots[i] - 1;
+        // Compare hashes first so mismatches rarely touch the string itself
+        if (t->hashes[id] == h && strcmp(t->names[id], s) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Double the slot array and re-insert every id.
+static int intern_rehash(InternTable *t) {
+    int num_slots = t->num_slots ? t->num_slots * 2 : INTERN_MIN_SLOTS;
+    int *slots = calloc(num_slots, sizeof *slots);
+    if (!slots) return C_ERR_NO_MEMORY;
+
+    free(t->slots);
+    t->slots = slots;
+    t->num_slots = num_slots;
+    for (int id = 0; id < t->size; ++id) {
+        t->slots[intern_probe(t, t->names[id], t->hashes[id])] = id + 1;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- intern_lookup ---------------------------------------------------------
+   Purpose: Find the id of an interned string.
+   Params:
+     - t (in): intern table
+     - s (in): C-string to look up
+   Returns: the id, or -1 if `s` was never interned (or on NULL input)
+----------------------------------------------------------------------------- */
+int intern_lookup(const InternTable *t, const char *s) {
+    if (!t || !s || t->num_slots == 0) {
+        return -1;
+    }
+    return t->slots[intern_probe(t, s, intern_hash(s))] - 1;
+}
+
+/* ---- intern_add ------------------------------------------------------------
+   Purpose: Intern a string, copying it if it is new.
+   Params:
+     - t (in/out): intern table
+     - s (in): C-string to intern
+   Returns: the id of `s` (existing or new), C_ERR_NULL_PTR or C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int intern_add(InternTable *t, const char *s) {
+    if (!t || !s) {
+        return C_ERR_NULL_PTR;
+    }
+    if ((t->size + 1) * 2 > t->num_slots && intern_rehash(t) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+
+    unsigned int h = intern_hash(s);
+    int slot = intern_probe(t, s, h);
+    if (t->slots[slot] != 0) {
+        return t->slots[slot] - 1;
+    }
+
+    if (t->size == t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : INTERN_MIN_SLOTS;
+        char **names = realloc(t->names, capacity * sizeof *names);
+        if (!names) return C_ERR_NO_MEMORY;
+        t->names = names;
+        unsigned int *hashes = realloc(t->hashes, capacity * sizeof *hashes);
+        if (!hashes) return C_ERR_NO_MEMORY;
+        t->hashes = hashes;
+        t->capacity = capacity;
+    }
+
+    size_t len = strlen(s) + 1;
+    char *copy = malloc(len);
+    if (!copy) return C_ERR_NO_MEMORY;
+    memcpy(copy, s, len);
+
+    int id = t->size++;
+    t->names[id] = copy;
+    t->hashes[id] = h;
+    t->slots[slot] = id + 1;
+    return id;
+}
+
+/* ---- intern_name -----------------------------------------------------------
+   Purpose: Get the canonical copy of an interned string.
+   Params:
+     - t (in): intern table
+     - id (in): id returned by intern_add
+   Returns: the canonical string, or NULL if the id is out of range
+----------------------------------------------------------------------------- */
+const char* intern_name(const InternTable *t, int id) {
+    if (!t || id < 0 || id >= t->size) {
+        return NULL;
+    }
+    return t->names[id];
+}
+
+/* ---- intern_free -----------------------------------------------------------
+   Purpose: Release every string and index the table owns and reset it to empty.
+   Params:
+     - t (in/out): intern table
+----------------------------------------------------------------------------- */
+void intern_free(InternTable *t) {
+    if (!t) return;
+    for (int id = 0; id < t->size; ++id) {
+        free(t->names[id]);
+    }
+    free(t->names);
+    free(t->hashes);
+    free(t->slots);
+    memset(t, 0, sizeof *t);
+}
@@ -1,100 +1,542 @@
 // main.c
 
 #include "defs.h"
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 // Static declares that this function can only be found in this file and not during linking
 static void print_menu(int* choice);
 static void read_string(char* buffer, int size);
 
 // Forward declarations for menu handler functions
-static void handle_add_room(RoomCollection *rc);
-static void handle_add_entry(RoomCollection *rc, EntryCollection *ec);
-static void handle_print_entries(const EntryCollection *ec);
-static void handle_print_rooms(const RoomCollection *rc);
+static void handle_sample_load(RoomCollection *rc, EntryCollection *ec, PersistStore *store);
+static void handle_add_room(RoomCollection *rc, PersistStore *store);
+static void handle_add_entry(RoomCollection *rc, EntryCollection *ec, PersistStore *store);
+static void handle_print_entries(const EntryCollection *ec, const RoomCollection *rc);
+static void handle_print_rooms(const RoomCollection *rc, const EntryCollection *ec);
+static void handle_check(const EntryCollection *ec, RoomCollection *rc, int parts);
+static void handle_print_stats(const RoomCollection *rc, const EntryCollection *ec);
+static void handle_query_range(RoomCollection *rc, const EntryCollection *ec);
+static void print_range_query(const RoomCollection *rc, const EntryCollection *ec, const Room *room, int type, int t_from, int t_to);
+static void print_motion_zones(const RoomCollection *rc, const MotionStore *ms, const Room *room, int t_from, int t_to);
+static void handle_print_by_time(const EntryCollection *ec);
+static void print_time_scan(const EntryCollection *ec, int type, int t_from, int t_to);
+static int parse_index_kinds(const char *list);
+static int handle_batch(const char *path, RoomCollection *rc, EntryCollection *ec, PersistStore *store);
+static int handle_export(const char *path, const RoomCollection *rc, const EntryCollection *ec);
 
 
-int main(void) {
+int main(int argc, char *argv[]) {
   RoomCollection  rooms   = { .size = 0 };
   EntryCollection entries = { .size = 0 };
+  ColumnStore     columns = { 0 };
+  MotionStore     motion  = { 0 };
+  RollupStore     rollups = { 0 };
+  PersistStore    store_data;
+  PersistStore   *store = NULL; // Only with --store DIR
+  RetentionStore  retention;
+  SecondaryIndex  index;
   int choice = -1;
 
+  columns_attach(&columns, &entries); // Keep a per-type column copy for statistics
+  motion_attach(&motion, &entries);   // and motion readings as per-room zone bitsets
+  rollup_attach(&rollups, &entries, &rooms); // and minute/hour/day rollups for range queries
+
+  const char *store_dir = NULL;
+  const char *batch_path = NULL;
+  const char *export_path = NULL;
+  int retain_count = 0, retain_age = 0, index_kinds = 0;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 < argc && strcmp(argv[i], "--store") == 0) {
+      store_dir = argv[i + 1];
+    } else if (i + 1 < argc && strcmp(argv[i], "--batch") == 0) {
+      batch_path = argv[i + 1];
+    } else if (i + 1 < argc && strcmp(argv[i], "--export") == 0) {
+      export_path = argv[i + 1];
+    } else if (i + 1 < argc && strcmp(argv[i], "--retain") == 0) {
+      retain_count = atoi(argv[i + 1]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--retain-age") == 0) {
+      retain_age = atoi(argv[i + 1]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--index") == 0 && (index_kinds = parse_index_kinds(argv[i + 1]))) {
+      // type,time: which secondary indexes to keep
+    } else {
+      printf("Usage: %s [--store DIR] [--batch FILE] [--export FILE] [--retain COUNT] [--retain-age AGE] "
+             "[--index type|time|type,time]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // Retention mode: only the newest readings per room and type are kept
+  if (retain_count || retain_age) {
+    if (store_dir) {
+      printf("Error: --retain cannot be combined with --store.\n");
+      return 1;
+    }
+    if (retain_init(&retention, retain_count ? retain_count : RETAIN_DEFAULT_COUNT, retain_age) != C_ERR_OK) {
+      printf("Error: --retain takes 1 to %d readings, --retain-age a positive age.\n", RETAIN_MAX_COUNT);
+      return 1;
+    }
+    retain_attach(&retention, &entries);
+    printf("Retention: keeping the newest %d readings per room and type", retention.max_count);
+    if (retention.max_age > 0) {
+      printf(", at most %d older than the newest", retention.max_age);
+    }
+    printf(".\n");
+  }
+
+  // Secondary indexes, declared before anything is loaded
+  if (index_kinds) {
+    if (entries.retain) {
+      printf("Error: --index cannot be combined with --retain.\n");
+      return 1;
+    }
+    index_init(&index, index_kinds);
+    index_attach(&index, &entries);
+    printf("Indexes: %s%s%s.\n", index_kinds & INDEX_TYPE_TIME ? "(type, timestamp)" : "",
+           index_kinds == (INDEX_TYPE_TIME | INDEX_TIME) ? ", " : "", index_kinds & INDEX_TIME ? "(timestamp)" : "");
+  }
+
+  if (store_dir) {
+    int result = persist_open(&store_data, store_dir, &rooms, &entries);
+    if (result != C_ERR_OK) {
+      const char *reason = result == C_ERR_NO_MEMORY ? "out of memory"
+                           : result == C_ERR_IO      ? "I/O error"
+                                                     : "corrupt snapshot or log";
+      printf("Error: could not open store '%s' (%s).\n", store_dir, reason);
+      entries_free(&entries);
+      columns_free(&columns);
+      motion_free(&motion);
+      rollup_free(&rollups);
+      if (entries.index) {
+        index_free(&index);
+      }
+      rooms_free(&rooms);
+      return 1;
+    }
+    store = &store_data;
+    printf("Store '%s': %d rooms, %d entries (snapshot %u, %d log records replayed).\n",
+           store_dir, rooms.size, entries.size, (unsigned)store->generation, store->log_records);
+    if (store->dropped_bytes > 0) {
+      printf("Warning: dropped a corrupt log tail of %ld bytes.\n", store->dropped_bytes);
+    }
+  }
+
+  // A batch file replaces the menu: run it, save, and exit
+  int status = 0;
+  if (batch_path) {
+    status = handle_batch(batch_path, &rooms, &entries, store) == C_ERR_OK ? 0 : 1;
+    choice = 0;
+  }
+
+  // So does an export, after any batch has run
+  if (export_path) {
+    if (handle_export(export_path, &rooms, &entries) != C_ERR_OK) {
+      status = 1;
+    }
+    choice = 0;
+  }
+
   while (choice != 0) {
     print_menu(&choice);
     switch (choice) {
       case 1: // Load sample data
-        load_sample(&rooms, &entries);
-        printf("Sample data loaded.\n");
+        handle_sample_load(&rooms, &entries, store);
         break;
       case 2: // Print entries
-        handle_print_entries(&entries);
+        handle_print_entries(&entries, &rooms);
         break;
       case 3: // Print rooms
-        handle_print_rooms(&rooms);
+        handle_print_rooms(&rooms, &entries);
         break;
       case 4: // Add room
-        handle_add_room(&rooms);
+        handle_add_room(&rooms, store);
         break;
       case 5: // Add entry
-        handle_add_entry(&rooms, &entries);
+        handle_add_entry(&rooms, &entries, store);
         break;
       case 6: // Test order
-        loader_test_order(&entries, 1);
+        handle_check(&entries, &rooms, CHECK_ORDER);
         break;
       case 7: // Test room entries
-        loader_test_rooms(&entries, &rooms, 1);
+        handle_check(&entries, &rooms, CHECK_ROOMS);
+        break;
+      case 8: // Print statistics
+        handle_print_stats(&rooms, &entries);
+        break;
+      case 9: // Query time range
+        handle_query_range(&rooms, &entries);
+        break;
+      case 10: // Print entries by time
+        handle_print_by_time(&entries);
         break;
       case 0: // Exit
         break;
       default:
         printf("Invalid choice.\n");
     }
+
+    // Keep the log short so the next start has little to replay; on exit,
+    // fold in whatever is logged (nothing logged means nothing changed)
+    if (store && (store->log_records >= PERSIST_SNAPSHOT_EVERY || (choice == 0 && store->log_records > 0))) {
+      if (persist_snapshot(store, &rooms, &entries) != C_ERR_OK) {
+        printf("Warning: could not write a snapshot; the log still has every change.\n");
+      }
+    }
   }
 
-  printf("Exiting program.\n");
-  return 0;
+  if (store) {
+    if ((batch_path || export_path) && store->log_records > 0 &&
+        persist_snapshot(store, &rooms, &entries) != C_ERR_OK) {
+      printf("Warning: could not write a snapshot; the log still has every change.\n");
+    }
+    persist_close(store);
+  }
+  entries_free(&entries);
+  columns_free(&columns);
+  motion_free(&motion);
+  rollup_free(&rollups);
+  rooms_free(&rooms);
+  if (entries.index) {
+    index_free(&index);
+  }
+  if (entries.retain) {
+    retain_free(&retention);
+  }
+  if (!batch_path && !export_path) {
+    printf("Exiting program.\n");
+  }
+  return status;
 }
 
 // Handler for printing all log entries
-void handle_print_entries(const EntryCollection *ec) {
-    printf("\n--- All Log Entries (%d) ---\n", ec->size);
-    printf("-------------|------------|------------|------------------\n");
-    printf("Room         | Timestamp  | Type       | Value\n");
-    printf("-------------|------------|------------|------------------\n");
-    for (int i = 0; i < ec->size; ++i) {
-        entry_print(&ec->entries[i]);
+void handle_print_entries(const EntryCollection *ec, const RoomCollection *rc) {
+    ReportWriter w;
+    if (report_open(&w, stdout) != C_ERR_OK) {
+        printf("Error: out of memory.\n");
+        return;
+    }
+    if (ec->retain) {
+        report_retained(&w, ec->retain, rc, NULL);
+    } else {
+        report_entries(&w, ec, NULL, REPORT_TEXT);
     }
-    printf("-------------|------------|------------|------------------\n");
+    report_close(&w);
 }
 
 // Handler for printing all rooms and their entries
-void handle_print_rooms(const RoomCollection *rc) {
+void handle_print_rooms(const RoomCollection *rc, const EntryCollection *ec) {
     printf("\n--- Printing All Rooms ---\n");
+    ReportWriter w;
+    if (report_open(&w, stdout) != C_ERR_OK) {
+        printf("Error: out of memory.\n");
+        return;
+    }
+    for (int i = 0; i < rc->size; ++i) {
+        if (ec->retain) {
+            report_retained(&w, ec->retain, rc, rc->rooms[i]);
+        } else {
+            report_room(&w, rc->rooms[i]);
+        }
+    }
+    report_close(&w);
+}
+
+/* ---- handle_export ---------------------------------------------------------
+   Purpose: Write every entry to a file, in sorted order. The format follows
+            the file name: .csv gives CSV that --batch reads back, .bin the
+            binary export (exact values, see report.c), anything else the
+            table option 2 prints.
+   Params:
+     - path (in): file to write
+     - rc, ec (in): collections
+   Returns: C_ERR_OK, C_ERR_IO, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int handle_export(const char *path, const RoomCollection *rc, const EntryCollection *ec) {
+    const char *ext = strrchr(path, '.');
+    int format = REPORT_TEXT;
+    if (ext && strcmp(ext, ".csv") == 0) {
+        format = REPORT_CSV;
+    } else if (ext && strcmp(ext, ".bin") == 0) {
+        format = REPORT_BINARY;
+    }
+
+    FILE *out = fopen(path, format == REPORT_BINARY ? "wb" : "w");
+    if (!out) {
+        printf("Error: could not open '%s' for writing.\n", path);
+        return C_ERR_IO;
+    }
+    ReportWriter w;
+    int result = report_open(&w, out);
+    if (result == C_ERR_OK) {
+        result = report_entries(&w, ec, rc, format);
+        int closed = report_close(&w);
+        result = result == C_ERR_OK ? closed : result;
+    }
+    if (fclose(out) != 0 && result == C_ERR_OK) {
+        result = C_ERR_IO;
+    }
+    if (result != C_ERR_OK) {
+        printf("Error: could not write '%s' (%d).\n", path, result);
+        return result;
+    }
+    printf("Exported %d entries to '%s'.\n", ec->size, path);
+    return C_ERR_OK;
+}
+
+// Handler for the order and room tests: the loader's tests while the data
+// fits their 16-element layout, otherwise the O(n) checker in check.c
+void handle_check(const EntryCollection *ec, RoomCollection *rc, int parts) {
+    if (ec->retain) {
+        printf("%s Retention mode keeps no entry log to test.\n", parts == CHECK_ORDER ? "[ORDER]" : "[ROOMS]");
+        return;
+    }
+    int result = parts == CHECK_ORDER ? sample_test_order(ec, 1) : sample_test_rooms(ec, rc, 1);
+    if (result != C_ERR_FULL_ARRAY) {
+        return;
+    }
+
+    const char *tag = parts == CHECK_ORDER ? "[ORDER]" : "[ROOMS]";
+    CheckState st = { .has_run = 0 };
+    result = check_full(&st, ec, rc, parts);
+    if (result == C_ERR_OK) {
+        printf("%s Checked %d entries in %d rooms: OK.\n", tag, ec->size, rc->size);
+    } else if (result == C_ERR_INVALID) {
+        printf("%s %d problems found; first: %s.\n", tag, st.errors, st.first_error);
+    } else {
+        printf("Error: could not run the check (%d).\n", result);
+    }
+}
+
+// Handler for printing per-room TEMP and DB statistics from the column store
+void handle_print_stats(const RoomCollection *rc, const EntryCollection *ec) {
+    const int types[] = { TYPE_TEMP, TYPE_DB };
+    const char *names[] = { "TEMP", "DB" };
+
+    printf("\n--- Room Statistics ---\n");
+    if ((!ec->columns && !ec->retain) || rc->size == 0) {
+        printf("No statistics available.\n");
+        return;
+    }
+
+    // One pass over each type's column fills in every room at once (in
+    // retention mode, one pass over each room's ring)
+    ReadingStats *stats[2] = { NULL, NULL };
+    for (int t = 0; t < 2; ++t) {
+        stats[t] = malloc(rc->size * sizeof *stats[t]);
+        int result = stats[t] ? C_ERR_OK : C_ERR_NO_MEMORY;
+        if (result == C_ERR_OK && ec->retain) {
+            for (int i = 0; i < rc->size && result == C_ERR_OK; ++i) {
+                result = retain_range_stats(ec->retain, rc->rooms[i], types[t], INT_MIN, INT_MAX, &stats[t][i]);
+            }
+        } else if (result == C_ERR_OK) {
+            result = columns_stats_by_room(ec->columns, types[t], stats[t], rc->size);
+        }
+        if (result != C_ERR_OK) {
+            printf("Error: could not compute statistics.\n");
+            free(stats[0]);
+            free(stats[1]);
+            return;
+        }
+    }
+
+    printf("-------------|------------|--------|----------|----------|----------\n");
+    printf("Room         | Type       | Count  | Min      | Max      | Mean\n");
+    printf("-------------|------------|--------|----------|----------|----------\n");
+    for (int i = 0; i < rc->size; ++i) {
+        for (int t = 0; t < 2; ++t) {
+            const ReadingStats *st = &stats[t][i];
+            if (st->count > 0) {
+                printf("%-12s | %-10s | %-6d | %-8.2f | %-8.2f | %.2f\n", rc->rooms[i]->name, names[t],
+                       st->count, st->min, st->max, st->sum / st->count);
+            }
+        }
+    }
+    printf("-------------|------------|--------|----------|----------|----------\n");
+    free(stats[0]);
+    free(stats[1]);
+}
+
+// Handler for count/min/max/mean of one type over a timestamp range, for one
+// room or (room name "*") every room
+void handle_query_range(RoomCollection *rc, const EntryCollection *ec) {
+    char name_buffer[MAX_STR];
+    printf("Enter room name (* for all rooms): ");
+    read_string(name_buffer, MAX_STR);
+
+    Room *room = NULL;
+    if (strcmp(name_buffer, "*") != 0) {
+        room = rooms_find(rc, name_buffer);
+        if (!room) {
+            printf("Error: Room '%s' not found.\n", name_buffer);
+            return;
+        }
+    }
+
+    int type = 0, t_from = 0, t_to = 0;
+    printf("Enter entry type (1-TEMP, 2-DB, 3-MOTION): ");
+    scanf("%d", &type);
+    while (getchar() != '\n'); // Clear buffer
+    if (type < TYPE_TEMP || type > TYPE_MOTION) {
+        printf("Invalid type entered.\n");
+        return;
+    }
+
+    printf("Enter first and last timestamp (inclusive), e.g., 100 200: ");
+    scanf("%d %d", &t_from, &t_to);
+    while (getchar() != '\n'); // Clear buffer
+
+    print_range_query(rc, ec, room, type, t_from, t_to);
+}
+
+// Prints the range query table for one room, or every room when room is NULL
+void print_range_query(const RoomCollection *rc, const EntryCollection *ec, const Room *room, int type, int t_from, int t_to) {
+    printf("\n--- Range Query ---\n");
+    printf("-------------|--------|----------|----------|----------\n");
+    printf("Room         | Count  | Min      | Max      | Mean\n");
+    printf("-------------|--------|----------|----------|----------\n");
+    for (int i = 0; i < rc->size; ++i) {
+        if (room && rc->rooms[i] != room) {
+            continue;
+        }
+        ReadingStats st;
+        int result = ec->retain  ? retain_range_stats(ec->retain, rc->rooms[i], type, t_from, t_to, &st)
+                   : ec->rollups ? rollup_range_stats(ec->rollups, rc->rooms[i], type, t_from, t_to, &st)
+                                 : query_range_stats(rc->rooms[i], type, t_from, t_to, &st);
+        if (result == C_ERR_OK && st.count > 0) {
+            printf("%-12s | %-6d | %-8.2f | %-8.2f | %.2f\n", rc->rooms[i]->name,
+                   st.count, st.min, st.max, st.sum / st.count);
+        }
+    }
+    printf("-------------|--------|----------|----------|----------\n");
+    if (type == TYPE_MOTION && ec->motion && !ec->retain) {
+        print_motion_zones(rc, ec->motion, room, t_from, t_to);
+    }
+}
+
+// Handler for listing the entries of one type (or all) in a time window, in
+// timestamp order across every room
+void handle_print_by_time(const EntryCollection *ec) {
+    int type = -1, t_from = 0, t_to = 0;
+    printf("Enter entry type (0-ALL, 1-TEMP, 2-DB, 3-MOTION): ");
+    scanf("%d", &type);
+    while (getchar() != '\n'); // Clear buffer
+    if (type < 0 || type > TYPE_MOTION) {
+        printf("Invalid type entered.\n");
+        return;
+    }
+
+    printf("Enter first and last timestamp (inclusive), e.g., 100 200: ");
+    scanf("%d %d", &t_from, &t_to);
+    while (getchar() != '\n'); // Clear buffer
+
+    print_time_scan(ec, type, t_from, t_to);
+}
+
+// Prints the entries table for a time scan, and which plan served it
+void print_time_scan(const EntryCollection *ec, int type, int t_from, int t_to) {
+    static const char *PLAN_NAMES[] = { "the entry log (no index fits)", "the (type, timestamp) index",
+                                        "the timestamp index" };
+    if (ec->retain) {
+        printf("Retention mode keeps no entry log to scan.\n");
+        return;
+    }
+    EntryScan scan;
+    ReportWriter w;
+    long count = 0;
+    if (entries_scan_begin(&scan, ec, type, t_from, t_to) != C_ERR_OK) {
+        printf("Error: out of memory.\n");
+        return;
+    }
+    if (report_open(&w, stdout) != C_ERR_OK) {
+        entries_scan_end(&scan);
+        printf("Error: out of memory.\n");
+        return;
+    }
+    report_scan(&w, &scan, &count);
+    report_close(&w);
+    entries_scan_end(&scan);
+    printf("%ld entries, read from %s.\n", count, PLAN_NAMES[scan.plan]);
+}
+
+// Index kinds named in a --index argument ("type", "time" or both, comma
+// separated), or 0 if it names anything else
+int parse_index_kinds(const char *list) {
+    int kinds = 0;
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        if (len == 4 && strncmp(list, "type", 4) == 0) {
+            kinds |= INDEX_TYPE_TIME;
+        } else if (len == 4 && strncmp(list, "time", 4) == 0) {
+            kinds |= INDEX_TIME;
+        } else {
+            return 0;
+        }
+        list += len + (list[len] == ',');
+    }
+    return kinds;
+}
+
+// Prints, per room, how many motion readings in the window saw movement in
+// each zone, in any zone and in all three
+void print_motion_zones(const RoomCollection *rc, const MotionStore *ms, const Room *room, int t_from, int t_to) {
+    printf("\n--- Motion Zones ---\n");
+    printf("-------------|--------|--------|---------|--------|--------|--------\n");
+    printf("Room         | Count  | Left   | Forward | Right  | Any    | All\n");
+    printf("-------------|--------|--------|---------|--------|--------|--------\n");
     for (int i = 0; i < rc->size; ++i) {
-        room_print(&rc->rooms[i]);
+        if (room && rc->rooms[i] != room) {
+            continue;
+        }
+        MotionCounts mc;
+        if (motion_window(ms, rc->rooms[i], t_from, t_to, &mc) == C_ERR_OK && mc.readings > 0) {
+            printf("%-12s | %-6d | %-6d | %-7d | %-6d | %-6d | %d\n", rc->rooms[i]->name, mc.readings,
+                   mc.zones[0], mc.zones[1], mc.zones[2], mc.any_zone, mc.all_zones);
+        }
+    }
+    printf("-------------|--------|--------|---------|--------|--------|--------\n");
+}
+
+// Handler for loading the sample data. It replaces everything, so a store
+// takes it as a new snapshot rather than as log records.
+void handle_sample_load(RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    int result = sample_load(rc, ec);
+    if (result != C_ERR_OK) {
+        printf("Error: could not load sample data (%s).\n",
+               result == C_ERR_NO_MEMORY ? "out of memory" : "invalid sample data");
+        return;
+    }
+    printf("Sample data loaded.\n");
+    if (store && persist_snapshot(store, rc, ec) != C_ERR_OK) {
+        printf("Warning: could not write a snapshot; the sample data is not in the store.\n");
     }
 }
 
 // Handler for adding a new room
-void handle_add_room(RoomCollection *rc) {
+void handle_add_room(RoomCollection *rc, PersistStore *store) {
     char name_buffer[MAX_STR];
     printf("Enter room name: ");
     read_string(name_buffer, MAX_STR);
 
     int result = rooms_add(rc, name_buffer);
     if (result == C_ERR_OK) {
+        if (store && persist_log_room(store, name_buffer) != C_ERR_OK) {
+            printf("Warning: room was not written to the store.\n");
+        }
         printf("Room '%s' added successfully.\n", name_buffer);
     } else if (result == C_ERR_DUPLICATE) {
         printf("Error: Room '%s' already exists.\n", name_buffer);
     } else if (result == C_ERR_FULL_ARRAY) {
         printf("Error: Room collection is full.\n");
+    } else if (result == C_ERR_NO_MEMORY) {
+        printf("Error: Out of memory, cannot add room.\n");
     } else {
         printf("An unknown error occurred.\n");
     }
 }
 
 // Handler for adding a new log entry
-void handle_add_entry(RoomCollection *rc, EntryCollection *ec) {
+void handle_add_entry(RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
     char name_buffer[MAX_STR];
     printf("Enter room name for the new entry: ");
     read_string(name_buffer, MAX_STR);
@@ -139,20 +581,395 @@ void handle_add_entry(RoomCollection *rc, EntryCollection *ec) {
     
     int result = entries_create(ec, room, type, value, timestamp);
     if (result == C_ERR_OK) {
+        if (store && persist_log_entry(store, room, type, value, timestamp) != C_ERR_OK) {
+            printf("Warning: entry was not written to the store.\n");
+        }
         printf("Entry added successfully.\n");
     } else if (result == C_ERR_FULL_ARRAY) {
         printf("Error: A collection is full, cannot add entry.\n");
+    } else if (result == C_ERR_NO_MEMORY) {
+        printf("Error: Out of memory, cannot add entry.\n");
     } else {
         printf("An unknown error occurred while adding entry.\n");
     }
 }
 
 
+/* ---- Batch mode ------------------------------------------------------------
+   `--batch FILE` runs a file without the menu. The file is either
+     - the menu input itself: a choice per line, followed by the lines that
+       choice would prompt for, in prompt order (4: name; 5: room, type,
+       timestamp, value; 9: room or *, type, "from to"). As at the menu,
+       only the number at the start of a choice or numeric answer counts,
+       so "23.50" as a choice is 23 and "1 0 1" is 1; or
+     - CSV, recognised by a comma on the first line: room,type,timestamp,value
+       per line (motion as "1 0 1"), an optional "room,..." header and
+       '#' comments. Rooms are created when first named.
+   Consecutive entries are collected and inserted with one
+   entries_bulk_create call, which gives the same result as adding them one
+   by one. Prompts and success messages are not printed; errors name the
+   line and the rest of the file still runs.
+----------------------------------------------------------------------------- */
+
+// Entries parsed but not yet inserted, and running totals for the summary
+typedef struct {
+    EntryInput *pending;
+    int         size;
+    int         capacity;
+    int         commands;
+    int         rooms;
+    int         entries;
+    int         errors;
+} BatchState;
+
+static void batch_error(BatchState *bs, const BatchInput *in, const char *msg, BatchField f) {
+    printf("Error: line %d: %s '%.*s'.\n", in->line, msg, (int)f.len, f.s);
+    bs->errors++;
+}
+
+static int batch_push(BatchState *bs, Room *room, int type, ReadingValue value, int timestamp) {
+    if (bs->size == bs->capacity) {
+        int new_capacity = bs->capacity ? bs->capacity * 2 : SLAB_CHUNK;
+        EntryInput *grown = realloc(bs->pending, new_capacity * sizeof *grown);
+        if (!grown) return C_ERR_NO_MEMORY;
+        bs->pending = grown;
+        bs->capacity = new_capacity;
+    }
+    bs->pending[bs->size++] = (EntryInput){ room, type, value, timestamp };
+    return C_ERR_OK;
+}
+
+// Insert the pending entries. A large batch is saved with a snapshot rather
+// than one log record (and flush) per entry.
+static void batch_flush(BatchState *bs, RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    if (bs->size == 0) return;
+    int result = entries_bulk_create(ec, rc, bs->pending, bs->size);
+    if (result != C_ERR_OK) {
+        // The whole run is dropped, so each of its entries is an error
+        const char *reason = result == C_ERR_NO_MEMORY ? "out of memory"
+                             : result == C_ERR_INVALID ? "invalid type or room"
+                                                       : "missing room";
+        printf("Error: %d entries dropped (%s).\n", bs->size, reason);
+        bs->errors += bs->size;
+        bs->size = 0;
+        return;
+    }
+    bs->entries += bs->size;
+
+    int saved = C_ERR_OK;
+    if (store && store->log_records + bs->size >= PERSIST_SNAPSHOT_EVERY) {
+        saved = persist_snapshot(store, rc, ec);
+    } else if (store) {
+        for (int i = 0; i < bs->size && saved == C_ERR_OK; ++i) {
+            const EntryInput *e = &bs->pending[i];
+            saved = persist_log_entry(store, e->room, e->type, e->value, e->timestamp);
+        }
+    }
+    if (saved != C_ERR_OK) {
+        printf("Warning: entries were not written to the store.\n");
+    }
+    bs->size = 0;
+}
+
+// Copy a room name out of the input; names longer than the menu accepts are an error
+static int batch_name(BatchField f, char *buffer) {
+    if (f.len >= MAX_STR) return C_ERR_INVALID;
+    memcpy(buffer, f.s, f.len);
+    buffer[f.len] = '\0';
+    return C_ERR_OK;
+}
+
+static int batch_value(int type, BatchField f, ReadingValue *value) {
+    switch (type) {
+        case TYPE_TEMP:   return batch_float(f, &value->temperature);
+        case TYPE_DB:     return batch_int(f, &value->decibels);
+        case TYPE_MOTION: return batch_motion(f, value->motion);
+        default:          return C_ERR_INVALID;
+    }
+}
+
+// An answer to one of the menu's number prompts: like scanf("%d") or
+// scanf("%f") followed by clearing the line, only the leading number counts.
+static int batch_answer(BatchField f, int *out) {
+    return batch_leading_int(&f, out);
+}
+
+static int batch_answer_value(int type, BatchField f, ReadingValue *value) {
+    switch (type) {
+        case TYPE_TEMP:   return batch_leading_float(f, &value->temperature);
+        case TYPE_DB:     return batch_answer(f, &value->decibels);
+        case TYPE_MOTION: return batch_motion(f, value->motion);
+        default:          return C_ERR_INVALID;
+    }
+}
+
+// Two timestamps on one line, as scanf("%d %d") reads them
+static int batch_answer_range(BatchField f, int *t_from, int *t_to) {
+    if (batch_leading_int(&f, t_from) != C_ERR_OK) return C_ERR_INVALID;
+    return batch_leading_int(&f, t_to);
+}
+
+static int batch_add_room(BatchState *bs, RoomCollection *rc, PersistStore *store, const char *name) {
+    int result = rooms_add(rc, name);
+    if (result == C_ERR_OK) {
+        bs->rooms++;
+        if (store && persist_log_room(store, name) != C_ERR_OK) {
+            printf("Warning: room was not written to the store.\n");
+        }
+    }
+    return result;
+}
+
+// The next line a command needs; running out of input is an error.
+static int batch_line(BatchState *bs, BatchInput *in, BatchField *line) {
+    if (batch_next_line(in, line)) return 1;
+    printf("Error: line %d: unexpected end of input.\n", in->line);
+    bs->errors++;
+    return 0;
+}
+
+static void batch_csv(BatchState *bs, BatchInput *in, RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    char name[MAX_STR];
+    BatchField line, f_room, f_type, f_time, f_value, f_extra;
+    Room *room = NULL; // last room named, so runs of the same room skip the lookup
+    while (batch_next_line(in, &line)) {
+        BatchField rest = line;
+        if (batch_trim(line).len == 0 || line.s[0] == '#') continue;
+        if (!batch_split(&rest, ',', &f_room) || !batch_split(&rest, ',', &f_type) ||
+            !batch_split(&rest, ',', &f_time) || !batch_split(&rest, ',', &f_value) ||
+            batch_split(&rest, ',', &f_extra)) {
+            batch_error(bs, in, "expected room,type,timestamp,value, got", line);
+            continue;
+        }
+        if (in->line == 1 && f_room.len == 4 && memcmp(f_room.s, "room", 4) == 0) continue; // header
+
+        int type, timestamp;
+        ReadingValue value;
+        if (batch_int(f_type, &type) != C_ERR_OK || type < TYPE_TEMP || type > TYPE_MOTION) {
+            batch_error(bs, in, "invalid type", f_type);
+            continue;
+        }
+        if (batch_int(f_time, &timestamp) != C_ERR_OK) {
+            batch_error(bs, in, "invalid timestamp", f_time);
+            continue;
+        }
+        if (batch_value(type, f_value, &value) != C_ERR_OK) {
+            batch_error(bs, in, "invalid value", f_value);
+            continue;
+        }
+        if (!room || strlen(room->name) != f_room.len || memcmp(room->name, f_room.s, f_room.len) != 0) {
+            if (f_room.len == 0 || batch_name(f_room, name) != C_ERR_OK) {
+                batch_error(bs, in, "invalid room name", f_room);
+                continue;
+            }
+            room = rooms_find(rc, name);
+            if (!room && batch_add_room(bs, rc, store, name) == C_ERR_OK) {
+                room = rooms_find(rc, name);
+            }
+            if (!room) {
+                batch_error(bs, in, "could not add room", f_room);
+                continue;
+            }
+        }
+        bs->commands++;
+        if (batch_push(bs, room, type, value, timestamp) != C_ERR_OK) {
+            batch_flush(bs, rc, ec, store); // make room for the rest
+            if (batch_push(bs, room, type, value, timestamp) != C_ERR_OK) {
+                batch_error(bs, in, "out of memory at", line);
+            }
+        }
+    }
+    batch_flush(bs, rc, ec, store);
+}
+
+// One menu command (5: add entry) read from the following lines. Like the
+// menu, it stops reading at the first field that makes the command invalid.
+static void batch_entry(BatchState *bs, BatchInput *in, RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    char name[MAX_STR];
+    BatchField line;
+    if (!batch_line(bs, in, &line)) return;
+    Room *room = batch_name(line, name) == C_ERR_OK ? rooms_find(rc, name) : NULL;
+    if (!room) {
+        batch_error(bs, in, "room not found:", line);
+        return;
+    }
+
+    int type, timestamp;
+    ReadingValue value;
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer(line, &type) != C_ERR_OK || type < TYPE_TEMP || type > TYPE_MOTION) {
+        batch_error(bs, in, "invalid type", line);
+        type = 0; // the menu still reads the timestamp before rejecting the type
+    }
+    if (!batch_line(bs, in, &line)) return;
+    if (type == 0) return;
+    if (batch_answer(line, &timestamp) != C_ERR_OK) {
+        batch_error(bs, in, "invalid timestamp", line);
+        return;
+    }
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer_value(type, line, &value) != C_ERR_OK) {
+        batch_error(bs, in, "invalid value", line);
+        return;
+    }
+    if (batch_push(bs, room, type, value, timestamp) != C_ERR_OK) {
+        batch_flush(bs, rc, ec, store);
+        if (batch_push(bs, room, type, value, timestamp) != C_ERR_OK) {
+            batch_error(bs, in, "out of memory at", line);
+        }
+    }
+}
+
+// One menu command (9: query time range) read from the following lines
+static void batch_query(BatchState *bs, BatchInput *in, RoomCollection *rc, const EntryCollection *ec) {
+    char name[MAX_STR];
+    BatchField line;
+    if (!batch_line(bs, in, &line)) return;
+    Room *room = NULL;
+    if (!(line.len == 1 && line.s[0] == '*')) {
+        room = batch_name(line, name) == C_ERR_OK ? rooms_find(rc, name) : NULL;
+        if (!room) {
+            batch_error(bs, in, "room not found:", line);
+            return;
+        }
+    }
+
+    int type, t_from, t_to;
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer(line, &type) != C_ERR_OK || type < TYPE_TEMP || type > TYPE_MOTION) {
+        batch_error(bs, in, "invalid type", line);
+        return;
+    }
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer_range(line, &t_from, &t_to) != C_ERR_OK) {
+        batch_error(bs, in, "expected two timestamps, got", line);
+        return;
+    }
+    print_range_query(rc, ec, room, type, t_from, t_to);
+}
+
+// One menu command (10: print entries by time) read from the following lines
+static void batch_print_by_time(BatchState *bs, BatchInput *in, const EntryCollection *ec) {
+    BatchField line;
+    int type, t_from, t_to;
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer(line, &type) != C_ERR_OK || type < 0 || type > TYPE_MOTION) {
+        batch_error(bs, in, "invalid type", line);
+        return;
+    }
+    if (!batch_line(bs, in, &line)) return;
+    if (batch_answer_range(line, &t_from, &t_to) != C_ERR_OK) {
+        batch_error(bs, in, "expected two timestamps, got", line);
+        return;
+    }
+    print_time_scan(ec, type, t_from, t_to);
+}
+
+static void batch_commands(BatchState *bs, BatchInput *in, RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    char name[MAX_STR];
+    BatchField line;
+    int choice = -1, result;
+    while (choice != 0 && batch_next_line(in, &line)) {
+        if (batch_trim(line).len == 0) continue;
+        if (batch_answer(line, &choice) != C_ERR_OK || choice < 0 || choice > 10) {
+            batch_error(bs, in, "invalid choice", line);
+            choice = -1;
+            continue;
+        }
+        bs->commands++;
+        // Everything except adding rooms and entries looks at the entries
+        if (choice != 4 && choice != 5) {
+            batch_flush(bs, rc, ec, store);
+        }
+
+        switch (choice) {
+            case 1:
+                handle_sample_load(rc, ec, store);
+                break;
+            case 2:
+                handle_print_entries(ec, rc);
+                break;
+            case 3:
+                handle_print_rooms(rc, ec);
+                break;
+            case 4:
+                if (!batch_line(bs, in, &line)) break;
+                result = batch_name(line, name) == C_ERR_OK ? batch_add_room(bs, rc, store, name) : C_ERR_INVALID;
+                if (result == C_ERR_INVALID) {
+                    batch_error(bs, in, "room name too long", line);
+                } else if (result == C_ERR_DUPLICATE) {
+                    batch_error(bs, in, "room already exists:", line);
+                } else if (result != C_ERR_OK) {
+                    batch_error(bs, in, "could not add room", line);
+                }
+                break;
+            case 5:
+                batch_entry(bs, in, rc, ec, store);
+                break;
+            case 6:
+                handle_check(ec, rc, CHECK_ORDER);
+                break;
+            case 7:
+                handle_check(ec, rc, CHECK_ROOMS);
+                break;
+            case 8:
+                handle_print_stats(rc, ec);
+                break;
+            case 9:
+                batch_query(bs, in, rc, ec);
+                break;
+            case 10:
+                batch_print_by_time(bs, in, ec);
+                break;
+        }
+    }
+    batch_flush(bs, rc, ec, store);
+}
+
+/* ---- handle_batch ----------------------------------------------------------
+   Purpose: Run a batch file (see "Batch mode" above) and print a summary.
+   Params:
+     - path (in): batch file
+     - rc, ec (in/out): collections
+     - store (in/out): where additions are saved, or NULL
+   Returns: C_ERR_OK if every line was valid, C_ERR_INVALID if some were
+            reported and skipped, or the error opening the file
+----------------------------------------------------------------------------- */
+int handle_batch(const char *path, RoomCollection *rc, EntryCollection *ec, PersistStore *store) {
+    BatchInput in;
+    int result = batch_open(&in, path);
+    if (result != C_ERR_OK) {
+        printf("Error: could not read batch file '%s' (%d).\n", path, result);
+        return result;
+    }
+
+    // CSV if the first line has a comma; menu input never does
+    int csv = 0;
+    if (in.size > 0) {
+        const char *first_end = memchr(in.data, '\n', in.size);
+        csv = memchr(in.data, ',', first_end ? (size_t)(first_end - in.data) : in.size) != NULL;
+    }
+
+    BatchState bs = { .pending = NULL };
+    if (csv) {
+        batch_csv(&bs, &in, rc, ec, store);
+    } else {
+        batch_commands(&bs, &in, rc, ec, store);
+    }
+    printf("Batch '%s': %d %s, %d rooms and %d entries added, %d errors.\n", path, bs.commands,
+           csv ? "records" : "commands", bs.rooms, bs.entries, bs.errors);
+
+    free(bs.pending);
+    batch_close(&in);
+    return bs.errors ? C_ERR_INVALID : C_ERR_OK;
+}
+
+
 // Prints the main menu and gets user selection
 void print_menu(int* choice) {
   int c = -1;
   int rc = 0;
-  const int num_options = 7;
+  const int num_options = 10;
 
   printf("\nMAIN MENU\n");
   printf("  (1) Load sample data\n");
@@ -162,6 +979,9 @@ void print_menu(int* choice) {
   printf("  (5) Add entry\n");
   printf("  (6) Test order\n");
   printf("  (7) Test room entries\n");
+  printf("  (8) Print statistics\n");
+  printf("  (9) Query time range\n");
+  printf("  (10) Print entries by time\n");
   printf("  (0) Exit\n\n");
 
   do {
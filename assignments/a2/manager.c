@@ -1,27 +1,41 @@
 // manager.c
 
 #include "defs.h"
+#include <limits.h>
+#include <stdlib.h>
 
 /* ---- entry comparator -------------------------------------------
    Order: room name ASC, then type ASC by #define value, then timestamp ASC
    Returns <0 if a<b, >0 if a>b, 0 if equal.
 ----------------------------------------------------------------------------- */
 int entry_cmp(const LogEntry *a, const LogEntry *b) {
-    if (!a || !b || !a->room || !b->room) {
+    const Room *room_a = a ? entry_room(a) : NULL;
+    const Room *room_b = b ? entry_room(b) : NULL;
+    if (!room_a || !room_b) {
         return 0; // Cannot compare if data is invalid
     }
 
-    // 1. Compare by room name in ascending order
-    int room_cmp = strcmp(a->room->name, b->room->name);
-    if (room_cmp != 0) {
-        return room_cmp;
+    // Rooms added with rooms_add have a rank, and the packed keys order
+    // exactly like the steps below, so one compare is enough.
+    if (room_a->rank != 0 && room_b->rank != 0) {
+        uint64_t ka = entry_sort_key(a), kb = entry_sort_key(b);
+        return (ka > kb) - (ka < kb);
+    }
+
+    // 1. Compare by room name in ascending order. Names are interned, so the
+    //    same room means the same name and the string compare can be skipped.
+    if (room_a != room_b) {
+        int room_cmp = strcmp(room_a->name, room_b->name);
+        if (room_cmp != 0) {
+            return room_cmp;
+        }
     }
 
     // 2. If room names are the same, compare by type in ascending order
-    if (a->data.type < b->data.type) {
+    if (entry_type(a) < entry_type(b)) {
         return -1;
     }
-    if (a->data.type > b->data.type) {
+    if (entry_type(a) > entry_type(b)) {
         return 1;
     }
 
@@ -36,6 +50,39 @@ int entry_cmp(const LogEntry *a, const LogEntry *b) {
     return 0; // Entries are identical in sorting criteria
 }
 
+/* ---- entry_key -------------------------------------------------------------
+   Purpose: Pack the sort fields of an entry into one unsigned integer:
+            room rank, then type, then the timestamp with its sign bit
+            flipped (so negative timestamps still sort first).
+   Params:
+     - room (in): owning room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - timestamp (in): entry timestamp
+   Returns: the key; comparing keys of entries whose rooms were ranked in the
+            same rank epoch gives the same result as entry_cmp
+----------------------------------------------------------------------------- */
+uint64_t entry_key(const Room *room, int type, int timestamp) {
+    return ((uint64_t)room->rank << 34) |
+           ((uint64_t)(type & 3) << 32) |
+           ((uint32_t)timestamp ^ 0x80000000u);
+}
+
+// The packed key of an existing entry, from its room's current rank.
+uint64_t entry_sort_key(const LogEntry *e) {
+    return entry_key(entry_room(e), entry_type(e), e->timestamp);
+}
+
+// Recompute the order tree's keys if the rooms were re-ranked since they
+// were made. Re-ranking keeps the rooms' relative order, so the tree and the
+// room lists are still correct; only the key values change.
+static void entries_refresh_keys(EntryCollection *ec, int rank_epoch) {
+    if (ec->key_epoch == rank_epoch) {
+        return;
+    }
+    btree_rekey(&ec->order, ec);
+    ec->key_epoch = rank_epoch;
+}
+
 /* ---- rooms_find ------------------------------------------------------------
    Purpose: Find a room by name.
    Params:
@@ -48,41 +95,156 @@ Room* rooms_find(RoomCollection *rc, const char *room_name) {
         return NULL;
     }
 
-    for (int i = 0; i < rc->size; ++i) {
-        if (strcmp(rc->rooms[i].name, room_name) == 0) {
-            return &rc->rooms[i]; // Return pointer to the found room
+    // Room ids are the intern ids of their names, so this is one hash probe
+    int id = intern_lookup(&rc->names, room_name);
+    return id >= 0 ? rc->rooms[id] : NULL;
+}
+
+// Give a newly added room a rank between its neighbours in name order.
+// A room added after every other one gets a fixed step past the last rank, so
+// names added in sorted order do not halve the gap each time. When there is
+// no gap left, every room is re-ranked evenly and the rank epoch moves on,
+// which tells each EntryCollection to refresh its stored keys.
+static void rooms_rank(RoomCollection *rc, Room *room) {
+    int count = rc->size - 1; // rooms already in by_name
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(rc->rooms[rc->by_name[mid]]->name, room->name) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
 
-    return NULL; // Room not found
+    uint32_t prev = lo > 0 ? rc->rooms[rc->by_name[lo - 1]]->rank : 0;
+    uint32_t next = lo < count ? rc->rooms[rc->by_name[lo]]->rank : KEY_RANK_LIMIT;
+    memmove(&rc->by_name[lo + 1], &rc->by_name[lo], (count - lo) * sizeof *rc->by_name);
+    rc->by_name[lo] = room->id;
+
+    if (next - prev >= 2) {
+        room->rank = (next == KEY_RANK_LIMIT && next - prev > KEY_RANK_STEP)
+                     ? prev + KEY_RANK_STEP
+                     : prev + (next - prev) / 2;
+        room->rank_epoch = rc->rank_epoch;
+        return;
+    }
+
+    uint32_t spacing = KEY_RANK_LIMIT / (uint32_t)(rc->size + 1);
+    rc->rank_epoch++;
+    for (int i = 0; i < rc->size; ++i) {
+        Room *r = rc->rooms[rc->by_name[i]];
+        r->rank = (uint32_t)(i + 1) * spacing;
+        r->rank_epoch = rc->rank_epoch;
+    }
 }
 
 /* ---- rooms_add -------------------------------------------------------------
    Purpose: Add a room if it does not already exist.
    Params:
      - rc (in/out): room collection
-     - room_name (in): C-string room name
-   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_DUPLICATE, C_ERR_FULL_ARRAY
+     - room_name (in): C-string room name (truncated to MAX_STR - 1 characters)
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_DUPLICATE, C_ERR_NO_MEMORY
 ----------------------------------------------------------------------------- */
 int rooms_add(RoomCollection *rc, const char *room_name) {
     if (!rc || !room_name) {
         return C_ERR_NULL_PTR;
     }
-    if (rc->size >= MAX_ARR) {
-        return C_ERR_FULL_ARRAY;
-    }
-    if (rooms_find(rc, room_name) != NULL) {
+
+    char name[MAX_STR];
+    strncpy(name, room_name, MAX_STR - 1);
+    name[MAX_STR - 1] = '\0'; // Ensure null-termination
+    if (intern_lookup(&rc->names, name) >= 0) {
         return C_ERR_DUPLICATE;
     }
 
-    // Add the new room at the end of the array
-    Room* new_room = &rc->rooms[rc->size];
-    strncpy(new_room->name, room_name, MAX_STR - 1);
-    new_room->name[MAX_STR - 1] = '\0'; // Ensure null-termination
+    if (rc->size == rc->capacity) {
+        int capacity = rc->capacity ? rc->capacity * 2 : MAX_ARR;
+        Room **rooms = realloc(rc->rooms, capacity * sizeof *rooms);
+        if (!rooms) return C_ERR_NO_MEMORY;
+        rc->rooms = rooms;
+        int *by_name = realloc(rc->by_name, capacity * sizeof *by_name);
+        if (!by_name) return C_ERR_NO_MEMORY;
+        rc->by_name = by_name;
+        rc->capacity = capacity;
+    }
+
+    Room* new_room = malloc(sizeof *new_room);
+    if (!new_room) return C_ERR_NO_MEMORY;
+    int id = intern_add(&rc->names, name);
+    if (id < 0) {
+        free(new_room);
+        return C_ERR_NO_MEMORY;
+    }
+
+    // Add the new room at the end; its id is its index and its intern id
+    new_room->name = intern_name(&rc->names, id);
+    new_room->id = id;
+    new_room->entries = NULL; // Entry list is allocated on first insert
     new_room->size = 0; // Initialize room's entry count
+    new_room->capacity = 0;
+    new_room->prefix = NULL;
+    new_room->prefix_size = 0;
+    new_room->dirty_from = 0;
+    rc->rooms[rc->size++] = new_room;
 
-    rc->size++;
+    rooms_rank(rc, new_room);
+    return C_ERR_OK;
+}
 
+/* ---- entries_get / entries_next --------------------------------------------
+   Purpose: Resolve a slab handle to its entry, or step through the entries
+            in sorted order.
+   Params:
+     - ec (in): entry collection
+     - h (in): handle returned for the entry when it was created
+     - it (in/out): iterator over ec->order, started with btree_first or
+                    btree_seek
+   Returns: pointer to the entry, or NULL if out of range / past the last one
+----------------------------------------------------------------------------- */
+LogEntry* entries_get(const EntryCollection *ec, EntryHandle h) {
+    if (!ec || h < 0 || h >= ec->size) {
+        return NULL;
+    }
+    return &ec->chunks[h / SLAB_CHUNK][h % SLAB_CHUNK];
+}
+
+LogEntry* entries_next(const EntryCollection *ec, BTreeIter *it) {
+    KeyedHandle next;
+    if (!ec || !it || !btree_next(it, &next)) {
+        return NULL;
+    }
+    return entries_get(ec, next.handle);
+}
+
+// Make sure the slab can hold `needed` entries.
+// Chunks are only ever added, so existing entries keep their address.
+static int entries_reserve(EntryCollection *ec, int needed) {
+    while (needed > ec->num_chunks * SLAB_CHUNK) {
+        LogEntry **chunks = realloc(ec->chunks, (ec->num_chunks + 1) * sizeof *chunks);
+        if (!chunks) return C_ERR_NO_MEMORY;
+        ec->chunks = chunks;
+
+        LogEntry *chunk = malloc(SLAB_CHUNK * sizeof *chunk);
+        if (!chunk) return C_ERR_NO_MEMORY;
+        ec->chunks[ec->num_chunks++] = chunk;
+    }
+    return C_ERR_OK;
+}
+
+// Same for a room's list of entry pointers.
+static int room_reserve(Room *room, int needed) {
+    if (needed <= room->capacity) {
+        return C_ERR_OK;
+    }
+    int new_capacity = room->capacity ? room->capacity : MAX_ARR;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    LogEntry **entries = realloc(room->entries, new_capacity * sizeof *entries);
+    if (!entries) return C_ERR_NO_MEMORY;
+    room->entries = entries;
+    room->capacity = new_capacity;
     return C_ERR_OK;
 }
 
@@ -95,63 +257,363 @@ int rooms_add(RoomCollection *rc, const char *room_name) {
      - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
      - value (in): union payload for reading
      - timestamp (in): simple int timestamp
-   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_FULL_ARRAY, C_ERR_INVALID
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY, C_ERR_INVALID
 ----------------------------------------------------------------------------- */
 int entries_create(EntryCollection *ec, Room *room, int type, ReadingValue value, int timestamp) {
     if (!ec || !room) return C_ERR_NULL_PTR;
-    if (ec->size >= MAX_ARR || room->size >= MAX_ARR) return C_ERR_FULL_ARRAY;
     if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+    if (ec->retain) {
+        return retain_add(ec->retain, room, type, value, timestamp); // retention mode keeps no log
+    }
+    if (entries_reserve(ec, ec->size + 1) != C_ERR_OK ||
+        room_reserve(room, room->size + 1) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    if (ec->columns && columns_reserve(ec->columns, type, 1) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    if (ec->motion && type == TYPE_MOTION && motion_reserve(ec->motion, room, 1) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    if (ec->rollups && type != TYPE_MOTION && rollup_reserve(ec->rollups, room, 1) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+    if (ec->index && index_reserve(ec->index, type, 1) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+
+    // 1. Add the handle to the order tree, O(log n). It is the last step that
+    //    can fail, so a failure leaves the collection unchanged.
+    entries_refresh_keys(ec, room->rank_epoch);
+    EntryHandle handle = ec->size;
+    uint64_t key = entry_key(room, type, timestamp);
+    if (btree_insert(&ec->order, key, handle) != C_ERR_OK) {
+        return C_ERR_NO_MEMORY;
+    }
+
+    // 2. Construct the new entry in the next free slab slot; it never moves again
+    LogEntry* new_entry_ptr = &ec->chunks[handle / SLAB_CHUNK][handle % SLAB_CHUNK];
+    entry_set(new_entry_ptr, room, type, value, timestamp);
+    ec->size++;
+    if (ec->columns) {
+        columns_append(ec->columns, room->id, type, value, timestamp); // reserved above
+    }
+    if (ec->motion && type == TYPE_MOTION) {
+        motion_add(ec->motion, room, value, timestamp); // reserved above
+    }
+    if (ec->rollups) {
+        rollup_add(ec->rollups, room, type, value, timestamp); // reserved above
+    }
+    if (ec->index) {
+        index_add(ec->index, ec, handle); // reserved above
+    }
+
+    // 3. Binary search and shift in the owning room's pointer list
+    int lo = 0;
+    int hi = room->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (entry_cmp(new_entry_ptr, room->entries[mid]) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    memmove(&room->entries[lo + 1], &room->entries[lo], (room->size - lo) * sizeof *room->entries);
+    room->entries[lo] = new_entry_ptr;
+    room->size++;
+    room->prefix_size = 0; // prefix sums (if any) are stale now
+
+    return C_ERR_OK;
+}
 
-    // 1. Construct the new entry
-    LogEntry new_entry;
-    new_entry.room = room;
-    new_entry.data.type = type;
-    new_entry.data.value = value;
-    new_entry.timestamp = timestamp;
-
-    // 2. Find insertion position in the global EntryCollection
-    int insert_pos = 0;
-    while (insert_pos < ec->size && entry_cmp(&new_entry, &ec->entries[insert_pos]) > 0) {
-        insert_pos++;
-    }
-
-    // 3. Shift existing entries to make space
-    for (int i = ec->size; i > insert_pos; --i) {
-        ec->entries[i] = ec->entries[i-1];
-        // IMPORTANT: Update pointers in the associated room after shifting.
-        // The room's entry pointer must now point to the new location.
-        Room* moved_entry_room = ec->entries[i].room;
-        for (int j = 0; j < moved_entry_room->size; ++j) {
-            if (moved_entry_room->entries[j] == &ec->entries[i-1]) {
-                moved_entry_room->entries[j] = &ec->entries[i];
-                break;
+/* ---- keyed_radix_sort ------------------------------------------------------
+   Purpose: LSD radix sort on the 64-bit key, one byte per pass. Passes where
+            every key has the same byte (e.g. the type bits, or high rank
+            bits with few rooms) are skipped. Stable, so equal keys keep
+            their input order. The counts (8 KB) live on the stack, so
+            readers sharing the read lock can sort at the same time.
+   Params:
+     - items (in/out): n pairs to sort, n >= 1
+     - tmp (in/out): scratch space for n pairs
+     - n (in): number of pairs
+----------------------------------------------------------------------------- */
+void keyed_radix_sort(KeyedHandle *items, KeyedHandle *tmp, int n) {
+    int counts[8][256] = { { 0 } };
+    for (int i = 0; i < n; ++i) {
+        for (int pass = 0; pass < 8; ++pass) {
+            counts[pass][(items[i].key >> (8 * pass)) & 0xff]++;
+        }
+    }
+
+    KeyedHandle *src = items, *dst = tmp;
+    for (int pass = 0; pass < 8; ++pass) {
+        int *count = counts[pass];
+        if (count[(src[0].key >> (8 * pass)) & 0xff] == n) {
+            continue;
+        }
+        int offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            int c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; ++i) {
+            dst[count[(src[i].key >> (8 * pass)) & 0xff]++] = src[i];
+        }
+        KeyedHandle *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != items) {
+        memcpy(items, src, n * sizeof *items);
+    }
+}
+
+/* ---- entries_bulk_create ---------------------------------------------------
+   Purpose: Create many log entries at once. The batch is radix sorted once
+            on the packed key and merged with the existing order, the order
+            tree is rebuilt bottom-up, and every room's entry list is rebuilt
+            in a single pass, instead of one sorted insert per entry.
+            The result is the same as calling entries_create for each input
+            in turn. Nothing is created unless the whole batch is valid.
+   Params:
+     - ec (in/out): entry collection (owns LogEntry storage)
+     - rc (in/out): room collection every input's room belongs to
+     - batch (in): entries to create
+     - n (in): number of entries in batch
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY,
+            C_ERR_INVALID (bad type, or a room that is not in rc)
+----------------------------------------------------------------------------- */
+int entries_bulk_create(EntryCollection *ec, RoomCollection *rc, const EntryInput *batch, size_t n) {
+    if (!ec || !rc || (!batch && n > 0)) return C_ERR_NULL_PTR;
+    if (n == 0) return C_ERR_OK;
+    if (n > (size_t)(INT_MAX - ec->size)) return C_ERR_NO_MEMORY;
+
+    // 1. Validate everything up front so a bad input leaves no partial batch
+    for (size_t i = 0; i < n; ++i) {
+        const Room *room = batch[i].room;
+        if (!room) return C_ERR_NULL_PTR;
+        if (room->id < 0 || room->id >= rc->size || rc->rooms[room->id] != room) return C_ERR_INVALID;
+        if (batch[i].type < TYPE_TEMP || batch[i].type > TYPE_MOTION) return C_ERR_INVALID;
+    }
+
+    // In retention mode the readings go to the rings, whose memory is
+    // reserved first for the same all-or-nothing result
+    if (ec->retain) {
+        for (size_t i = 0; i < n; ++i) {
+            int result = retain_reserve(ec->retain, batch[i].room, batch[i].type);
+            if (result != C_ERR_OK) return result;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            retain_add(ec->retain, batch[i].room, batch[i].type, batch[i].value, batch[i].timestamp);
+        }
+        return C_ERR_OK;
+    }
+
+    // 2. Reserve all memory before changing anything
+    int old_size = ec->size;
+    int new_size = old_size + (int)n;
+    KeyedHandle *merged = malloc(new_size * sizeof *merged);
+    KeyedHandle *sorted = malloc(2 * n * sizeof *sorted);
+    int *counts = calloc(rc->size, sizeof *counts);
+    int *motion_counts = ec->motion ? calloc(rc->size, sizeof *motion_counts) : NULL;
+    int type_counts[TYPE_MOTION + 1] = { 0 };
+    int result = (merged && sorted && counts && (motion_counts || !ec->motion))
+                 ? entries_reserve(ec, new_size) : C_ERR_NO_MEMORY;
+    for (size_t i = 0; result == C_ERR_OK && i < n; ++i) {
+        counts[batch[i].room->id]++;
+        type_counts[batch[i].type]++;
+        if (motion_counts && batch[i].type == TYPE_MOTION) {
+            motion_counts[batch[i].room->id]++;
+        }
+    }
+    for (int r = 0; result == C_ERR_OK && r < rc->size; ++r) {
+        result = room_reserve(rc->rooms[r], rc->rooms[r]->size + counts[r]);
+    }
+    for (int type = TYPE_TEMP; ec->columns && result == C_ERR_OK && type <= TYPE_MOTION; ++type) {
+        result = columns_reserve(ec->columns, type, type_counts[type]);
+    }
+    for (int r = 0; motion_counts && result == C_ERR_OK && r < rc->size; ++r) {
+        if (motion_counts[r] > 0) {
+            result = motion_reserve(ec->motion, rc->rooms[r], motion_counts[r]);
+        }
+    }
+    for (int r = 0; ec->rollups && result == C_ERR_OK && r < rc->size; ++r) {
+        if (counts[r] > 0) {
+            result = rollup_reserve(ec->rollups, rc->rooms[r], 0);
+        }
+    }
+
+    // 3. Key the batch and sort it once. The sort list is filled back to
+    //    front so that, after a stable sort, equal keys come latest-input
+    //    first, which is where one-at-a-time inserts would have put them.
+    if (result == C_ERR_OK) {
+        entries_refresh_keys(ec, rc->rank_epoch);
+        for (size_t i = 0; i < n; ++i) {
+            sorted[n - 1 - i].key = entry_key(batch[i].room, batch[i].type, batch[i].timestamp);
+            sorted[n - 1 - i].handle = old_size + (int)i;
+        }
+        keyed_radix_sort(sorted, sorted + n, (int)n);
+    }
+
+    // 4. Merge with an in-order walk of the current tree (on ties the new
+    //    entry goes first, as entries_create would place it) and build the
+    //    new tree bottom-up. This is the last allocation.
+    BTree order = { .size = 0 };
+    if (result == C_ERR_OK) {
+        BTreeIter it;
+        KeyedHandle cur;
+        int has_cur, j = 0, k = 0;
+        btree_first(&ec->order, &it);
+        has_cur = btree_next(&it, &cur);
+        while (has_cur && j < (int)n) {
+            if (sorted[j].key <= cur.key) {
+                merged[k++] = sorted[j++];
+            } else {
+                merged[k++] = cur;
+                has_cur = btree_next(&it, &cur);
             }
         }
+        while (has_cur) {
+            merged[k++] = cur;
+            has_cur = btree_next(&it, &cur);
+        }
+        while (j < (int)n) merged[k++] = sorted[j++];
+        result = btree_build(&order, merged, new_size);
+    }
+    free(sorted);
+    if (result != C_ERR_OK) {
+        free(merged);
+        free(counts);
+        free(motion_counts);
+        return C_ERR_NO_MEMORY;
     }
 
-    // 4. Insert the new entry into the global collection
-    ec->entries[insert_pos] = new_entry;
-    LogEntry* new_entry_ptr = &ec->entries[insert_pos]; // Get a pointer to the newly stored entry
-    ec->size++;
-    
-    // 5. Find insertion position for the pointer in the room's entry list
-    int room_insert_pos = 0;
-    while(room_insert_pos < room->size && entry_cmp(new_entry_ptr, room->entries[room_insert_pos]) > 0) {
-        room_insert_pos++;
+    // 5. Nothing can fail from here: append the batch to the slab and swap in
+    //    the new tree
+    for (size_t i = 0; i < n; ++i) {
+        EntryHandle handle = old_size + (int)i;
+        LogEntry *e = &ec->chunks[handle / SLAB_CHUNK][handle % SLAB_CHUNK];
+        entry_set(e, batch[i].room, batch[i].type, batch[i].value, batch[i].timestamp);
+        if (ec->columns) {
+            columns_append(ec->columns, batch[i].room->id, batch[i].type, batch[i].value, batch[i].timestamp);
+        }
     }
+    ec->size = new_size;
+    btree_free(&ec->order);
+    ec->order = order;
 
-    // 6. Shift pointers in the room to make space
-    for (int i = room->size; i > room_insert_pos; --i) {
-        room->entries[i] = room->entries[i-1];
+    // 6. Rebuild room lists in one pass: each room's entries appear in the
+    //    global order already sorted, so appending keeps them sorted.
+    for (int r = 0; r < rc->size; ++r) {
+        rc->rooms[r]->size = 0;
+        rc->rooms[r]->prefix_size = 0; // prefix sums are stale now
+        rc->rooms[r]->dirty_from = 0; // rewritten (see check_incremental)
+    }
+    for (int pos = 0; pos < new_size; ++pos) {
+        LogEntry *e = entries_get(ec, merged[pos].handle);
+        Room *room = entry_room(e);
+        room->entries[room->size++] = e;
     }
+    free(merged);
 
-    // 7. Insert the new pointer into the room's list
-    room->entries[room_insert_pos] = new_entry_ptr;
-    room->size++;
+    // 7. Motion rows of the rooms that got motion readings, from their new lists
+    for (int r = 0; motion_counts && r < rc->size; ++r) {
+        if (motion_counts[r] > 0) {
+            motion_rebuild_room(ec->motion, rc->rooms[r]);
+        }
+    }
+    free(motion_counts);
+
+    // 8. Rollups of the rooms that got readings, re-summed from their lists
+    //    (a series that cannot grow goes stale rather than failing the batch)
+    for (int r = 0; ec->rollups && r < rc->size; ++r) {
+        if (counts[r] > 0) {
+            rollup_rebuild_room(ec->rollups, rc->rooms[r]);
+        }
+    }
+    free(counts);
+
+    // 9. Secondary indexes: one sort of the batch by timestamp, merged into
+    //    each (one that cannot grow is dropped, and scans skip it)
+    if (ec->index) {
+        index_add_batch(ec->index, ec, old_size, (int)n);
+    }
 
     return C_ERR_OK;
 }
 
+/* ---- entries_memory --------------------------------------------------------
+   Purpose: Report the memory held for the entries, split by structure.
+   Params:
+     - ec (in): entry collection
+     - rc (in): room collection the entries belong to (for the room lists)
+     - out (out): bytes per structure, by capacity
+----------------------------------------------------------------------------- */
+void entries_memory(const EntryCollection *ec, const RoomCollection *rc, MemoryUsage *out) {
+    if (!out) return;
+    memset(out, 0, sizeof *out);
+    if (ec) {
+        out->slab = (size_t)ec->num_chunks * (SLAB_CHUNK * sizeof(LogEntry) + sizeof *ec->chunks);
+        out->order = btree_bytes(&ec->order);
+        out->columns = columns_bytes(ec->columns);
+        out->motion = motion_bytes(ec->motion);
+        out->rollups = rollup_bytes(ec->rollups);
+        out->index = index_bytes(ec->index);
+    }
+    for (int i = 0; rc && i < rc->size; ++i) {
+        const Room *r = rc->rooms[i];
+        out->room_lists += (size_t)r->capacity * sizeof *r->entries;
+    }
+}
+
+/* ---- entries_free / rooms_free ---------------------------------------------
+   Purpose: Release the memory owned by a collection and reset it to empty.
+            Stores attached to an entry collection are emptied too, but stay
+            attached.
+   Params:
+     - ec / rc (in/out): collection to clear
+----------------------------------------------------------------------------- */
+void entries_free(EntryCollection *ec) {
+    if (!ec) return;
+    for (int i = 0; i < ec->num_chunks; ++i) {
+        free(ec->chunks[i]);
+    }
+    free(ec->chunks);
+    btree_free(&ec->order);
+
+    ColumnStore *columns = ec->columns;
+    MotionStore *motion = ec->motion;
+    RollupStore *rollups = ec->rollups;
+    SecondaryIndex *index = ec->index;
+    RetentionStore *retain = ec->retain;
+    columns_free(columns);
+    motion_free(motion);
+    rollup_free(rollups);
+    index_free(index);
+    retain_free(retain);
+    memset(ec, 0, sizeof *ec);
+    ec->columns = columns;
+    ec->motion = motion;
+    ec->rollups = rollups;
+    ec->index = index;
+    ec->retain = retain;
+}
+
+void rooms_free(RoomCollection *rc) {
+    if (!rc) return;
+    for (int i = 0; i < rc->size; ++i) {
+        free(rc->rooms[i]->entries);
+        free(rc->rooms[i]->prefix);
+        free(rc->rooms[i]);
+    }
+    free(rc->rooms);
+    free(rc->by_name);
+    intern_free(&rc->names);
+    memset(rc, 0, sizeof *rc);
+}
+
 /* ---- entry_print -----------------------------------------------------------
    Purpose: Print one entry in a formatted row.
    Params:
@@ -160,25 +622,11 @@ int entries_create(EntryCollection *ec, Room *room, int type, ReadingValue value
 ----------------------------------------------------------------------------- */
 int entry_print(const LogEntry *e) {
     if (!e) return C_ERR_NULL_PTR;
-    if (!e->room) return C_ERR_INVALID;
-
-    // Print common data: Room and Timestamp, left-aligned
-    printf("%-12s | %-10d | ", e->room->name, e->timestamp);
-
-    // Print type-specific data
-    switch (e->data.type) {
-        case TYPE_TEMP:
-            printf("%-10s | %.2f°C\n", "TEMP", e->data.value.temperature);
-            break;
-        case TYPE_DB:
-            printf("%-10s | %d dB\n", "DB", e->data.value.decibels);
-            break;
-        case TYPE_MOTION:
-            printf("%-10s | [%d,%d,%d]\n", "MOTION", e->data.value.motion[0], e->data.value.motion[1], e->data.value.motion[2]);
-            break;
-        default:
-            printf("UNKNOWN TYPE\n");
-    }
+    if (!entry_room(e)) return C_ERR_INVALID;
+
+    // One formatted row, one stdio call (see report.c)
+    char row[REPORT_ROW_MAX];
+    fwrite(row, 1, report_entry_row(row, e), stdout);
     return C_ERR_OK;
 }
 
@@ -193,18 +641,11 @@ int room_print(const Room *r) {
         return C_ERR_NULL_PTR;
     }
 
-    printf("\n--- Room: %s (Entries: %d) ---\n", r->name, r->size);
-    if (r->size > 0) {
-       printf("-------------|------------|------------|------------------\n");
-       printf("Room         | Timestamp  | Type       | Value\n");
-       printf("-------------|------------|------------|------------------\n");
-       for (int i = 0; i < r->size; ++i) {
-           entry_print(r->entries[i]);
-       }
-       printf("-------------|------------|------------|------------------\n");
-    } else {
-        printf("No entries for this room.\n");
+    ReportWriter w;
+    int result = report_open(&w, stdout);
+    if (result != C_ERR_OK) {
+        return result;
     }
-
-    return C_ERR_OK;
+    report_room(&w, r);
+    return report_close(&w);
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+// motion.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Motion readings as bit columns. Each room keeps its motion readings'
+   timestamps sorted, and per zone a bitset aligned with them: bit i of
+   zones[z] is reading i's movement in zone z. A window [t_from, t_to] is
+   one run of positions [lo, hi), found with two binary searches, and every
+   question about it reads 64 readings per word:
+     - any:   OR of the words, stop at the first non-zero one;
+     - all:   AND of the words, stop at the first one with a clear bit;
+     - count: popcount of the words (and of their OR / AND across zones).
+   Readings arrive mostly in timestamp order, so an insert is usually an
+   append; a late one shifts the timestamps and the bits above it by one. */
+
+#define WORD_BITS 64
+
+static const int ZONE_BITS[MOTION_ZONES] = { MOTION_LEFT, MOTION_FORWARD, MOTION_RIGHT };
+
+static MotionRow* motion_row(const MotionStore *ms, const Room *room) {
+    if (room->id < 0 || room->id >= ms->num_rooms) return NULL;
+    return &ms->rows[room->id];
+}
+
+// First position whose timestamp is greater than `timestamp`
+static int row_upper_bound(const MotionRow *row, long long timestamp) {
+    int lo = 0, hi = row->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (row->timestamps[mid] <= timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Positions [*lo, *hi) of the readings with t_from <= timestamp <= t_to
+static void row_window(const MotionRow *row, int t_from, int t_to, int *lo, int *hi) {
+    *lo = row_upper_bound(row, (long long)t_from - 1);
+    *hi = row_upper_bound(row, t_to);
+    if (*hi < *lo) {
+        *hi = *lo;
+    }
+}
+
+// Bits of word w that fall inside [lo, hi)
+static uint64_t window_mask(int w, int lo, int hi) {
+    uint64_t mask = ~0ULL;
+    if (w == lo / WORD_BITS) mask &= ~0ULL << (lo % WORD_BITS);
+    if (w == (hi - 1) / WORD_BITS) mask &= ~0ULL >> (WORD_BITS - 1 - (hi - 1) % WORD_BITS);
+    return mask;
+}
+
+// Insert `bit` at position pos of a bitset holding `size` bits, moving the
+// bits at pos and above up by one
+static void bits_insert(uint64_t *words, int size, int pos, int bit) {
+    int w = pos / WORD_BITS;
+    for (int k = size / WORD_BITS; k > w; --k) {
+        words[k] = (words[k] << 1) | (words[k - 1] >> (WORD_BITS - 1));
+    }
+    uint64_t below = (1ULL << (pos % WORD_BITS)) - 1;
+    words[w] = (words[w] & below) | ((words[w] & ~below) << 1) | ((uint64_t)bit << (pos % WORD_BITS));
+}
+
+/* ---- motion_reserve --------------------------------------------------------
+   Purpose: Make room for `extra` more motion readings of a room, so that
+            motion_add (or motion_rebuild_room) for them cannot fail.
+   Params:
+     - ms (in/out): motion store
+     - room (in): room
+     - extra (in): readings about to be added
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int motion_reserve(MotionStore *ms, const Room *room, int extra) {
+    if (!ms || !room) return C_ERR_NULL_PTR;
+    if (room->id < 0 || extra < 0) return C_ERR_INVALID;
+
+    if (room->id >= ms->num_rooms) {
+        int num_rooms = ms->num_rooms ? ms->num_rooms : MAX_ARR;
+        while (num_rooms <= room->id) num_rooms *= 2;
+        MotionRow *rows = realloc(ms->rows, (size_t)num_rooms * sizeof *rows);
+        if (!rows) return C_ERR_NO_MEMORY;
+        memset(rows + ms->num_rooms, 0, (size_t)(num_rooms - ms->num_rooms) * sizeof *rows);
+        ms->rows = rows;
+        ms->num_rooms = num_rooms;
+    }
+
+    MotionRow *row = motion_row(ms, room);
+    int needed = row->size + extra;
+    if (needed <= row->capacity) {
+        return C_ERR_OK;
+    }
+    int capacity = row->capacity ? row->capacity : WORD_BITS;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    int *timestamps = realloc(row->timestamps, (size_t)capacity * sizeof *timestamps);
+    if (!timestamps) return C_ERR_NO_MEMORY;
+    row->timestamps = timestamps;
+    for (int z = 0; z < MOTION_ZONES; ++z) {
+        uint64_t *words = realloc(row->zones[z], (size_t)capacity / WORD_BITS * sizeof *words);
+        if (!words) return C_ERR_NO_MEMORY;
+        memset(words + row->capacity / WORD_BITS, 0, (size_t)(capacity - row->capacity) / WORD_BITS * sizeof *words);
+        row->zones[z] = words;
+    }
+    row->capacity = capacity;
+    return C_ERR_OK;
+}
+
+/* ---- motion_add ------------------------------------------------------------
+   Purpose: Add one motion reading of a room. O(1) when it is the room's
+            newest, otherwise O(k) for the k readings after it.
+   Params:
+     - ms (in/out): motion store
+     - room (in): room of the reading
+     - value (in): reading payload (motion[3])
+     - timestamp (in): reading timestamp
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int motion_add(MotionStore *ms, const Room *room, ReadingValue value, int timestamp) {
+    int result = motion_reserve(ms, room, 1);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    MotionRow *row = motion_row(ms, room);
+    int pos = row_upper_bound(row, timestamp);
+    memmove(row->timestamps + pos + 1, row->timestamps + pos, (size_t)(row->size - pos) * sizeof *row->timestamps);
+    row->timestamps[pos] = timestamp;
+    for (int z = 0; z < MOTION_ZONES; ++z) {
+        bits_insert(row->zones[z], row->size, pos, value.motion[z] != 0);
+    }
+    row->size++;
+    ms->size++;
+    return C_ERR_OK;
+}
+
+/* ---- motion_rebuild_room ---------------------------------------------------
+   Purpose: Refill a room's row from its (sorted) entry list, after a bulk
+            insert rewrote it. The row must have been reserved for every
+            motion entry in the list.
+   Params:
+     - ms (in/out): motion store
+     - room (in): room
+----------------------------------------------------------------------------- */
+void motion_rebuild_room(MotionStore *ms, const Room *room) {
+    if (!ms || !room) return;
+    MotionRow *row = motion_row(ms, room);
+    if (!row) return;
+
+    ms->size -= row->size;
+    row->size = 0;
+    for (int z = 0; z < MOTION_ZONES; ++z) {
+        memset(row->zones[z], 0, (size_t)row->capacity / WORD_BITS * sizeof *row->zones[z]);
+    }
+    // Motion entries are the tail of the list, already in timestamp order
+    for (int i = 0; i < room->size; ++i) {
+        const LogEntry *e = room->entries[i];
+        if (entry_type(e) != TYPE_MOTION) continue;
+        int pos = row->size++;
+        row->timestamps[pos] = e->timestamp;
+        for (int z = 0; z < MOTION_ZONES; ++z) {
+            row->zones[z][pos / WORD_BITS] |= (uint64_t)(e->value.motion[z] != 0) << (pos % WORD_BITS);
+        }
+    }
+    ms->size += row->size;
+}
+
+/* ---- motion_attach ---------------------------------------------------------
+   Purpose: Fill a motion store from the entries already in a collection and
+            attach it, so every later motion reading is added to it as well.
+   Params:
+     - ms (in/out): motion store (its previous contents are discarded)
+     - ec (in/out): entry collection
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int motion_attach(MotionStore *ms, EntryCollection *ec) {
+    if (!ms || !ec) return C_ERR_NULL_PTR;
+
+    motion_free(ms);
+    // entry_cmp order, so every reading is its room's newest so far: appends only
+    BTreeIter it;
+    btree_first(&ec->order, &it);
+    for (const LogEntry *e = entries_next(ec, &it); e; e = entries_next(ec, &it)) {
+        if (entry_type(e) != TYPE_MOTION) continue;
+        int result = motion_add(ms, entry_room(e), e->value, e->timestamp);
+        if (result != C_ERR_OK) {
+            return result;
+        }
+    }
+    ec->motion = ms;
+    return C_ERR_OK;
+}
+
+/* ---- motion_window ---------------------------------------------------------
+   Purpose: Count a room's motion readings in [t_from, t_to], and how many
+            saw movement per zone, in any zone and in all three.
+            O(log n + k/64) for k readings in the window.
+   Params:
+     - ms (in): motion store
+     - room (in): room
+     - t_from, t_to (in): inclusive timestamp bounds
+     - out (out): counts
+   Returns: C_ERR_OK, C_ERR_NULL_PTR
+----------------------------------------------------------------------------- */
+int motion_window(const MotionStore *ms, const Room *room, int t_from, int t_to, MotionCounts *out) {
+    if (!ms || !room || !out) return C_ERR_NULL_PTR;
+
+    memset(out, 0, sizeof *out);
+    const MotionRow *row = motion_row(ms, room);
+    if (!row) return C_ERR_OK;
+    int lo, hi;
+    row_window(row, t_from, t_to, &lo, &hi);
+    if (lo == hi) return C_ERR_OK;
+
+    out->readings = hi - lo;
+    for (int w = lo / WORD_BITS; w <= (hi - 1) / WORD_BITS; ++w) {
+        uint64_t mask = window_mask(w, lo, hi);
+        uint64_t left = row->zones[0][w] & mask;
+        uint64_t forward = row->zones[1][w] & mask;
+        uint64_t right = row->zones[2][w] & mask;
+        out->zones[0] += __builtin_popcountll(left);
+        out->zones[1] += __builtin_popcountll(forward);
+        out->zones[2] += __builtin_popcountll(right);
+        out->any_zone += __builtin_popcountll(left | forward | right);
+        out->all_zones += __builtin_popcountll(left & forward & right);
+    }
+    return C_ERR_OK;
+}
+
+/* ---- motion_any / motion_all -----------------------------------------------
+   Purpose: Whether any motion reading of a room in [t_from, t_to] saw
+            movement in one of the given zones (motion_any), or whether
+            there was at least one reading and every one saw movement in
+            all of them (motion_all). Both stop at the first word that
+            settles the answer.
+   Params:
+     - ms (in): motion store
+     - room (in): room
+     - zone_bits (in): MOTION_LEFT|MOTION_FORWARD|MOTION_RIGHT, one or more
+     - t_from, t_to (in): inclusive timestamp bounds
+   Returns: 1 or 0 (0 for NULL arguments)
+----------------------------------------------------------------------------- */
+int motion_any(const MotionStore *ms, const Room *room, int zone_bits, int t_from, int t_to) {
+    if (!ms || !room) return 0;
+    const MotionRow *row = motion_row(ms, room);
+    if (!row) return 0;
+    int lo, hi;
+    row_window(row, t_from, t_to, &lo, &hi);
+
+    for (int w = lo / WORD_BITS; lo < hi && w <= (hi - 1) / WORD_BITS; ++w) {
+        uint64_t seen = 0;
+        for (int z = 0; z < MOTION_ZONES; ++z) {
+            if (zone_bits & ZONE_BITS[z]) seen |= row->zones[z][w];
+        }
+        if (seen & window_mask(w, lo, hi)) return 1;
+    }
+    return 0;
+}
+
+int motion_all(const MotionStore *ms, const Room *room, int zone_bits, int t_from, int t_to) {
+    if (!ms || !room) return 0;
+    const MotionRow *row = motion_row(ms, room);
+    if (!row) return 0;
+    int lo, hi;
+    row_window(row, t_from, t_to, &lo, &hi);
+    if (lo == hi) return 0;
+
+    for (int w = lo / WORD_BITS; w <= (hi - 1) / WORD_BITS; ++w) {
+        uint64_t mask = window_mask(w, lo, hi);
+        uint64_t seen = mask;
+        for (int z = 0; z < MOTION_ZONES; ++z) {
+            if (zone_bits & ZONE_BITS[z]) seen &= row->zones[z][w];
+        }
+        if (seen != mask) return 0;
+    }
+    return 1;
+}
+
+/* ---- motion_bytes ----------------------------------------------------------
+   Purpose: Memory held by the store (by capacity, not size).
+   Params:
+     - ms (in): motion store
+   Returns: bytes allocated
+----------------------------------------------------------------------------- */
+size_t motion_bytes(const MotionStore *ms) {
+    if (!ms) return 0;
+    size_t bytes = (size_t)ms->num_rooms * sizeof *ms->rows;
+    for (int r = 0; r < ms->num_rooms; ++r) {
+        size_t capacity = ms->rows[r].capacity;
+        bytes += capacity * sizeof(int) + MOTION_ZONES * capacity / WORD_BITS * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+/* ---- motion_free -----------------------------------------------------------
+   Purpose: Release every row and reset the store to empty. An attached
+            store stays attached.
+   Params:
+     - ms (in/out): motion store
+----------------------------------------------------------------------------- */
+void motion_free(MotionStore *ms) {
+    if (!ms) return;
+    for (int r = 0; r < ms->num_rooms; ++r) {
+        free(ms->rows[r].timestamps);
+        for (int z = 0; z < MOTION_ZONES; ++z) {
+            free(ms->rows[r].zones[z]);
+        }
+    }
+    free(ms->rows);
+    memset(ms, 0, sizeof *ms);
+}
@@ -0,0 +1,508 @@
+// persist.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "defs.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* On-disk store for the collections: a snapshot of everything up to some
+   generation, plus an append-only log of the rooms and entries added since.
+
+   snapshot.bin  SnapshotHeader, then the room names in id order (length
+                 byte + bytes), then every entry in creation (handle) order
+                 as a PersistEntry, so a bulk load gives back the same
+                 handles and the same order among equal keys. The header's
+                 CRC covers everything after it.
+   log.bin       LogHeader, then records: LogRecordHeader + payload (a room
+                 name, or one PersistEntry). Each record has its own CRC, so
+                 a torn or corrupt tail is found and cut off on open.
+
+   A snapshot of generation g+1 is written to a temporary file and renamed
+   over the old one, then the log is replaced by an empty generation g+1 log.
+   A crash between the two leaves a log older than the snapshot, whose
+   records the snapshot already holds, so it is discarded.
+
+   Integers are stored in host byte order: the files are not meant to move
+   between machines. */
+
+#define STORE_PATH_MAX  (PERSIST_PATH_MAX + 32)   /* store dir + "/" + file name */
+
+static const char SNAPSHOT_MAGIC[8] = "A2SNAP1";
+static const char LOG_MAGIC[8] = "A2LOG1";
+
+#define LOG_ROOM   1    /* payload: room name bytes */
+#define LOG_ENTRY  2    /* payload: PersistEntry */
+
+typedef struct {
+    char     magic[8];
+    uint32_t generation;
+    uint32_t num_rooms;
+    uint32_t num_entries;
+    uint32_t crc;            /* of the payload that follows */
+    uint64_t payload_size;
+} SnapshotHeader;
+
+typedef struct {
+    char     magic[8];
+    uint32_t generation;     /* snapshot generation this log continues from */
+    uint32_t crc;            /* of magic and generation */
+} LogHeader;
+
+typedef struct {
+    uint32_t crc;            /* of kind, size and the payload */
+    uint16_t kind;           /* LOG_ROOM|LOG_ENTRY */
+    uint16_t size;           /* payload bytes */
+} LogRecordHeader;
+
+typedef struct {
+    uint32_t     room_id;
+    int32_t      timestamp;
+    int32_t      type;
+    ReadingValue value;
+} PersistEntry;
+
+/* ---- crc32 -----------------------------------------------------------------
+   Standard CRC-32 (the zlib/PNG polynomial), table driven. Pass the previous
+   result as `crc` to continue a checksum over several buffers, 0 to start.
+----------------------------------------------------------------------------- */
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t size) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    const unsigned char *p = data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t log_record_crc(const LogRecordHeader *rh, const void *payload) {
+    uint32_t crc = crc32_update(0, &rh->kind, sizeof rh->kind);
+    crc = crc32_update(crc, &rh->size, sizeof rh->size);
+    return crc32_update(crc, payload, rh->size);
+}
+
+static void persist_path(const PersistStore *ps, const char *file, char *out) {
+    snprintf(out, STORE_PATH_MAX, "%s/%s", ps->dir, file);
+}
+
+// Map a whole file read-only. An empty or missing file maps to NULL/0.
+static int map_file(const char *path, const unsigned char **data, size_t *size) {
+    *data = NULL;
+    *size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? C_ERR_NOT_FOUND : C_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return C_ERR_IO;
+    }
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return C_ERR_IO;
+        }
+        *data = map;
+        *size = st.st_size;
+    }
+    close(fd);
+    return C_ERR_OK;
+}
+
+static void unmap_file(const unsigned char *data, size_t size) {
+    if (data) {
+        munmap((void *)data, size);
+    }
+}
+
+// Load snapshot.bin (if any) into the empty collections.
+static int snapshot_load(PersistStore *ps, RoomCollection *rc, EntryCollection *ec) {
+    char path[STORE_PATH_MAX];
+    const unsigned char *data;
+    size_t size;
+    persist_path(ps, "snapshot.bin", path);
+    int result = map_file(path, &data, &size);
+    if (result == C_ERR_NOT_FOUND) {
+        return C_ERR_OK; // a new store
+    }
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    SnapshotHeader hdr;
+    if (size < sizeof hdr) {
+        unmap_file(data, size);
+        return C_ERR_INVALID;
+    }
+    memcpy(&hdr, data, sizeof hdr);
+    const unsigned char *p = data + sizeof hdr;
+    if (memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof hdr.magic) != 0 ||
+        hdr.payload_size != size - sizeof hdr ||
+        crc32_update(0, p, hdr.payload_size) != hdr.crc) {
+        unmap_file(data, size);
+        return C_ERR_INVALID;
+    }
+
+    // Rooms in id order, so every room gets back the id entries refer to
+    const unsigned char *end = p + hdr.payload_size;
+    char name[MAX_STR];
+    for (uint32_t i = 0; i < hdr.num_rooms && result == C_ERR_OK; ++i) {
+        if (p >= end || *p >= MAX_STR || p + 1 + *p > end) {
+            result = C_ERR_INVALID;
+            break;
+        }
+        memcpy(name, p + 1, *p);
+        name[*p] = '\0';
+        p += 1 + *p;
+        result = rooms_add(rc, name);
+    }
+
+    EntryInput *batch = NULL;
+    if (result == C_ERR_OK && (size_t)(end - p) != (size_t)hdr.num_entries * sizeof(PersistEntry)) {
+        result = C_ERR_INVALID;
+    }
+    if (result == C_ERR_OK && hdr.num_entries > 0) {
+        batch = malloc(hdr.num_entries * sizeof *batch);
+        result = batch ? C_ERR_OK : C_ERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < hdr.num_entries && result == C_ERR_OK; ++i) {
+        PersistEntry pe;
+        memcpy(&pe, p + i * sizeof pe, sizeof pe);
+        if (pe.room_id >= (uint32_t)rc->size) {
+            result = C_ERR_INVALID;
+            break;
+        }
+        batch[i].room = rc->rooms[pe.room_id];
+        batch[i].type = pe.type;
+        batch[i].value = pe.value;
+        batch[i].timestamp = pe.timestamp;
+    }
+    if (result == C_ERR_OK) {
+        result = entries_bulk_create(ec, rc, batch, hdr.num_entries);
+    }
+    free(batch);
+    unmap_file(data, size);
+
+    if (result == C_ERR_OK) {
+        ps->generation = hdr.generation;
+        ps->snapshot_entries = hdr.num_entries;
+    }
+    return result;
+}
+
+// Replay log.bin on top of the snapshot. Records after the first bad one are
+// counted in dropped_bytes and cut off so new records follow the good ones.
+static int log_replay(PersistStore *ps, RoomCollection *rc, EntryCollection *ec, int *fresh) {
+    char path[STORE_PATH_MAX];
+    const unsigned char *data;
+    size_t size;
+    persist_path(ps, "log.bin", path);
+    int result = map_file(path, &data, &size);
+    *fresh = 1;
+    if (result == C_ERR_NOT_FOUND) {
+        return C_ERR_OK;
+    }
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    LogHeader hdr;
+    if (size < sizeof hdr) {
+        unmap_file(data, size);
+        return C_ERR_OK; // never finished its header: start a new log
+    }
+    memcpy(&hdr, data, sizeof hdr);
+    if (memcmp(hdr.magic, LOG_MAGIC, sizeof hdr.magic) != 0 ||
+        crc32_update(0, &hdr, offsetof(LogHeader, crc)) != hdr.crc) {
+        unmap_file(data, size);
+        return C_ERR_INVALID;
+    }
+    if (hdr.generation < ps->generation) {
+        unmap_file(data, size);
+        return C_ERR_OK; // already in the snapshot
+    }
+    if (hdr.generation > ps->generation) {
+        unmap_file(data, size);
+        return C_ERR_INVALID; // the snapshot it continues from is missing
+    }
+
+    // Entries are collected and added with one bulk insert at the end; rooms
+    // are added as they come so later records can refer to them
+    size_t pos = sizeof hdr;
+    size_t capacity = 0;
+    size_t count = 0;
+    EntryInput *batch = NULL;
+    while (result == C_ERR_OK && pos + sizeof(LogRecordHeader) <= size) {
+        LogRecordHeader rh;
+        memcpy(&rh, data + pos, sizeof rh);
+        const unsigned char *payload = data + pos + sizeof rh;
+        if (pos + sizeof rh + rh.size > size || log_record_crc(&rh, payload) != rh.crc) {
+            break;
+        }
+
+        if (rh.kind == LOG_ROOM && rh.size < MAX_STR) {
+            char name[MAX_STR];
+            memcpy(name, payload, rh.size);
+            name[rh.size] = '\0';
+            result = rooms_add(rc, name);
+        } else if (rh.kind == LOG_ENTRY && rh.size == sizeof(PersistEntry)) {
+            PersistEntry pe;
+            memcpy(&pe, payload, sizeof pe);
+            if (pe.room_id >= (uint32_t)rc->size) {
+                result = C_ERR_INVALID;
+                break;
+            }
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : SLAB_CHUNK;
+                EntryInput *grown = realloc(batch, capacity * sizeof *grown);
+                if (!grown) {
+                    result = C_ERR_NO_MEMORY;
+                    break;
+                }
+                batch = grown;
+            }
+            batch[count].room = rc->rooms[pe.room_id];
+            batch[count].type = pe.type;
+            batch[count].value = pe.value;
+            batch[count].timestamp = pe.timestamp;
+            count++;
+        } else {
+            result = C_ERR_INVALID;
+            break;
+        }
+        pos += sizeof rh + rh.size;
+        ps->log_records++;
+    }
+    if (result == C_ERR_OK) {
+        result = entries_bulk_create(ec, rc, batch, count);
+    }
+    free(batch);
+    unmap_file(data, size);
+
+    if (result == C_ERR_OK) {
+        ps->dropped_bytes = size - pos;
+        if (pos < size && truncate(path, pos) != 0) {
+            return C_ERR_IO;
+        }
+        *fresh = 0;
+    }
+    return result;
+}
+
+// Write head and body to `path` through a temporary file, fsync and rename,
+// so the file is either the old one or the complete new one.
+static int write_atomic(const char *path, const void *head, size_t head_size,
+                        const void *body, size_t body_size) {
+    char tmp[STORE_PATH_MAX + 4];
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return C_ERR_IO;
+    int ok = fwrite(head, 1, head_size, f) == head_size &&
+             (body_size == 0 || fwrite(body, 1, body_size, f) == body_size) &&
+             fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return C_ERR_IO;
+    }
+    return C_ERR_OK;
+}
+
+static int log_open(PersistStore *ps, const char *path) {
+    ps->log = fopen(path, "ab");
+    return ps->log ? C_ERR_OK : C_ERR_IO;
+}
+
+// Replace log.bin with an empty log for the current generation and open it
+// for appending.
+static int log_start(PersistStore *ps) {
+    char path[STORE_PATH_MAX];
+    persist_path(ps, "log.bin", path);
+
+    LogHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, LOG_MAGIC, sizeof hdr.magic);
+    hdr.generation = ps->generation;
+    hdr.crc = crc32_update(0, &hdr, offsetof(LogHeader, crc));
+
+    if (ps->log) {
+        fclose(ps->log);
+        ps->log = NULL;
+    }
+    int result = write_atomic(path, &hdr, sizeof hdr, NULL, 0);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+    ps->log_records = 0;
+    return log_open(ps, path);
+}
+
+/* ---- persist_open ----------------------------------------------------------
+   Purpose: Open (or create) a store directory and load it into empty
+            collections: map the snapshot, bulk load it, then replay the log
+            written since. A log whose last records are torn or corrupt is
+            cut back to its last good record (see dropped_bytes).
+   Params:
+     - ps (out): store; closed with persist_close
+     - dir (in): directory holding snapshot.bin and log.bin
+     - rc (in/out): empty room collection
+     - ec (in/out): empty entry collection
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_IO, C_ERR_NO_MEMORY,
+            C_ERR_INVALID (corrupt snapshot, or a log that does not belong
+            to it; the files are left untouched)
+----------------------------------------------------------------------------- */
+int persist_open(PersistStore *ps, const char *dir, RoomCollection *rc, EntryCollection *ec) {
+    if (!ps || !dir || !rc || !ec) return C_ERR_NULL_PTR;
+
+    memset(ps, 0, sizeof *ps);
+    if (strlen(dir) >= PERSIST_PATH_MAX) return C_ERR_INVALID;
+    strcpy(ps->dir, dir);
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) return C_ERR_IO;
+
+    int fresh;
+    int result = snapshot_load(ps, rc, ec);
+    if (result == C_ERR_OK) {
+        result = log_replay(ps, rc, ec, &fresh);
+    }
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    char path[STORE_PATH_MAX];
+    persist_path(ps, "log.bin", path);
+    return fresh ? log_start(ps) : log_open(ps, path);
+}
+
+// Append one record and flush it to the OS, so it survives the process.
+static int log_append(PersistStore *ps, int kind, const void *payload, size_t size) {
+    if (!ps || !ps->log) return C_ERR_NULL_PTR;
+
+    LogRecordHeader rh;
+    rh.kind = (uint16_t)kind;
+    rh.size = (uint16_t)size;
+    rh.crc = log_record_crc(&rh, payload);
+    if (fwrite(&rh, sizeof rh, 1, ps->log) != 1 ||
+        fwrite(payload, 1, size, ps->log) != size ||
+        fflush(ps->log) != 0) {
+        return C_ERR_IO;
+    }
+    ps->log_records++;
+    return C_ERR_OK;
+}
+
+/* ---- persist_log_room / persist_log_entry ----------------------------------
+   Purpose: Record a room or entry that was just added to the collections.
+   Params:
+     - ps (in/out): open store
+     - name (in): name the room was added with
+     - room, type, value, timestamp (in): the entries_create arguments
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_IO
+----------------------------------------------------------------------------- */
+int persist_log_room(PersistStore *ps, const char *name) {
+    if (!name) return C_ERR_NULL_PTR;
+    size_t len = strlen(name);
+    return log_append(ps, LOG_ROOM, name, len < MAX_STR ? len : MAX_STR - 1);
+}
+
+int persist_log_entry(PersistStore *ps, const Room *room, int type, ReadingValue value, int timestamp) {
+    if (!room) return C_ERR_NULL_PTR;
+    PersistEntry pe;
+    memset(&pe, 0, sizeof pe);
+    pe.room_id = (uint32_t)room->id;
+    pe.timestamp = timestamp;
+    pe.type = type;
+    pe.value = value;
+    return log_append(ps, LOG_ENTRY, &pe, sizeof pe);
+}
+
+/* ---- persist_snapshot ------------------------------------------------------
+   Purpose: Write the whole state as the next snapshot generation and start
+            an empty log for it, so the next open only replays what comes
+            after this point.
+   Params:
+     - ps (in/out): open store
+     - rc (in): room collection
+     - ec (in): entry collection
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY, C_ERR_IO
+----------------------------------------------------------------------------- */
+int persist_snapshot(PersistStore *ps, const RoomCollection *rc, const EntryCollection *ec) {
+    if (!ps || !rc || !ec) return C_ERR_NULL_PTR;
+
+    size_t size = (size_t)ec->size * sizeof(PersistEntry);
+    for (int i = 0; i < rc->size; ++i) {
+        size += 1 + strlen(rc->rooms[i]->name);
+    }
+    unsigned char *payload = malloc(size ? size : 1);
+    if (!payload) return C_ERR_NO_MEMORY;
+
+    unsigned char *p = payload;
+    for (int i = 0; i < rc->size; ++i) {
+        size_t len = strlen(rc->rooms[i]->name); // rooms_add keeps names under MAX_STR
+        *p++ = (unsigned char)len;
+        memcpy(p, rc->rooms[i]->name, len);
+        p += len;
+    }
+    for (EntryHandle h = 0; h < ec->size; ++h) {
+        const LogEntry *e = entries_get(ec, h);
+        PersistEntry pe;
+        memset(&pe, 0, sizeof pe);
+        pe.room_id = (uint32_t)entry_room(e)->id;
+        pe.timestamp = e->timestamp;
+        pe.type = entry_type(e);
+        pe.value = e->value;
+        memcpy(p, &pe, sizeof pe);
+        p += sizeof pe;
+    }
+
+    SnapshotHeader hdr;
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof hdr.magic);
+    hdr.generation = ps->generation + 1;
+    hdr.num_rooms = (uint32_t)rc->size;
+    hdr.num_entries = (uint32_t)ec->size;
+    hdr.crc = crc32_update(0, payload, size);
+    hdr.payload_size = size;
+
+    char path[STORE_PATH_MAX];
+    persist_path(ps, "snapshot.bin", path);
+    int result = write_atomic(path, &hdr, sizeof hdr, payload, size);
+    free(payload);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    ps->generation = hdr.generation;
+    ps->snapshot_entries = hdr.num_entries;
+    return log_start(ps);
+}
+
+/* ---- persist_close ---------------------------------------------------------
+   Purpose: Close the log. Everything logged is already on disk.
+   Params:
+     - ps (in/out): store
+----------------------------------------------------------------------------- */
+void persist_close(PersistStore *ps) {
+    if (!ps) return;
+    if (ps->log) {
+        fclose(ps->log);
+    }
+    ps->log = NULL;
+}
@@ -0,0 +1,138 @@
+// query.c
+
+#include "defs.h"
+#include <limits.h>
+#include <stdlib.h>
+
+/* Time-range queries over one room. A room's entry list is sorted by
+   (type, timestamp), the tail of the entry_cmp order, so every entry of one
+   type in [t_from, t_to] sits in one contiguous run that two binary searches
+   find in O(log n). Aggregating the run is O(k); with the room's prefix sums
+   built, count and sum (and so the mean) come straight from the bounds. */
+
+/* ---- reading_numeric -------------------------------------------------------
+   Purpose: Value of a reading as a number for aggregation.
+   Params:
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - value (in): reading payload
+   Returns: temperature, decibels, or the number of motion zones triggered
+----------------------------------------------------------------------------- */
+double reading_numeric(int type, ReadingValue value) {
+    switch (type) {
+        case TYPE_TEMP:   return value.temperature;
+        case TYPE_DB:     return value.decibels;
+        case TYPE_MOTION: return (value.motion[0] != 0) + (value.motion[1] != 0) + (value.motion[2] != 0);
+        default:          return 0.0;
+    }
+}
+
+// First index in r->entries whose (type, timestamp) is not less than the given one.
+static int room_lower_bound(const Room *r, int type, int timestamp) {
+    int lo = 0, hi = r->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const LogEntry *e = r->entries[mid];
+        if (entry_type(e) < type || (entry_type(e) == type && e->timestamp < timestamp)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Bounds [*first, *last) of the entries of `type` with t_from <= timestamp <= t_to.
+static void room_range(const Room *r, int type, int t_from, int t_to, int *first, int *last) {
+    *first = room_lower_bound(r, type, t_from);
+    *last = t_to == INT_MAX ? room_lower_bound(r, type + 1, INT_MIN)
+                            : room_lower_bound(r, type, t_to + 1);
+    if (*last < *first) {
+        *last = *first;
+    }
+}
+
+static int room_prefix_current(const Room *r) {
+    return r->prefix && r->prefix_size == r->size + 1;
+}
+
+/* ---- room_build_prefix -----------------------------------------------------
+   Purpose: Build (or rebuild) a room's prefix sums: prefix[i] is the sum of
+            the numeric values of entries[0..i-1]. Any insert into the room
+            makes them stale; stale sums are ignored until rebuilt.
+   Params:
+     - r (in/out): room
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int room_build_prefix(Room *r) {
+    if (!r) return C_ERR_NULL_PTR;
+    if (room_prefix_current(r)) {
+        return C_ERR_OK;
+    }
+
+    double *prefix = realloc(r->prefix, (r->size + 1) * sizeof *prefix);
+    if (!prefix) return C_ERR_NO_MEMORY;
+    prefix[0] = 0.0;
+    for (int i = 0; i < r->size; ++i) {
+        const LogEntry *e = r->entries[i];
+        prefix[i + 1] = prefix[i] + reading_numeric(entry_type(e), e->value);
+    }
+    r->prefix = prefix;
+    r->prefix_size = r->size + 1;
+    return C_ERR_OK;
+}
+
+/* ---- query_range_stats -----------------------------------------------------
+   Purpose: count/min/max/sum of one room's readings of one type whose
+            timestamp is in [t_from, t_to]. O(log n + k) for k matches.
+   Params:
+     - r (in): room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - t_from, t_to (in): inclusive timestamp bounds
+     - out (out): result; min/max/sum are 0 when count is 0
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int query_range_stats(const Room *r, int type, int t_from, int t_to, ReadingStats *out) {
+    if (!r || !out) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    memset(out, 0, sizeof *out);
+    int first, last;
+    room_range(r, type, t_from, t_to, &first, &last);
+    if (first == last) {
+        return C_ERR_OK;
+    }
+
+    out->count = last - first;
+    out->min = out->max = reading_numeric(type, r->entries[first]->value);
+    for (int i = first; i < last; ++i) {
+        double x = reading_numeric(type, r->entries[i]->value);
+        if (x < out->min) out->min = x;
+        if (x > out->max) out->max = x;
+        out->sum += x;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- query_range_sum -------------------------------------------------------
+   Purpose: count and sum (min/max left at 0) of one room's readings of one
+            type in [t_from, t_to]. O(log n) when the room's prefix sums are
+            current (see room_build_prefix), otherwise O(log n + k).
+   Params: as query_range_stats
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int query_range_sum(const Room *r, int type, int t_from, int t_to, ReadingStats *out) {
+    if (!r || !out) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+    if (!room_prefix_current(r)) {
+        int result = query_range_stats(r, type, t_from, t_to, out);
+        out->min = out->max = 0.0;
+        return result;
+    }
+
+    memset(out, 0, sizeof *out);
+    int first, last;
+    room_range(r, type, t_from, t_to, &first, &last);
+    out->count = last - first;
+    out->sum = r->prefix[last] - r->prefix[first];
+    return C_ERR_OK;
+}
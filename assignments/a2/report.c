@@ -0,0 +1,465 @@
+// report.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "defs.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Report output without printf. Rows are formatted straight into a large
+   buffer by the small formatters below, and the buffer goes out with one
+   write() per REPORT_BUF_SIZE bytes. The text rows are byte for byte what
+   entry_print/room_print have always printed; %.2f is reproduced exactly
+   (see fmt_fixed2).
+
+   Binary export layout: ExportHeader, the room names in id order (length
+   byte + bytes), then one ExportEntry per entry in sorted order. Host byte
+   order, like the store files. */
+
+static const char EXPORT_MAGIC[8] = "A2EXP1";
+
+typedef struct {
+    char     magic[8];
+    uint32_t num_rooms;
+    uint32_t num_entries;
+} ExportHeader;
+
+typedef struct {
+    uint32_t     room_id;
+    int32_t      timestamp;
+    int32_t      type;
+    ReadingValue value;
+} ExportEntry;
+
+static const char TABLE_RULE[] = "-------------|------------|------------|------------------\n";
+static const char TABLE_HEAD[] = "Room         | Timestamp  | Type       | Value\n";
+
+// Decimal digits of v, written forwards at p. Returns the end.
+static char* fmt_u64(char *p, uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+static char* fmt_int(char *p, int v) {
+    if (v < 0) {
+        *p++ = '-';
+        return fmt_u64(p, (uint64_t)(-(int64_t)v));
+    }
+    return fmt_u64(p, (uint64_t)v);
+}
+
+// `len` bytes of s, then spaces up to `width` (printf's %-*s)
+static char* fmt_padded(char *p, const char *s, size_t len, int width) {
+    memcpy(p, s, len);
+    p += len;
+    while ((int)len < width) {
+        *p++ = ' ';
+        len++;
+    }
+    return p;
+}
+
+static char* fmt_int_padded(char *p, int v, int width) {
+    char tmp[12];
+    size_t len = fmt_int(tmp, v) - tmp;
+    return fmt_padded(p, tmp, len, width);
+}
+
+// printf("%.2f", x) for a float. x * 100 is exact in a double (24 + 7 bits),
+// so rounding it to the nearest integer, ties to even, rounds the exact
+// value the way printf does. Huge values and NaN/inf go through snprintf.
+static char* fmt_fixed2(char *p, float x) {
+    double scaled = (double)x * 100.0;
+    double mag = scaled < 0 ? -scaled : scaled;
+    if (!(mag < 9e15)) {
+        return p + snprintf(p, REPORT_ROW_MAX / 2, "%.2f", x);
+    }
+    uint64_t v = (uint64_t)mag;
+    double frac = mag - (double)v;
+    if (frac > 0.5 || (frac == 0.5 && (v & 1))) {
+        v++;
+    }
+    if (signbit(x)) {
+        *p++ = '-'; // printf keeps the sign of values that round to zero: -0.00
+    }
+    p = fmt_u64(p, v / 100);
+    *p++ = '.';
+    *p++ = (char)('0' + v / 10 % 10);
+    *p++ = (char)('0' + v % 10);
+    return p;
+}
+
+static char* fmt_motion(char *p, const unsigned char motion[3], char sep) {
+    for (int k = 0; k < 3; ++k) {
+        if (k > 0) *p++ = sep;
+        p = fmt_int(p, motion[k]);
+    }
+    return p;
+}
+
+/* ---- report_entry_row ------------------------------------------------------
+   Purpose: Format one entry as the table row entry_print prints.
+   Params:
+     - out (out): at least REPORT_ROW_MAX bytes; not NUL-terminated
+     - e (in): entry (its room must be set)
+   Returns: number of bytes written
+----------------------------------------------------------------------------- */
+size_t report_entry_row(char *out, const LogEntry *e) {
+    const Room *room = entry_room(e);
+    size_t name_len = strnlen(room->name, MAX_STR);
+    char *p = fmt_padded(out, room->name, name_len, 12);
+    p = fmt_padded(p, " | ", 3, 0);
+    p = fmt_int_padded(p, e->timestamp, 10);
+    p = fmt_padded(p, " | ", 3, 0);
+
+    switch (entry_type(e)) {
+        case TYPE_TEMP:
+            p = fmt_padded(p, "TEMP       | ", 13, 0);
+            p = fmt_fixed2(p, e->value.temperature);
+            p = fmt_padded(p, "°C\n", sizeof "°C\n" - 1, 0);
+            break;
+        case TYPE_DB:
+            p = fmt_padded(p, "DB         | ", 13, 0);
+            p = fmt_int(p, e->value.decibels);
+            p = fmt_padded(p, " dB\n", 4, 0);
+            break;
+        case TYPE_MOTION:
+            p = fmt_padded(p, "MOTION     | [", 14, 0);
+            p = fmt_motion(p, e->value.motion, ',');
+            p = fmt_padded(p, "]\n", 2, 0);
+            break;
+        default:
+            p = fmt_padded(p, "UNKNOWN TYPE\n", 13, 0);
+    }
+    return p - out;
+}
+
+// The entry as a CSV line that a2 --batch reads back
+static size_t report_csv_row(char *out, const LogEntry *e) {
+    const Room *room = entry_room(e);
+    char *p = fmt_padded(out, room->name, strnlen(room->name, MAX_STR), 0);
+    *p++ = ',';
+    p = fmt_int(p, entry_type(e));
+    *p++ = ',';
+    p = fmt_int(p, e->timestamp);
+    *p++ = ',';
+    switch (entry_type(e)) {
+        case TYPE_TEMP:   p = fmt_fixed2(p, e->value.temperature); break;
+        case TYPE_DB:     p = fmt_int(p, e->value.decibels); break;
+        default:          p = fmt_motion(p, e->value.motion, ' '); break;
+    }
+    *p++ = '\n';
+    return p - out;
+}
+
+/* ---- report_open -----------------------------------------------------------
+   Purpose: Start buffered output to a stream. Whatever the stream has
+            buffered is flushed first; until report_close, write to it only
+            through the writer.
+   Params:
+     - w (out): writer
+     - out (in/out): stream to write to
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int report_open(ReportWriter *w, FILE *out) {
+    if (!w || !out) return C_ERR_NULL_PTR;
+    memset(w, 0, sizeof *w);
+    w->buf = malloc(REPORT_BUF_SIZE);
+    if (!w->buf) return C_ERR_NO_MEMORY;
+    fflush(out);
+    w->fd = fileno(out);
+    w->error = C_ERR_OK;
+    return C_ERR_OK;
+}
+
+// Write out the buffer. After a failed write the rest of the report is
+// dropped and report_close returns C_ERR_IO.
+static void report_flush(ReportWriter *w) {
+    size_t done = 0;
+    while (done < w->len && w->error == C_ERR_OK) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            w->error = C_ERR_IO;
+        } else {
+            done += n;
+        }
+    }
+    w->len = 0;
+}
+
+/* ---- report_write ----------------------------------------------------------
+   Purpose: Append raw bytes to the report.
+   Params:
+     - w (in/out): writer
+     - data (in): bytes
+     - size (in): number of bytes
+----------------------------------------------------------------------------- */
+void report_write(ReportWriter *w, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        if (w->len == REPORT_BUF_SIZE) {
+            report_flush(w);
+        }
+        size_t take = REPORT_BUF_SIZE - w->len;
+        if (take > size) take = size;
+        memcpy(w->buf + w->len, p, take);
+        w->len += take;
+        p += take;
+        size -= take;
+    }
+}
+
+// Room for one more formatted row at the end of the buffer
+static char* report_row_space(ReportWriter *w) {
+    if (w->len + REPORT_ROW_MAX > REPORT_BUF_SIZE) {
+        report_flush(w);
+    }
+    return w->buf + w->len;
+}
+
+// "--- Room: name (Entries: n) ---", or for room NULL "--- All Log Entries (n) ---"
+static void report_title(ReportWriter *w, const Room *room, long count) {
+    char *p = report_row_space(w);
+    char *start = p;
+    if (room) {
+        p = fmt_padded(p, "\n--- Room: ", 11, 0);
+        p = fmt_padded(p, room->name, strnlen(room->name, MAX_STR), 0);
+        p = fmt_padded(p, " (Entries: ", 11, 0);
+    } else {
+        p = fmt_padded(p, "\n--- All Log Entries (", 22, 0);
+    }
+    p = fmt_u64(p, (uint64_t)count);
+    p = fmt_padded(p, ") ---\n", 6, 0);
+    w->len += p - start;
+}
+
+static void report_table_head(ReportWriter *w) {
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+    report_write(w, TABLE_HEAD, sizeof TABLE_HEAD - 1);
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+}
+
+/* ---- report_room -----------------------------------------------------------
+   Purpose: Write a room header and its entries, as room_print prints them.
+   Params:
+     - w (in/out): writer
+     - r (in): room
+----------------------------------------------------------------------------- */
+void report_room(ReportWriter *w, const Room *r) {
+    report_title(w, r, r->size);
+    if (r->size == 0) {
+        report_write(w, "No entries for this room.\n", 26);
+        return;
+    }
+    report_table_head(w);
+    for (int i = 0; i < r->size; ++i) {
+        w->len += report_entry_row(report_row_space(w), r->entries[i]);
+    }
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+}
+
+// Every entry as a CSV line, in sorted order except that entries with equal
+// keys are written oldest first (sorted order lists the newest first). A
+// --batch import adds them back in file order, so export, import, export
+// gives the same file.
+static int report_csv_entries(ReportWriter *w, const EntryCollection *ec) {
+    const LogEntry **run = NULL;
+    int size = 0, capacity = 0, result = C_ERR_OK;
+    BTreeIter it;
+    btree_first(&ec->order, &it);
+    const LogEntry *e = entries_next(ec, &it);
+    while (e) {
+        uint64_t key = entry_sort_key(e);
+        size = 0;
+        for (; e && entry_sort_key(e) == key; e = entries_next(ec, &it)) {
+            if (size == capacity) {
+                int new_capacity = capacity ? capacity * 2 : 16;
+                const LogEntry **grown = realloc(run, new_capacity * sizeof *grown);
+                if (!grown) {
+                    result = C_ERR_NO_MEMORY;
+                    break;
+                }
+                run = grown;
+                capacity = new_capacity;
+            }
+            run[size++] = e;
+        }
+        if (result != C_ERR_OK) break;
+        while (size > 0) {
+            w->len += report_csv_row(report_row_space(w), run[--size]);
+        }
+    }
+    free(run);
+    return result;
+}
+
+/* ---- report_entries --------------------------------------------------------
+   Purpose: Write every entry in sorted order.
+   Params:
+     - w (in/out): writer
+     - ec (in): entry collection
+     - rc (in): room collection (REPORT_BINARY only: its room table is
+                written too, and entries refer to it by room id)
+     - format (in): REPORT_TEXT (the "All Log Entries" table the menu
+                    prints), REPORT_CSV (room,type,timestamp,value, which
+                    a2 --batch reads) or REPORT_BINARY (exact values)
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID (unknown format),
+            C_ERR_NO_MEMORY (REPORT_CSV; the file is cut short)
+----------------------------------------------------------------------------- */
+int report_entries(ReportWriter *w, const EntryCollection *ec, const RoomCollection *rc, int format) {
+    if (!w || !ec || (format == REPORT_BINARY && !rc)) return C_ERR_NULL_PTR;
+    if (format < REPORT_TEXT || format > REPORT_BINARY) return C_ERR_INVALID;
+
+    BTreeIter it;
+    btree_first(&ec->order, &it);
+    if (format == REPORT_TEXT) {
+        report_title(w, NULL, ec->size);
+        report_table_head(w);
+        for (const LogEntry *e = entries_next(ec, &it); e; e = entries_next(ec, &it)) {
+            w->len += report_entry_row(report_row_space(w), e);
+        }
+        report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+    } else if (format == REPORT_CSV) {
+        report_write(w, "room,type,timestamp,value\n", 26);
+        return report_csv_entries(w, ec);
+    } else {
+        ExportHeader hdr = { .num_rooms = (uint32_t)rc->size, .num_entries = (uint32_t)ec->size };
+        memcpy(hdr.magic, EXPORT_MAGIC, sizeof hdr.magic);
+        report_write(w, &hdr, sizeof hdr);
+        for (int i = 0; i < rc->size; ++i) {
+            unsigned char len = (unsigned char)strnlen(rc->rooms[i]->name, MAX_STR - 1);
+            report_write(w, &len, 1);
+            report_write(w, rc->rooms[i]->name, len);
+        }
+        for (const LogEntry *e = entries_next(ec, &it); e; e = entries_next(ec, &it)) {
+            ExportEntry row = { (uint32_t)entry_room(e)->id, e->timestamp, entry_type(e), e->value };
+            report_write(w, &row, sizeof row);
+        }
+    }
+    return C_ERR_OK;
+}
+
+/* ---- report_retained -------------------------------------------------------
+   Purpose: Write the readings a retention store keeps, in the same tables
+            as report_entries (REPORT_TEXT) and report_room.
+   Params:
+     - w (in/out): writer
+     - rs (in): retention store
+     - rc (in): rooms
+     - room (in): one room's table, or NULL for the "All Log Entries" table
+   Returns: C_ERR_OK, C_ERR_NULL_PTR
+----------------------------------------------------------------------------- */
+int report_retained(ReportWriter *w, const RetentionStore *rs, const RoomCollection *rc, const Room *room) {
+    if (!w || !rs || !rc) return C_ERR_NULL_PTR;
+
+    long count = room ? retain_count(rs, room) : rs->size;
+    report_title(w, room, count);
+    if (room && count == 0) {
+        report_write(w, "No entries for this room.\n", 26);
+        return C_ERR_OK;
+    }
+    report_table_head(w);
+    RetainIter it;
+    LogEntry e;
+    retain_first(&it, room);
+    while (retain_next(rs, rc, &it, &e)) {
+        w->len += report_entry_row(report_row_space(w), &e);
+    }
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+    return C_ERR_OK;
+}
+
+// First position in a snapshot whose room ranks at or after `rank`; entries
+// are in entry_cmp order, so a room's entries are one run
+static int snapshot_lower_bound(const EntrySnapshot *snap, uint64_t rank) {
+    int lo = 0, hi = snap->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (entry_room(snap->entries[mid])->rank < rank) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* ---- report_snapshot -------------------------------------------------------
+   Purpose: Write the entries of a pinned snapshot (see ingest_snapshot) in
+            the same tables as report_entries (REPORT_TEXT) and report_room.
+            Reads only the snapshot and room names, so merges can go on.
+   Params:
+     - w (in/out): writer
+     - snap (in): snapshot
+     - room (in): one room's table, or NULL for the "All Log Entries" table
+   Returns: C_ERR_OK, C_ERR_NULL_PTR
+----------------------------------------------------------------------------- */
+int report_snapshot(ReportWriter *w, const EntrySnapshot *snap, const Room *room) {
+    if (!w || !snap) return C_ERR_NULL_PTR;
+
+    int from = 0, to = snap->size;
+    if (room) {
+        from = snapshot_lower_bound(snap, room->rank);
+        to = snapshot_lower_bound(snap, (uint64_t)room->rank + 1);
+    }
+    report_title(w, room, to - from);
+    if (room && from == to) {
+        report_write(w, "No entries for this room.\n", 26);
+        return C_ERR_OK;
+    }
+    report_table_head(w);
+    for (int i = from; i < to; ++i) {
+        w->len += report_entry_row(report_row_space(w), snap->entries[i]);
+    }
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+    return C_ERR_OK;
+}
+
+/* ---- report_scan -----------------------------------------------------------
+   Purpose: Format the entries of an open scan (see entries_scan_begin) as
+            the entries table, in the scan's timestamp order.
+   Params:
+     - w (in/out): writer
+     - scan (in/out): scan, read to its end
+     - count (out): number of entries written, or NULL
+   Returns: C_ERR_OK, C_ERR_NULL_PTR
+----------------------------------------------------------------------------- */
+int report_scan(ReportWriter *w, EntryScan *scan, long *count) {
+    if (!w || !scan) return C_ERR_NULL_PTR;
+
+    static const char title[] = "\n--- Entries by Time ---\n";
+    report_write(w, title, sizeof title - 1);
+    report_table_head(w);
+    long n = 0;
+    for (const LogEntry *e = entries_scan_next(scan); e; e = entries_scan_next(scan)) {
+        w->len += report_entry_row(report_row_space(w), e);
+        n++;
+    }
+    report_write(w, TABLE_RULE, sizeof TABLE_RULE - 1);
+    if (count) *count = n;
+    return C_ERR_OK;
+}
+
+/* ---- report_close ----------------------------------------------------------
+   Purpose: Write out what is left and release the writer.
+   Params:
+     - w (in/out): writer (reset)
+   Returns: C_ERR_OK, or C_ERR_IO if any write failed
+----------------------------------------------------------------------------- */
+int report_close(ReportWriter *w) {
+    if (!w) return C_ERR_NULL_PTR;
+    report_flush(w);
+    int result = w->error;
+    free(w->buf);
+    memset(w, 0, sizeof *w);
+    return result;
+}
@@ -0,0 +1,270 @@
+// retain.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Retention mode: the newest readings per (room, type) in fixed-size rings.
+   Each ring is kept sorted by timestamp, oldest at the head, so
+     - a reading newer than the rest (the usual case) is appended, O(1);
+     - eviction drops the head, O(1), and touches no other ring;
+     - a late reading is shifted into place within its own ring only.
+   The global sorted view needs no merge buffer: entry_cmp orders by room
+   name, then type, then timestamp, so walking the rooms in name order and
+   each room's three rings in type order yields the entries already sorted.
+   Equal timestamps keep the newest reading first, as entries_create does. */
+
+static RetainRing* retain_ring(const RetentionStore *rs, const Room *room, int type) {
+    if (room->id >= rs->num_rooms) return NULL;
+    return &rs->rings[room->id * 3 + type - 1];
+}
+
+// Slot of the ring's i-th oldest reading
+static RetainSlot* ring_at(const RetentionStore *rs, const RetainRing *ring, int i) {
+    int slot = ring->head + i;
+    if (slot >= rs->max_count) slot -= rs->max_count;
+    return &ring->slots[slot];
+}
+
+static void ring_pop(RetentionStore *rs, RetainRing *ring) {
+    ring->head = ring->head + 1 == rs->max_count ? 0 : ring->head + 1;
+    ring->size--;
+    rs->size--;
+    rs->evicted++;
+}
+
+/* ---- retain_init -----------------------------------------------------------
+   Purpose: Set up an empty retention store.
+   Params:
+     - rs (out): store, released with retain_free
+     - max_count (in): readings kept per room and type, 1..RETAIN_MAX_COUNT
+     - max_age (in): drop readings more than this older than the newest one
+                     of their room and type; 0 keeps them until the ring is full
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int retain_init(RetentionStore *rs, int max_count, int max_age) {
+    if (!rs) return C_ERR_NULL_PTR;
+    if (max_count < 1 || max_count > RETAIN_MAX_COUNT || max_age < 0) return C_ERR_INVALID;
+    memset(rs, 0, sizeof *rs);
+    rs->max_count = max_count;
+    rs->max_age = max_age;
+    return C_ERR_OK;
+}
+
+/* ---- retain_attach ---------------------------------------------------------
+   Purpose: Send every later insert into an (empty) entry collection to the
+            store instead; entries_create and entries_bulk_create then keep
+            nothing in the slab, order tree or room lists.
+   Params:
+     - rs (in/out): store
+     - ec (in/out): entry collection, still empty
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID if ec already has entries
+----------------------------------------------------------------------------- */
+int retain_attach(RetentionStore *rs, EntryCollection *ec) {
+    if (!rs || !ec) return C_ERR_NULL_PTR;
+    if (ec->size > 0) return C_ERR_INVALID;
+    ec->retain = rs;
+    return C_ERR_OK;
+}
+
+/* ---- retain_reserve --------------------------------------------------------
+   Purpose: Allocate the ring for a room and type, so retain_add for it
+            cannot fail.
+   Params:
+     - rs (in/out): store
+     - room (in): room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int retain_reserve(RetentionStore *rs, const Room *room, int type) {
+    if (!rs || !room) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION || room->id < 0) return C_ERR_INVALID;
+
+    // Ring headers for new rooms; existing rings' slots stay where they are
+    if (room->id >= rs->num_rooms) {
+        int num_rooms = rs->num_rooms ? rs->num_rooms : MAX_ARR;
+        while (num_rooms <= room->id) num_rooms *= 2;
+        RetainRing *rings = realloc(rs->rings, (size_t)num_rooms * 3 * sizeof *rings);
+        if (!rings) return C_ERR_NO_MEMORY;
+        memset(rings + rs->num_rooms * 3, 0, (size_t)(num_rooms - rs->num_rooms) * 3 * sizeof *rings);
+        rs->rings = rings;
+        rs->num_rooms = num_rooms;
+    }
+    RetainRing *ring = retain_ring(rs, room, type);
+    if (!ring->slots) {
+        ring->slots = malloc((size_t)rs->max_count * sizeof *ring->slots);
+        if (!ring->slots) return C_ERR_NO_MEMORY;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- retain_add ------------------------------------------------------------
+   Purpose: Keep a reading, evicting the oldest of its room and type when the
+            ring is full or readings have aged out. A reading older than
+            everything its full ring keeps (or than the age window) is
+            dropped straight away.
+   Params:
+     - rs (in/out): store
+     - room, type, value, timestamp (in): the entries_create arguments
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int retain_add(RetentionStore *rs, const Room *room, int type, ReadingValue value, int timestamp) {
+    int result = retain_reserve(rs, room, type);
+    if (result != C_ERR_OK) return result;
+    RetainRing *ring = retain_ring(rs, room, type);
+
+    if (ring->size > 0) {
+        long long newest = ring_at(rs, ring, ring->size - 1)->timestamp;
+        int too_old = rs->max_age > 0 && (long long)timestamp < newest - rs->max_age;
+        if (too_old || (ring->size == rs->max_count && timestamp <= ring_at(rs, ring, 0)->timestamp)) {
+            rs->evicted++;
+            return C_ERR_OK;
+        }
+        if (ring->size == rs->max_count) {
+            ring_pop(rs, ring);
+        }
+    }
+
+    // Append, shifting later (and equal) timestamps up one
+    int i = ring->size;
+    while (i > 0 && ring_at(rs, ring, i - 1)->timestamp >= timestamp) {
+        *ring_at(rs, ring, i) = *ring_at(rs, ring, i - 1);
+        i--;
+    }
+    *ring_at(rs, ring, i) = (RetainSlot){ timestamp, value };
+    ring->size++;
+    rs->size++;
+
+    // A new newest reading can push old ones out of the age window
+    if (rs->max_age > 0 && i == ring->size - 1) {
+        long long oldest_kept = (long long)timestamp - rs->max_age;
+        while (ring_at(rs, ring, 0)->timestamp < oldest_kept) {
+            ring_pop(rs, ring);
+        }
+    }
+    return C_ERR_OK;
+}
+
+/* ---- retain_count ----------------------------------------------------------
+   Purpose: Number of readings kept for a room, all types.
+   Params:
+     - rs (in): store
+     - room (in): room
+   Returns: the count (0 for NULL arguments)
+----------------------------------------------------------------------------- */
+int retain_count(const RetentionStore *rs, const Room *room) {
+    if (!rs || !room || room->id >= rs->num_rooms) return 0;
+    int count = 0;
+    for (int type = TYPE_TEMP; type <= TYPE_MOTION; ++type) {
+        count += retain_ring(rs, room, type)->size;
+    }
+    return count;
+}
+
+/* ---- retain_first / retain_next --------------------------------------------
+   Purpose: Walk the kept readings in entry_cmp order, for every room or one.
+   Params:
+     - it (out/in/out): iterator
+     - room (in): only this room's readings, or NULL for all of them
+     - rs (in): store
+     - rc (in): rooms, for name order
+     - out (out): the reading as a LogEntry (a copy; it is not in any slab)
+   Returns: retain_next: 1 if there was a reading, 0 at the end
+----------------------------------------------------------------------------- */
+void retain_first(RetainIter *it, const Room *room) {
+    it->room = room;
+    it->pos = 0;
+    it->type = TYPE_TEMP;
+    it->i = 0;
+}
+
+int retain_next(const RetentionStore *rs, const RoomCollection *rc, RetainIter *it, LogEntry *out) {
+    int num_positions = it->room ? 1 : rc->size;
+    while (it->pos < num_positions) {
+        Room *room = it->room ? (Room *)it->room : rc->rooms[rc->by_name[it->pos]];
+        const RetainRing *ring = room->id < rs->num_rooms ? retain_ring(rs, room, it->type) : NULL;
+        if (ring && it->i < ring->size) {
+            const RetainSlot *slot = ring_at(rs, ring, it->i++);
+            entry_set(out, room, it->type, slot->value, slot->timestamp);
+            return 1;
+        }
+        it->i = 0;
+        if (++it->type > TYPE_MOTION) {
+            it->type = TYPE_TEMP;
+            it->pos++;
+        }
+    }
+    return 0;
+}
+
+/* ---- retain_range_stats ----------------------------------------------------
+   Purpose: query_range_stats over the readings a room still keeps: a binary
+            search in the ring, then O(k) for k matches.
+   Params:
+     - rs (in): store
+     - room (in): room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - t_from, t_to (in): inclusive timestamp bounds
+     - out (out): result; min/max/sum are 0 when count is 0
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int retain_range_stats(const RetentionStore *rs, const Room *room, int type, int t_from, int t_to, ReadingStats *out) {
+    if (!rs || !room || !out) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    memset(out, 0, sizeof *out);
+    const RetainRing *ring = retain_ring(rs, room, type);
+    if (!ring) return C_ERR_OK;
+    int lo = 0, hi = ring->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ring_at(rs, ring, mid)->timestamp < t_from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (int i = lo; i < ring->size; ++i) {
+        const RetainSlot *slot = ring_at(rs, ring, i);
+        if (slot->timestamp > t_to) break;
+        double x = reading_numeric(type, slot->value);
+        if (out->count == 0 || x < out->min) out->min = x;
+        if (out->count == 0 || x > out->max) out->max = x;
+        out->sum += x;
+        out->count++;
+    }
+    return C_ERR_OK;
+}
+
+/* ---- retain_bytes ----------------------------------------------------------
+   Purpose: Bytes held by the store: ring headers and allocated rings.
+   Params:
+     - rs (in): store
+   Returns: the byte count
+----------------------------------------------------------------------------- */
+size_t retain_bytes(const RetentionStore *rs) {
+    if (!rs) return 0;
+    size_t bytes = (size_t)rs->num_rooms * 3 * sizeof *rs->rings;
+    for (int i = 0; i < rs->num_rooms * 3; ++i) {
+        if (rs->rings[i].slots) {
+            bytes += (size_t)rs->max_count * sizeof(RetainSlot);
+        }
+    }
+    return bytes;
+}
+
+/* ---- retain_free -----------------------------------------------------------
+   Purpose: Release every ring and reset the store to empty (same limits).
+   Params:
+     - rs (in/out): store
+----------------------------------------------------------------------------- */
+void retain_free(RetentionStore *rs) {
+    if (!rs) return;
+    for (int i = 0; i < rs->num_rooms * 3; ++i) {
+        free(rs->rings[i].slots);
+    }
+    free(rs->rings);
+    rs->rings = NULL;
+    rs->num_rooms = 0;
+    rs->size = 0;
+    rs->evicted = 0;
+}
@@ -0,0 +1,333 @@
+// rollup.c
+
+#include "defs.h"
+#include <stdlib.h>
+
+/* Rollups of TEMP and DB readings: per room, type and resolution, the
+   count/min/max/sum of every minute, hour and day bucket that has readings,
+   sorted by bucket. An insert updates one bucket per resolution, found by a
+   binary search (usually it is the last one); a late reading updates an
+   older bucket, or opens one in the middle of the series. A range query
+   takes whole days from the day series, whole hours at the edges from the
+   hour series, then whole minutes, and reads only the last partial minute
+   at each edge from the room's entry list, so it touches O(buckets)
+   instead of O(entries).
+   A series whose memory could not grow is marked stale and queries fall
+   back to the entry list until a bulk insert rebuilds it. */
+
+static const int ROLLUP_WIDTH[ROLLUP_LEVELS] = { ROLLUP_MINUTE, ROLLUP_HOUR, ROLLUP_DAY };
+
+// Series of one room, type (TEMP or DB) and level
+static RollupSeries* rollup_series(const RollupStore *rs, const Room *room, int type, int level) {
+    if (room->id < 0 || room->id >= rs->num_rooms) return NULL;
+    return &rs->series[(room->id * 2 + type - 1) * ROLLUP_LEVELS + level];
+}
+
+// floor(a / b) for b > 0, also for negative a
+static long long floor_div(long long a, long long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// First bucket in the series not before `bucket`
+static int series_lower_bound(const RollupSeries *s, long long bucket) {
+    int lo = 0, hi = s->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (s->buckets[mid].bucket < bucket) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int series_grow(RollupSeries *s, int needed) {
+    if (needed <= s->capacity) {
+        return C_ERR_OK;
+    }
+    int capacity = s->capacity ? s->capacity : MAX_ARR;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    RollupBucket *buckets = realloc(s->buckets, (size_t)capacity * sizeof *buckets);
+    if (!buckets) return C_ERR_NO_MEMORY;
+    s->buckets = buckets;
+    s->capacity = capacity;
+    return C_ERR_OK;
+}
+
+static void stats_add(ReadingStats *st, double x) {
+    if (st->count == 0 || x < st->min) st->min = x;
+    if (st->count == 0 || x > st->max) st->max = x;
+    st->sum += x;
+    st->count++;
+}
+
+static void stats_merge(ReadingStats *st, const ReadingStats *part) {
+    if (part->count == 0) return;
+    if (st->count == 0 || part->min < st->min) st->min = part->min;
+    if (st->count == 0 || part->max > st->max) st->max = part->max;
+    st->sum += part->sum;
+    st->count += part->count;
+}
+
+// Add x to bucket `bucket` of a series that has room for one more bucket
+static void series_add(RollupSeries *s, int bucket, double x) {
+    int pos = s->size;
+    if (pos == 0 || s->buckets[pos - 1].bucket < bucket) {
+        // the common case: a new bucket at the end
+    } else if (s->buckets[pos - 1].bucket == bucket) {
+        pos--;
+    } else {
+        pos = series_lower_bound(s, bucket);
+    }
+    RollupBucket *b = &s->buckets[pos];
+    if (pos == s->size || b->bucket != bucket) {
+        memmove(b + 1, b, (size_t)(s->size - pos) * sizeof *b);
+        memset(b, 0, sizeof *b);
+        b->bucket = bucket;
+        s->size++;
+    }
+    stats_add(&b->stats, x);
+}
+
+/* ---- rollup_reserve --------------------------------------------------------
+   Purpose: Make room for `extra` more buckets in each of a room's series, so
+            that rollup_add for that many readings cannot fail.
+   Params:
+     - rs (in/out): rollup store
+     - room (in): room
+     - extra (in): readings about to be added (0 just sets up the room)
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int rollup_reserve(RollupStore *rs, const Room *room, int extra) {
+    if (!rs || !room) return C_ERR_NULL_PTR;
+    if (room->id < 0 || extra < 0) return C_ERR_INVALID;
+
+    if (room->id >= rs->num_rooms) {
+        int num_rooms = rs->num_rooms ? rs->num_rooms : MAX_ARR;
+        while (num_rooms <= room->id) num_rooms *= 2;
+        size_t per_room = 2 * ROLLUP_LEVELS;
+        RollupSeries *series = realloc(rs->series, (size_t)num_rooms * per_room * sizeof *series);
+        if (!series) return C_ERR_NO_MEMORY;
+        memset(series + rs->num_rooms * per_room, 0, (size_t)(num_rooms - rs->num_rooms) * per_room * sizeof *series);
+        rs->series = series;
+        rs->num_rooms = num_rooms;
+    }
+    for (int type = TYPE_TEMP; type <= TYPE_DB; ++type) {
+        for (int level = 0; level < ROLLUP_LEVELS; ++level) {
+            RollupSeries *s = rollup_series(rs, room, type, level);
+            if (series_grow(s, s->size + extra) != C_ERR_OK) {
+                return C_ERR_NO_MEMORY;
+            }
+        }
+    }
+    return C_ERR_OK;
+}
+
+/* ---- rollup_add ------------------------------------------------------------
+   Purpose: Count one reading in its minute, hour and day buckets. Motion
+            readings are not rolled up and are ignored.
+   Params:
+     - rs (in/out): rollup store
+     - room, type, value, timestamp (in): the entries_create arguments
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int rollup_add(RollupStore *rs, const Room *room, int type, ReadingValue value, int timestamp) {
+    if (type == TYPE_MOTION) return C_ERR_OK;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+    int result = rollup_reserve(rs, room, 1);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    double x = reading_numeric(type, value);
+    for (int level = 0; level < ROLLUP_LEVELS; ++level) {
+        RollupSeries *s = rollup_series(rs, room, type, level);
+        if (!s->stale) {
+            series_add(s, (int)floor_div(timestamp, ROLLUP_WIDTH[level]), x);
+        }
+    }
+    return C_ERR_OK;
+}
+
+/* ---- rollup_rebuild_room ---------------------------------------------------
+   Purpose: Recompute a room's series from its (sorted) entry list, after a
+            bulk insert rewrote it. Each series is then built by appends
+            only. A series that cannot grow is left stale.
+   Params:
+     - rs (in/out): rollup store
+     - room (in): room, set up with rollup_reserve
+----------------------------------------------------------------------------- */
+void rollup_rebuild_room(RollupStore *rs, const Room *room) {
+    if (!rs || !room || room->id >= rs->num_rooms) return;
+
+    for (int type = TYPE_TEMP; type <= TYPE_DB; ++type) {
+        for (int level = 0; level < ROLLUP_LEVELS; ++level) {
+            RollupSeries *s = rollup_series(rs, room, type, level);
+            s->size = 0;
+            s->stale = 0;
+        }
+    }
+    for (int i = 0; i < room->size; ++i) {
+        const LogEntry *e = room->entries[i];
+        int type = entry_type(e);
+        if (type == TYPE_MOTION) break; // motion readings sort last
+        double x = reading_numeric(type, e->value);
+        for (int level = 0; level < ROLLUP_LEVELS; ++level) {
+            RollupSeries *s = rollup_series(rs, room, type, level);
+            if (s->stale) continue;
+            if (series_grow(s, s->size + 1) != C_ERR_OK) {
+                s->stale = 1;
+                continue;
+            }
+            series_add(s, (int)floor_div(e->timestamp, ROLLUP_WIDTH[level]), x);
+        }
+    }
+}
+
+/* ---- rollup_attach ---------------------------------------------------------
+   Purpose: Build rollups for the entries already in a collection and attach
+            the store, so every later insert updates it as well.
+   Params:
+     - rs (in/out): rollup store (its previous contents are discarded)
+     - ec (in/out): entry collection
+     - rc (in): the rooms of its entries
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int rollup_attach(RollupStore *rs, EntryCollection *ec, const RoomCollection *rc) {
+    if (!rs || !ec || !rc) return C_ERR_NULL_PTR;
+
+    rollup_free(rs);
+    for (int r = 0; r < rc->size; ++r) {
+        int result = rollup_reserve(rs, rc->rooms[r], 0);
+        if (result != C_ERR_OK) {
+            return result;
+        }
+        rollup_rebuild_room(rs, rc->rooms[r]);
+    }
+    ec->rollups = rs;
+    return C_ERR_OK;
+}
+
+/* ---- rollup_buckets --------------------------------------------------------
+   Purpose: The buckets of one resolution that start in [t_from, t_to], for
+            charting a series; they stay valid until the next insert.
+   Params:
+     - rs (in): rollup store
+     - room (in): room
+     - type (in): TYPE_TEMP|TYPE_DB
+     - level (in): ROLLUP_LEVEL_MINUTE|_HOUR|_DAY
+     - t_from, t_to (in): inclusive timestamp bounds
+     - first (out): first bucket (bucket * width is its first timestamp)
+     - n (out): number of buckets
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID (also for a stale series)
+----------------------------------------------------------------------------- */
+int rollup_buckets(const RollupStore *rs, const Room *room, int type, int level, int t_from, int t_to,
+                   const RollupBucket **first, int *n) {
+    if (!rs || !room || !first || !n) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_DB || level < 0 || level >= ROLLUP_LEVELS) return C_ERR_INVALID;
+
+    *first = NULL;
+    *n = 0;
+    const RollupSeries *s = rollup_series(rs, room, type, level);
+    if (!s) return C_ERR_OK;
+    if (s->stale) return C_ERR_INVALID;
+    int width = ROLLUP_WIDTH[level];
+    int lo = series_lower_bound(s, floor_div((long long)t_from + width - 1, width));
+    int hi = series_lower_bound(s, floor_div(t_to, width) + 1);
+    *first = s->buckets + lo;
+    *n = hi > lo ? hi - lo : 0;
+    return C_ERR_OK;
+}
+
+// Stats of [lo, hi) (exclusive end, 64-bit so hi can pass INT_MAX) from the
+// series at `level` and below, and the entry list for what is left over
+static void rollup_cover(const RollupStore *rs, const Room *room, int type, int level,
+                         long long lo, long long hi, ReadingStats *out) {
+    if (lo >= hi) return;
+    if (level < 0) {
+        ReadingStats part;
+        query_range_stats(room, type, (int)lo, (int)(hi - 1), &part);
+        stats_merge(out, &part);
+        return;
+    }
+
+    long long width = ROLLUP_WIDTH[level];
+    long long a = floor_div(lo + width - 1, width); // first whole bucket
+    long long b = floor_div(hi, width);             // one past the last
+    if (a >= b) {
+        rollup_cover(rs, room, type, level - 1, lo, hi, out);
+        return;
+    }
+    const RollupSeries *s = rollup_series(rs, room, type, level);
+    for (int i = series_lower_bound(s, a); i < s->size && s->buckets[i].bucket < b; ++i) {
+        stats_merge(out, &s->buckets[i].stats);
+    }
+    rollup_cover(rs, room, type, level - 1, lo, a * width, out);
+    rollup_cover(rs, room, type, level - 1, b * width, hi, out);
+}
+
+/* ---- rollup_range_stats ----------------------------------------------------
+   Purpose: query_range_stats for TEMP and DB readings, from the rollups:
+            whole days, hours and minutes come from their buckets and only
+            the partial minutes at the edges from the entry list. Falls back
+            to query_range_stats for motion readings and stale series.
+            The sum may differ from query_range_stats in the last bits,
+            since it adds the values in a different order.
+   Params:
+     - rs (in): rollup store
+     - room (in): room
+     - type (in): TYPE_TEMP|TYPE_DB|TYPE_MOTION
+     - t_from, t_to (in): inclusive timestamp bounds
+     - out (out): result; min/max/sum are 0 when count is 0
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID
+----------------------------------------------------------------------------- */
+int rollup_range_stats(const RollupStore *rs, const Room *room, int type, int t_from, int t_to, ReadingStats *out) {
+    if (!rs || !room || !out) return C_ERR_NULL_PTR;
+    if (type < TYPE_TEMP || type > TYPE_MOTION) return C_ERR_INVALID;
+
+    int stale = type == TYPE_MOTION || room->id >= rs->num_rooms;
+    for (int level = 0; !stale && level < ROLLUP_LEVELS; ++level) {
+        stale = rollup_series(rs, room, type, level)->stale;
+    }
+    if (stale) {
+        return query_range_stats(room, type, t_from, t_to, out);
+    }
+
+    memset(out, 0, sizeof *out);
+    rollup_cover(rs, room, type, ROLLUP_LEVELS - 1, t_from, (long long)t_to + 1, out);
+    return C_ERR_OK;
+}
+
+/* ---- rollup_bytes ----------------------------------------------------------
+   Purpose: Memory held by the store (by capacity, not size).
+   Params:
+     - rs (in): rollup store
+   Returns: bytes allocated
+----------------------------------------------------------------------------- */
+size_t rollup_bytes(const RollupStore *rs) {
+    if (!rs) return 0;
+    int num_series = rs->num_rooms * 2 * ROLLUP_LEVELS;
+    size_t bytes = (size_t)num_series * sizeof *rs->series;
+    for (int i = 0; i < num_series; ++i) {
+        bytes += (size_t)rs->series[i].capacity * sizeof(RollupBucket);
+    }
+    return bytes;
+}
+
+/* ---- rollup_free -----------------------------------------------------------
+   Purpose: Release every series and reset the store to empty. An attached
+            store stays attached.
+   Params:
+     - rs (in/out): rollup store
+----------------------------------------------------------------------------- */
+void rollup_free(RollupStore *rs) {
+    if (!rs) return;
+    for (int i = 0; i < rs->num_rooms * 2 * ROLLUP_LEVELS; ++i) {
+        free(rs->series[i].buckets);
+    }
+    free(rs->series);
+    memset(rs, 0, sizeof *rs);
+}
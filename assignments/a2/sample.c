@@ -0,0 +1,175 @@
+// sample.c
+
+#include "defs.h"
+
+/* loader.o only knows the original fixed-capacity structs, so these wrappers
+   copy between those and the real collections. The copies are small
+   (MAX_ARR of each) and only used for sample data and the provided tests. */
+
+// Position of `e` in the loader copy of the entries, or -1 if it is not there.
+static int loader_index_of(const EntryCollection *ec, const LogEntry *e) {
+    BTreeIter it;
+    btree_first(&ec->order, &it);
+    for (int i = 0; i < ec->size; ++i) {
+        if (entries_next(ec, &it) == e) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Index of `room` in the loader copy of the rooms. Without a RoomCollection to
+// mirror, rooms are copied (name only) the first time an entry refers to them.
+static int loader_room_index(const RoomCollection *rc, LoaderRoomCollection *lrc,
+                             const Room **seen, const Room *room) {
+    if (rc) {
+        return (room->id >= 0 && room->id < rc->size && rc->rooms[room->id] == room) ? room->id : -1;
+    }
+    for (int i = 0; i < lrc->size; ++i) {
+        if (seen[i] == room) {
+            return i;
+        }
+    }
+    if (lrc->size >= MAX_ARR) {
+        return -1;
+    }
+    seen[lrc->size] = room;
+    strncpy(lrc->rooms[lrc->size].name, room->name, MAX_STR - 1);
+    lrc->rooms[lrc->size].name[MAX_STR - 1] = '\0';
+    lrc->rooms[lrc->size].size = 0;
+    return lrc->size++;
+}
+
+// Copy the entries (in sorted order) into the loader layout, and the rooms
+// in `rc` (if any) index for index, with every pointer translated.
+static int loader_export(const EntryCollection *ec, const RoomCollection *rc,
+                         LoaderEntryCollection *lec, LoaderRoomCollection *lrc) {
+    const Room *seen[MAX_ARR];
+
+    if (ec->size > MAX_ARR || (rc && rc->size > MAX_ARR)) {
+        return C_ERR_FULL_ARRAY;
+    }
+
+    lrc->size = rc ? rc->size : 0;
+    lec->size = ec->size;
+    BTreeIter it;
+    btree_first(&ec->order, &it);
+    for (int i = 0; i < ec->size; ++i) {
+        const LogEntry *e = entries_next(ec, &it);
+        lec->entries[i].data.type = entry_type(e);
+        lec->entries[i].data.value = e->value;
+        lec->entries[i].timestamp = e->timestamp;
+        lec->entries[i].room = NULL;
+        if (entry_room(e)) {
+            int idx = loader_room_index(rc, lrc, seen, entry_room(e));
+            lec->entries[i].room = idx >= 0 ? &lrc->rooms[idx] : NULL;
+        }
+    }
+
+    if (!rc) {
+        return C_ERR_OK;
+    }
+
+    for (int i = 0; i < rc->size; ++i) {
+        const Room *r = rc->rooms[i];
+        LoaderRoom *lr = &lrc->rooms[i];
+        if (r->size > MAX_ARR) {
+            return C_ERR_FULL_ARRAY;
+        }
+        strncpy(lr->name, r->name, MAX_STR - 1);
+        lr->name[MAX_STR - 1] = '\0';
+        lr->size = r->size;
+        for (int j = 0; j < r->size; ++j) {
+            int idx = loader_index_of(ec, r->entries[j]);
+            lr->entries[j] = idx >= 0 ? &lec->entries[idx] : NULL;
+        }
+    }
+    return C_ERR_OK;
+}
+
+/* ---- sample_load -----------------------------------------------------------
+   Purpose: Replace the contents of the collections with loader sample data.
+   Params:
+     - rc (out): room collection
+     - ec (out): entry collection
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, or the first error from rooms_add/entries_bulk_create
+----------------------------------------------------------------------------- */
+int sample_load(RoomCollection *rc, EntryCollection *ec) {
+    if (!rc || !ec) {
+        return C_ERR_NULL_PTR;
+    }
+
+    LoaderRoomCollection  lrc = { .size = 0 };
+    LoaderEntryCollection lec = { .size = 0 };
+    int result = load_sample(&lrc, &lec);
+    if (result != C_ERR_OK) {
+        return result;
+    }
+
+    entries_free(ec);
+    rooms_free(rc);
+
+    // Rooms first, so the copied room i is the loader's room i
+    for (int i = 0; i < lrc.size; ++i) {
+        result = rooms_add(rc, lrc.rooms[i].name);
+        if (result != C_ERR_OK) {
+            return result;
+        }
+    }
+    EntryInput batch[MAX_ARR];
+    for (int i = 0; i < lec.size; ++i) {
+        const LoaderEntry *le = &lec.entries[i];
+        batch[i].room = rc->rooms[le->room - lrc.rooms];
+        batch[i].type = le->data.type;
+        batch[i].value = le->data.value;
+        batch[i].timestamp = le->timestamp;
+    }
+    return entries_bulk_create(ec, rc, batch, lec.size);
+}
+
+/* ---- sample_test_order -----------------------------------------------------
+   Purpose: Run loader_test_order over the entries.
+   Params:
+     - ec (in): entry collection
+     - verbose (in): passed through to the loader
+   Returns: loader_test_order's result, C_ERR_NULL_PTR, or C_ERR_FULL_ARRAY
+            if there are more entries than the loader layout holds
+----------------------------------------------------------------------------- */
+int sample_test_order(const EntryCollection *ec, int verbose) {
+    if (!ec) {
+        return C_ERR_NULL_PTR;
+    }
+
+    LoaderEntryCollection lec = { .size = 0 };
+    LoaderRoomCollection  lrc = { .size = 0 };
+    int result = loader_export(ec, NULL, &lec, &lrc);
+    if (result != C_ERR_OK) {
+        printf("[ORDER] %d entries do not fit the loader's %d-entry layout.\n", ec->size, MAX_ARR);
+        return result;
+    }
+    return loader_test_order(&lec, verbose);
+}
+
+/* ---- sample_test_rooms -----------------------------------------------------
+   Purpose: Run loader_test_rooms over the rooms and entries.
+   Params:
+     - ec (in): entry collection
+     - rc (in): room collection
+     - verbose (in): passed through to the loader
+   Returns: loader_test_rooms's result, C_ERR_NULL_PTR, or C_ERR_FULL_ARRAY
+            if the data does not fit the loader layout
+----------------------------------------------------------------------------- */
+int sample_test_rooms(const EntryCollection *ec, const RoomCollection *rc, int verbose) {
+    if (!ec || !rc) {
+        return C_ERR_NULL_PTR;
+    }
+
+    LoaderEntryCollection lec = { .size = 0 };
+    LoaderRoomCollection  lrc = { .size = 0 };
+    int result = loader_export(ec, rc, &lec, &lrc);
+    if (result != C_ERR_OK) {
+        printf("[ROOMS] Collections do not fit the loader's %d-element layout.\n", MAX_ARR);
+        return result;
+    }
+    return loader_test_rooms(&lec, &lrc, verbose);
+}
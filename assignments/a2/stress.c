@@ -0,0 +1,174 @@
+// stress.c
+//
+// Concurrent ingestion stress test: N producer threads submit readings for
+// random rooms through ingest.c while one reader thread keeps checking that
+// what it sees between ingest_read_begin/end is consistent, and another checks
+// pinned snapshots (ingest_snapshot) without holding up merges. Runs for 1, 2, 4, ...
+// up to the number of cores (or argv[1]) producers and prints throughput.
+// Not part of the a2 program; build with
+//   gcc -O2 -Wall -pthread stress.c ingest.c manager.c btree.c intern.c columns.c query.c report.c check.c retain.c motion.c rollup.c index.c -o stress
+// and run as ./stress [max_threads] [readings_per_thread]
+
+#include "defs.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STRESS_ROOMS 64
+
+typedef struct {
+    Ingest         *in;
+    RoomCollection *rc;
+    int             id;
+    int             count;
+} Producer;
+
+typedef struct {
+    Ingest                *in;
+    const EntryCollection *ec;
+    RoomCollection        *rc;
+    CheckState             check;
+    atomic_int            *done;
+    long                   snapshots;
+    int                    errors;
+    int                    last_size;  /* snapshot reader: size of the previous version */
+} Reader;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* produce(void *arg) {
+    Producer *p = arg;
+    unsigned int seed = 2401u + p->id;
+    for (int i = 0; i < p->count; ++i) {
+        // The value identifies the reading, so the final check can find every one
+        ReadingValue value = { .decibels = p->id * p->count + i };
+        Room *room = p->rc->rooms[rand_r(&seed) % STRESS_ROOMS];
+        while (ingest_submit(p->in, room, TYPE_DB, value, (int)(rand_r(&seed) % 100000)) == C_ERR_NO_MEMORY) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void* read_loop(void *arg) {
+    Reader *r = arg;
+    while (!atomic_load(r->done)) {
+        ingest_read_begin(r->in);
+        // What the merger added since the last view, and now and then everything
+        int result = r->snapshots % 64 == 0 ? check_full(&r->check, r->ec, r->rc, CHECK_ORDER | CHECK_ROOMS)
+                                             : check_incremental(&r->check, r->ec, r->rc);
+        if (result != C_ERR_OK) {
+            r->errors++;
+        }
+        ingest_read_end(r->in);
+        r->snapshots++;
+    }
+    return NULL;
+}
+
+// Versions only ever grow, and each one is in order
+static void* snapshot_loop(void *arg) {
+    Reader *r = arg;
+    while (!atomic_load(r->done)) {
+        const EntrySnapshot *snap = ingest_snapshot(r->in);
+        if (check_snapshot(&r->check, snap, r->rc) != C_ERR_OK || snap->size < r->last_size) {
+            r->errors++;
+        }
+        r->last_size = snap->size;
+        ingest_release(snap);
+        r->snapshots++;
+    }
+    return NULL;
+}
+
+static void run(int threads, int per_thread) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    char name[MAX_STR];
+    for (int r = 0; r < STRESS_ROOMS; ++r) {
+        snprintf(name, MAX_STR, "Room %02d", r);
+        rooms_add(&rc, name);
+    }
+
+    Ingest *in = ingest_start(&rc, &ec);
+    if (!in) {
+        printf("ingest_start failed\n");
+        exit(1);
+    }
+    atomic_int done;
+    atomic_init(&done, 0);
+    Reader reader = { .in = in, .ec = &ec, .rc = &rc, .done = &done };
+    Reader snapshot_reader = { .in = in, .ec = &ec, .rc = &rc, .done = &done };
+    pthread_t reader_thread, snapshot_thread;
+    pthread_create(&reader_thread, NULL, read_loop, &reader);
+    pthread_create(&snapshot_thread, NULL, snapshot_loop, &snapshot_reader);
+
+    Producer *producers = malloc(threads * sizeof *producers);
+    pthread_t *tids = malloc(threads * sizeof *tids);
+    double start = now_sec();
+    for (int t = 0; t < threads; ++t) {
+        producers[t] = (Producer){ .in = in, .rc = &rc, .id = t, .count = per_thread };
+        pthread_create(&tids[t], NULL, produce, &producers[t]);
+    }
+    for (int t = 0; t < threads; ++t) {
+        pthread_join(tids[t], NULL);
+    }
+    double submitted = now_sec() - start;
+    int result = ingest_flush(in);
+    double merged = now_sec() - start;
+
+    atomic_store(&done, 1);
+    pthread_join(reader_thread, NULL);
+    pthread_join(snapshot_thread, NULL);
+    // A version pinned after the flush has everything, and outlives the merger
+    const EntrySnapshot *last = ingest_snapshot(in);
+    if (ingest_stop(in) != C_ERR_OK) {
+        result = C_ERR_NO_MEMORY;
+    }
+
+    // Every reading exactly once, and the final state in order
+    long total = (long)threads * per_thread;
+    unsigned char *seen = calloc(total, 1);
+    int missing = ec.size != total;
+    for (EntryHandle h = 0; h < ec.size && !missing; ++h) {
+        int v = entries_get(&ec, h)->value.decibels;
+        missing = v < 0 || v >= total || seen[v]++;
+    }
+    CheckState final = { .has_run = 0 };
+    int ok = result == C_ERR_OK && !missing && reader.errors == 0 && snapshot_reader.errors == 0 &&
+             check_full(&final, &ec, &rc, CHECK_ORDER | CHECK_ROOMS) == C_ERR_OK &&
+             last->size == total && check_snapshot(&final, last, &rc) == C_ERR_OK;
+    ingest_release(last);
+
+    printf("%-8d | %-14.2f | %-14.2f | %-14ld | %-14ld | %s\n", threads, total / submitted / 1e6,
+           total / merged / 1e6, reader.snapshots, snapshot_reader.snapshots, ok ? "ok" : "FAILED");
+
+    free(seen);
+    free(producers);
+    free(tids);
+    entries_free(&ec);
+    rooms_free(&rc);
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int per_thread = argc > 2 ? atoi(argv[2]) : 200000;
+    if (max_threads < 1) max_threads = 1;
+    if (per_thread < 1) per_thread = 1;
+
+    printf("%-8s | %-14s | %-14s | %-14s | %-14s | %s\n", "threads", "submit M/s", "merged M/s", "reader views",
+           "snapshot views", "check");
+    printf("---------|----------------|----------------|----------------|----------------|------\n");
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        run(threads, per_thread);
+    }
+    run(max_threads, per_thread);
+    return 0;
+}
@@ -0,0 +1,199 @@
+// workload.c
+
+#include "defs.h"
+#include <math.h>
+#include <stdlib.h>
+
+/* Seeded synthetic workloads for benchmarking: room names, then a stream of
+   readings with a chosen type mix, timestamp order and room popularity. The
+   generator has its own PRNG (splitmix64), so a seed gives the same workload
+   on every machine and C library. */
+
+#define WORKLOAD_BURST_MAX  64     /* readings per burst in WORKLOAD_BURSTY */
+#define WORKLOAD_BURST_GAP  1000   /* timestamp gap between bursts */
+
+static uint64_t workload_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, bound)
+static int workload_below(uint64_t *state, int bound) {
+    return (int)((workload_next(state) >> 11) * (1.0 / 9007199254740992.0) * bound);
+}
+
+// Uniform in [0, 1)
+static double workload_unit(uint64_t *state) {
+    return (workload_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Cumulative popularity of the rooms: room k (after a seeded shuffle, so
+// the popular rooms are not simply the first names) has weight 1/(k+1)^s.
+static double* workload_zipf_cdf(int num_rooms, double s, int *by_rank, uint64_t *state) {
+    double *cdf = malloc(num_rooms * sizeof *cdf);
+    if (!cdf) return NULL;
+    for (int i = 0; i < num_rooms; ++i) {
+        by_rank[i] = i;
+    }
+    for (int i = num_rooms - 1; i > 0; --i) {
+        int j = workload_below(state, i + 1);
+        int swap = by_rank[i];
+        by_rank[i] = by_rank[j];
+        by_rank[j] = swap;
+    }
+    double total = 0.0;
+    for (int k = 0; k < num_rooms; ++k) {
+        total += s == 0.0 ? 1.0 : pow(k + 1, -s);
+        cdf[k] = total;
+    }
+    for (int k = 0; k < num_rooms; ++k) {
+        cdf[k] /= total;
+    }
+    return cdf;
+}
+
+// A room drawn by popularity: binary search of a uniform draw in the CDF
+static int workload_room(const double *cdf, const int *by_rank, int num_rooms, uint64_t *state) {
+    double u = workload_unit(state);
+    int lo = 0, hi = num_rooms - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cdf[mid] <= u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return by_rank[lo];
+}
+
+static int workload_type(const int mix[3], int mix_total, uint64_t *state) {
+    int pick = workload_below(state, mix_total);
+    if (pick < mix[0]) return TYPE_TEMP;
+    if (pick < mix[0] + mix[1]) return TYPE_DB;
+    return TYPE_MOTION;
+}
+
+static ReadingValue workload_value(int type, uint64_t *state) {
+    ReadingValue value;
+    switch (type) {
+        case TYPE_TEMP:
+            value.temperature = (workload_below(state, 5001) - 1000) / 100.0f; // -10.00 .. 40.00
+            break;
+        case TYPE_DB:
+            value.decibels = 20 + workload_below(state, 101);
+            break;
+        default: {
+            int bits = workload_below(state, 8);
+            value.motion[0] = (bits & MOTION_LEFT) != 0;
+            value.motion[1] = (bits & MOTION_FORWARD) != 0;
+            value.motion[2] = (bits & MOTION_RIGHT) != 0;
+        }
+    }
+    return value;
+}
+
+/* ---- workload_generate -----------------------------------------------------
+   Purpose: Generate a workload from a spec. The same spec (seed included)
+            always gives the same workload.
+   Params:
+     - spec (in): room and entry counts, type mix, timestamp order, Zipf
+                  exponent for room popularity (0 = uniform) and seed
+     - wl (out): the generated workload, released with workload_free
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_INVALID (bad counts, mix or
+            order), C_ERR_NO_MEMORY
+----------------------------------------------------------------------------- */
+int workload_generate(const WorkloadSpec *spec, Workload *wl) {
+    if (!spec || !wl) return C_ERR_NULL_PTR;
+    memset(wl, 0, sizeof *wl);
+    int mix_total = spec->mix[0] + spec->mix[1] + spec->mix[2];
+    if (spec->num_rooms < 1 || spec->num_entries < 0 || spec->zipf < 0.0 ||
+        spec->mix[0] < 0 || spec->mix[1] < 0 || spec->mix[2] < 0 || mix_total <= 0 ||
+        spec->order < WORKLOAD_SORTED || spec->order > WORKLOAD_BURSTY) {
+        return C_ERR_INVALID;
+    }
+
+    uint64_t state = spec->seed;
+    wl->names = malloc(spec->num_rooms * sizeof *wl->names);
+    wl->entries = malloc((spec->num_entries ? spec->num_entries : 1) * sizeof *wl->entries);
+    int *by_rank = malloc(spec->num_rooms * sizeof *by_rank);
+    double *cdf = by_rank ? workload_zipf_cdf(spec->num_rooms, spec->zipf, by_rank, &state) : NULL;
+    if (!wl->names || !wl->entries || !cdf) {
+        free(by_rank);
+        free(cdf);
+        workload_free(wl);
+        return C_ERR_NO_MEMORY;
+    }
+
+    wl->num_rooms = spec->num_rooms;
+    for (int r = 0; r < spec->num_rooms; ++r) {
+        snprintf(wl->names[r], MAX_STR, "Room %05d", r);
+    }
+
+    int n = spec->num_entries;
+    int burst_left = 0, burst_room = 0, clock = 0;
+    for (int i = 0; i < n; ++i) {
+        WorkloadEntry *e = &wl->entries[i];
+        if (spec->order == WORKLOAD_BURSTY) {
+            // One room reports a run of readings close together, then a quiet gap
+            if (burst_left == 0) {
+                burst_left = 1 + workload_below(&state, WORKLOAD_BURST_MAX);
+                burst_room = workload_room(cdf, by_rank, spec->num_rooms, &state);
+                clock += WORKLOAD_BURST_GAP;
+            }
+            burst_left--;
+            e->room = burst_room;
+            e->timestamp = clock++;
+        } else {
+            e->room = workload_room(cdf, by_rank, spec->num_rooms, &state);
+            switch (spec->order) {
+                case WORKLOAD_SORTED:   e->timestamp = i; break;
+                case WORKLOAD_REVERSED: e->timestamp = n - 1 - i; break;
+                default:                e->timestamp = workload_below(&state, n > 0 ? n : 1); break;
+            }
+        }
+        e->type = workload_type(spec->mix, mix_total, &state);
+        e->value = workload_value(e->type, &state);
+    }
+    wl->num_entries = n;
+
+    free(by_rank);
+    free(cdf);
+    return C_ERR_OK;
+}
+
+/* ---- workload_write_csv ----------------------------------------------------
+   Purpose: Write a workload in the CSV form `a2 --batch` reads.
+   Params:
+     - wl (in): workload
+     - out (in/out): stream to write to
+   Returns: C_ERR_OK, C_ERR_NULL_PTR, C_ERR_IO
+----------------------------------------------------------------------------- */
+int workload_write_csv(const Workload *wl, FILE *out) {
+    if (!wl || !out) return C_ERR_NULL_PTR;
+    fprintf(out, "room,type,timestamp,value\n");
+    for (int i = 0; i < wl->num_entries; ++i) {
+        const WorkloadEntry *e = &wl->entries[i];
+        fprintf(out, "%s,%d,%d,", wl->names[e->room], e->type, e->timestamp);
+        switch (e->type) {
+            case TYPE_TEMP: fprintf(out, "%.2f\n", e->value.temperature); break;
+            case TYPE_DB:   fprintf(out, "%d\n", e->value.decibels); break;
+            default:        fprintf(out, "%d %d %d\n", e->value.motion[0], e->value.motion[1], e->value.motion[2]);
+        }
+    }
+    return ferror(out) ? C_ERR_IO : C_ERR_OK;
+}
+
+/* ---- workload_free ---------------------------------------------------------
+   Purpose: Release a workload and reset it to empty.
+   Params:
+     - wl (in/out): workload
+----------------------------------------------------------------------------- */
+void workload_free(Workload *wl) {
+    if (!wl) return;
+    free(wl->names);
+    free(wl->entries);
+    memset(wl, 0, sizeof *wl);
+}
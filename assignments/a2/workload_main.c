@@ -0,0 +1,237 @@
+// workload_main.c
+//
+// Workload generator and benchmark driver for the log manager. Generates a
+// seeded workload (workload.c) and either writes it as CSV for `a2 --batch`
+// or times the manager's operations on it, reporting ns/op and peak RSS.
+// Not part of the a2 program; build with
+//   gcc -O2 -Wall workload_main.c workload.c manager.c btree.c intern.c columns.c query.c sample.c report.c check.c retain.c motion.c rollup.c index.c loader.o -lm -o workload
+// and run as
+//   ./workload [--rooms N] [--entries N] [--mix TEMP,DB,MOTION] [--order sorted|reversed|random|bursty]
+//              [--zipf S] [--seed N] [--csv FILE]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "defs.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *ORDER_NAMES[] = { "sorted", "reversed", "random", "bursty" };
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double peak_rss_mb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024.0; // kilobytes on Linux
+}
+
+static void report(const char *op, long ops, double seconds) {
+    if (ops > 0) {
+        printf("%-20s | %-10ld | %-12.1f | %.1f\n", op, ops, seconds * 1e9 / ops, peak_rss_mb());
+    } else {
+        printf("%-20s | %-10s | %-12s | %.1f\n", op, "-", "-", peak_rss_mb());
+    }
+}
+
+// Point stdout at /dev/null while timing the printing paths, so the numbers
+// are formatting cost rather than terminal speed. Returns the saved stdout.
+static int stdout_silence(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void stdout_restore(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+static int parse_args(int argc, char *argv[], WorkloadSpec *spec, const char **csv) {
+    for (int i = 1; i < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *arg = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!arg) return 0;
+        if (strcmp(opt, "--rooms") == 0) {
+            spec->num_rooms = atoi(arg);
+        } else if (strcmp(opt, "--entries") == 0) {
+            spec->num_entries = atoi(arg);
+        } else if (strcmp(opt, "--mix") == 0) {
+            if (sscanf(arg, "%d,%d,%d", &spec->mix[0], &spec->mix[1], &spec->mix[2]) != 3) return 0;
+        } else if (strcmp(opt, "--order") == 0) {
+            spec->order = -1;
+            for (int o = WORKLOAD_SORTED; o <= WORKLOAD_BURSTY; ++o) {
+                if (strcmp(arg, ORDER_NAMES[o]) == 0) spec->order = o;
+            }
+            if (spec->order < 0) return 0;
+        } else if (strcmp(opt, "--zipf") == 0) {
+            spec->zipf = atof(arg);
+        } else if (strcmp(opt, "--seed") == 0) {
+            spec->seed = strtoull(arg, NULL, 10);
+        } else if (strcmp(opt, "--csv") == 0) {
+            *csv = arg;
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Time the manager's operations on the workload, one row per operation
+static void run_benchmark(const Workload *wl) {
+    RoomCollection  rc = { .size = 0 };
+    EntryCollection ec = { .size = 0 };
+    ColumnStore     cs = { 0 };
+    columns_attach(&cs, &ec); // as the a2 program does
+    int n = wl->num_entries;
+
+    double start = now_sec();
+    for (int r = 0; r < wl->num_rooms; ++r) {
+        rooms_add(&rc, wl->names[r]);
+    }
+    report("rooms_add", wl->num_rooms, now_sec() - start);
+
+    // Look up rooms in the order readings arrive, so popular rooms dominate
+    Room **rooms = malloc((n ? n : 1) * sizeof *rooms);
+    start = now_sec();
+    for (int i = 0; i < n; ++i) {
+        rooms[i] = rooms_find(&rc, wl->names[wl->entries[i].room]);
+    }
+    report("rooms_find", n, now_sec() - start);
+
+    start = now_sec();
+    for (int i = 0; i < n; ++i) {
+        const WorkloadEntry *e = &wl->entries[i];
+        entries_create(&ec, rooms[i], e->type, e->value, e->timestamp);
+    }
+    report("entries_create", n, now_sec() - start);
+
+    int saved = stdout_silence();
+    start = now_sec();
+    ReportWriter w;
+    if (report_open(&w, stdout) == C_ERR_OK) { // as menu option 2 prints them
+        report_entries(&w, &ec, &rc, REPORT_TEXT);
+        report_close(&w);
+    }
+    double entries_time = now_sec() - start;
+    start = now_sec();
+    for (int r = 0; r < rc.size; ++r) {
+        room_print(rc.rooms[r]);
+    }
+    double rooms_time = now_sec() - start;
+    stdout_restore(saved);
+    report("print entries", ec.size, entries_time);
+    report("print rooms", ec.size, rooms_time);
+
+    // The loader's checks only take collections that fit its 16-entry layout
+    // (and say so on stdout otherwise)
+    saved = stdout_silence();
+    start = now_sec();
+    int order_fits = sample_test_order(&ec, 0) != C_ERR_FULL_ARRAY;
+    double order_time = now_sec() - start;
+    start = now_sec();
+    int rooms_fit = sample_test_rooms(&ec, &rc, 0) != C_ERR_FULL_ARRAY;
+    double rooms_check_time = now_sec() - start;
+    stdout_restore(saved);
+    report("test order", order_fits ? ec.size : 0, order_time);
+    report("test rooms", rooms_fit ? ec.size : 0, rooms_check_time);
+
+    MemoryUsage mu;
+    entries_memory(&ec, &rc, &mu);
+    size_t total = mu.slab + mu.order + mu.room_lists + mu.columns;
+
+    // Our own O(n) checker, then an incremental run after 1% more entries
+    CheckState check = { .has_run = 0 };
+    start = now_sec();
+    int check_result = check_full(&check, &ec, &rc, CHECK_ORDER | CHECK_ROOMS);
+    report("check full", ec.size, now_sec() - start);
+    int extra = n / 100;
+    for (int i = 0; i < extra; ++i) {
+        const WorkloadEntry *e = &wl->entries[i];
+        entries_create(&ec, rooms[i], e->type, e->value, e->timestamp);
+    }
+    start = now_sec();
+    if (check_result == C_ERR_OK) {
+        check_result = check_incremental(&check, &ec, &rc);
+    }
+    report("check incremental", extra, now_sec() - start);
+    if (check_result != C_ERR_OK) {
+        printf("Check failed: %s\n", check.first_error);
+    }
+
+    // The same entries again, in one bulk insert
+    EntryCollection bulk = { .size = 0 };
+    EntryInput *batch = malloc((n ? n : 1) * sizeof *batch);
+    for (int i = 0; i < n; ++i) {
+        const WorkloadEntry *e = &wl->entries[i];
+        batch[i] = (EntryInput){ rooms[i], e->type, e->value, e->timestamp };
+    }
+    start = now_sec();
+    entries_bulk_create(&bulk, &rc, batch, n);
+    report("entries_bulk_create", n, now_sec() - start);
+
+    printf("\nHeld for %d entries: %.1f bytes/entry (slab %.1f, order %.1f, rooms %.1f, columns %.1f)\n",
+           n, n ? (double)total / n : 0.0, n ? (double)mu.slab / n : 0.0, n ? (double)mu.order / n : 0.0,
+           n ? (double)mu.room_lists / n : 0.0, n ? (double)mu.columns / n : 0.0);
+
+    free(batch);
+    free(rooms);
+    entries_free(&bulk);
+    entries_free(&ec);
+    columns_free(&cs);
+    rooms_free(&rc);
+}
+
+int main(int argc, char *argv[]) {
+    WorkloadSpec spec = {
+        .num_rooms = 64, .num_entries = 100000, .mix = { 1, 1, 1 },
+        .order = WORKLOAD_RANDOM, .zipf = 0.0, .seed = 2401
+    };
+    const char *csv = NULL;
+    if (!parse_args(argc, argv, &spec, &csv)) {
+        printf("Usage: %s [--rooms N] [--entries N] [--mix TEMP,DB,MOTION] "
+               "[--order sorted|reversed|random|bursty] [--zipf S] [--seed N] [--csv FILE]\n", argv[0]);
+        return 1;
+    }
+
+    Workload wl;
+    int result = workload_generate(&spec, &wl);
+    if (result != C_ERR_OK) {
+        printf("Error: could not generate the workload (%d).\n", result);
+        return 1;
+    }
+
+    if (csv) {
+        FILE *out = fopen(csv, "w");
+        result = out ? workload_write_csv(&wl, out) : C_ERR_IO;
+        if (out && fclose(out) != 0) result = C_ERR_IO;
+        if (result != C_ERR_OK) {
+            printf("Error: could not write '%s'.\n", csv);
+        }
+        workload_free(&wl);
+        return result == C_ERR_OK ? 0 : 1;
+    }
+
+    printf("%d rooms, %d entries, mix %d/%d/%d, %s timestamps, zipf %.2f, seed %llu\n\n",
+           spec.num_rooms, spec.num_entries, spec.mix[0], spec.mix[1], spec.mix[2],
+           ORDER_NAMES[spec.order], spec.zipf, (unsigned long long)spec.seed);
+    printf("%-20s | %-10s | %-12s | %s\n", "operation", "ops", "ns/op", "peak RSS MB");
+    printf("---------------------|------------|--------------|------------\n");
+    run_benchmark(&wl);
+    workload_free(&wl);
+    return 0;
+}